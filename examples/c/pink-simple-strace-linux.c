@@ -26,6 +26,7 @@
 #include <pinktrace/pink.h>
 
 #define MAX_STRING_LEN 128
+#define MAX_ARGV_LEN 4096
 
 struct child {
 	pid_t pid;
@@ -110,11 +111,12 @@ decode_open(pid_t pid, pink_bitness_t bitness)
 static void
 decode_execve(pid_t pid, pink_bitness_t bitness)
 {
-	bool nil;
-	unsigned i;
+	bool truncated;
 	long arg;
+	ssize_t i, count;
 	char buf[MAX_STRING_LEN];
-	const char *sep;
+	unsigned args[MAX_ARGV_LEN / sizeof(unsigned)];
+	const char *rec;
 
 	if (!pink_decode_string(pid, bitness, 0, buf, MAX_STRING_LEN)) {
 		perror("pink_decode_string");
@@ -125,21 +127,17 @@ decode_execve(pid_t pid, pink_bitness_t bitness)
 		return;
 	}
 
-	printf("execve(\"%s\", [", buf);
-
-	for (i = 0, nil = false, sep = "";;sep = ", ") {
-		if (!pink_decode_string_array_member(pid, bitness, arg, ++i, buf, MAX_STRING_LEN, &nil)) {
-			perror("pink_decode_string_array_member");
-			return;
-		}
-
-		printf("%s\"%s\"", sep, buf);
-
-		if (nil) {
-			printf("], envp[])");
-			break;
-		}
+	/* Decode all the arguments at once */
+	count = pink_decode_string_array(pid, bitness, arg, (char *)args, sizeof(args), &truncated);
+	if (count < 0) {
+		perror("pink_decode_string_array");
+		return;
 	}
+
+	printf("execve(\"%s\", [", buf);
+	for (i = 0, rec = (const char *)args; i < count; i++, rec = PINK_STRING_ARRAY_NEXT(rec))
+		printf("%s\"%s\"", i ? ", " : "", PINK_STRING_ARRAY_STRING(rec));
+	printf("%s], envp[])", truncated ? ", ..." : "");
 }
 
 /* A very basic decoder for bind() and connect() calls */
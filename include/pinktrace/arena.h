@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _PINK_ARENA_H
+#define _PINK_ARENA_H
+
+/**
+ * @file pinktrace/arena.h
+ * @brief Pink's decode arenas
+ * @defgroup pink_arena Pink's decode arenas
+ * @ingroup pinktrace
+ * @{
+ **/
+
+#include <stddef.h>
+#include <pinktrace/macros.h>
+
+PINK_BEGIN_DECL
+
+/**
+ * @struct pink_arena_t
+ * @brief Opaque structure which represents a decode arena
+ *
+ * A decode arena is a bump allocator. Allocations are carved off blocks
+ * which are kept around until the arena is freed, so decoding into an arena
+ * which has been reset makes no heap allocation once the blocks are big
+ * enough. Individual allocations can not be freed, all of them are released
+ * at once with pink_arena_reset().
+ *
+ * @see pink_util_movestr_arena()
+ * @see pink_decode_string_arena()
+ * @see pink_decode_string_array_member_arena()
+ **/
+typedef struct pink_arena pink_arena_t;
+
+/**
+ * Allocate a decode arena
+ *
+ * @param block_size Size of the blocks the arena allocates from, zero for
+ *                   the default size. Allocations larger than this get a
+ *                   block of their own.
+ * @return The decode arena on success, NULL on failure and sets errno
+ *         accordingly
+ **/
+pink_arena_t *pink_arena_new(size_t block_size)
+	PINK_GCC_ATTR((malloc));
+
+/**
+ * Free the decode arena and all the memory allocated from it
+ *
+ * @param arena Decode arena, may be NULL
+ **/
+void pink_arena_free(pink_arena_t *arena);
+
+/**
+ * Release all the memory allocated from the decode arena. The blocks are
+ * kept for reuse. This function does not depend on the number of
+ * allocations made.
+ *
+ * @param arena Decode arena
+ **/
+void pink_arena_reset(pink_arena_t *arena)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Allocate memory from the decode arena. The memory is suitably aligned for
+ * any kind of variable and valid until the arena is reset or freed.
+ *
+ * @param arena Decode arena
+ * @param len Number of bytes to allocate
+ * @return Pointer to the allocated memory on success, NULL on failure and
+ *         sets errno accordingly
+ **/
+void *pink_arena_alloc(pink_arena_t *arena, size_t len)
+	PINK_GCC_ATTR((malloc, nonnull(1)));
+
+PINK_END_DECL
+/** @} */
+#endif
@@ -38,6 +38,7 @@
 
 #include <stdbool.h>
 #include <sys/types.h>
+#include <pinktrace/arena.h>
 #include <pinktrace/bitness.h>
 #include <pinktrace/macros.h>
 #include <pinktrace/socket.h>
@@ -82,6 +83,18 @@ bool pink_decode_string(pid_t pid, pink_bitness_t bitness, unsigned ind,
 char *pink_decode_string_persistent(pid_t pid, pink_bitness_t bitness, unsigned ind)
 	PINK_GCC_ATTR((malloc));
 
+/**
+ * Like pink_decode_string_persistent() but allocates the string from the
+ * given decode arena, the string must not be freed.
+ *
+ * @see pink_arena_t
+ *
+ * @return String on success, NULL on failure and sets errno accordingly
+ **/
+char *pink_decode_string_arena(pid_t pid, pink_bitness_t bitness, unsigned ind,
+		pink_arena_t *arena)
+	PINK_GCC_ATTR((nonnull(4)));
+
 /**
  * Decode the requested member of a NULL-terminated string array
  *
@@ -122,7 +135,100 @@ char *pink_decode_string_array_member_persistent(pid_t pid,
 		pink_bitness_t bitness, long arg, unsigned ind)
 	PINK_GCC_ATTR((malloc));
 
+/**
+ * Like pink_decode_string_array_member_persistent() but allocates the string
+ * from the given decode arena, the string must not be freed.
+ *
+ * @attention If the array member is NULL, this function returns NULL but doesn't
+ *            modify errno. Check errno after the call to distinguish between
+ *            success and failure for a NULL return.
+ *
+ * @see pink_arena_t
+ *
+ * @param pid Process ID
+ * @param bitness Bitness
+ * @param arg Address of the argument, see pink_util_get_arg()
+ * @param ind Index of the string in the array
+ * @param arena Decode arena
+ * @return The string on success, NULL on failure and sets errno accordingly
+ **/
+char *pink_decode_string_array_member_arena(pid_t pid,
+		pink_bitness_t bitness, long arg, unsigned ind,
+		pink_arena_t *arena)
+	PINK_GCC_ATTR((nonnull(5)));
+
 #if PINK_OS_LINUX || defined(DOXYGEN)
+/**
+ * Size of the record of a string of the given length in a block filled by
+ * pink_decode_string_array()
+ *
+ * @note Availability: Linux
+ **/
+#define PINK_STRING_ARRAY_RECORD_SIZE(length) \
+	((sizeof(unsigned) + (length) + sizeof(unsigned)) & ~(sizeof(unsigned) - 1))
+
+/**
+ * Length of the string of the record rec, not counting the zero-byte
+ *
+ * @note Availability: Linux
+ **/
+#define PINK_STRING_ARRAY_LENGTH(rec) \
+	(*(const unsigned *)(const void *)(rec))
+
+/**
+ * The zero-terminated string of the record rec
+ *
+ * @note Availability: Linux
+ **/
+#define PINK_STRING_ARRAY_STRING(rec) \
+	((const char *)(rec) + sizeof(unsigned))
+
+/**
+ * The record following the record rec
+ *
+ * @note Availability: Linux
+ **/
+#define PINK_STRING_ARRAY_NEXT(rec) \
+	((const char *)(rec) + PINK_STRING_ARRAY_RECORD_SIZE(PINK_STRING_ARRAY_LENGTH(rec)))
+
+/**
+ * Decode all the members of a NULL-terminated string array at once, e.g.
+ * the argument or the environment vector of execve(2).
+ *
+ * The pointer table is read in batches and the strings are read with a
+ * single process_vm_readv(2) call per batch, so decoding the array takes a
+ * handful of system calls instead of a few per member.
+ *
+ * The strings are packed into dest as records, each consisting of the
+ * length of the string as an unsigned int followed by the zero-terminated
+ * string, padded to the alignment of unsigned int. Use
+ * PINK_STRING_ARRAY_LENGTH(), PINK_STRING_ARRAY_STRING() and
+ * PINK_STRING_ARRAY_NEXT() to walk the records.
+ *
+ * @code
+ * const char *rec = buf;
+ * for (ssize_t i = 0; i < count; i++, rec = PINK_STRING_ARRAY_NEXT(rec))
+ *	puts(PINK_STRING_ARRAY_STRING(rec));
+ * @endcode
+ *
+ * @note Availability: Linux
+ *
+ * @param pid Process ID
+ * @param bitness Bitness
+ * @param arg Address of the argument, see pink_util_get_arg()
+ * @param dest Pointer to store the records, must be suitably aligned for
+ *             unsigned int
+ * @param len Size of dest, this is the byte budget for the whole array
+ * @param truncated Set to true if decoding stopped before the end of the
+ *                  array because the next string did not fit into dest,
+ *                  false otherwise
+ * @return The number of strings decoded on success, -1 on failure and sets
+ *         errno accordingly
+ **/
+ssize_t pink_decode_string_array(pid_t pid, pink_bitness_t bitness, long arg,
+		char *dest, size_t len, bool *truncated)
+	PINK_GCC_ATTR((nonnull(4,6)));
+
 /**
  * Decode the socket call and place it in subcall.
  *
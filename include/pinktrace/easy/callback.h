@@ -58,6 +58,42 @@
  **/
 #define PINK_EASY_CFLAG_SIGIGN		(1 << 2)
 
+/**
+ * Implies that the system call should fail with @e EPERM.
+ * Only makes sense for "syscall" callback in seccomp notification mode,
+ * see pink_easy_context_seccomp_notify().
+ **/
+#define PINK_EASY_CFLAG_DENY		(1 << 3)
+
+/**
+ * Implies that the tracee should be left stopped until a verdict is posted
+ * with pink_easy_process_complete(), the event loop goes on with the other
+ * tracees meanwhile. Only makes sense for "syscall" callback and system call
+ * handlers, and not in seccomp notification mode.
+ **/
+#define PINK_EASY_CFLAG_PENDING		(1 << 4)
+
+/**
+ * Implies that the tracing context should detach from the current process
+ * when the process is resumed, see pink_easy_process_detach(). Unlike
+ * PINK_EASY_CFLAG_DROP, the process runs on untraced. Only makes sense
+ * for callbacks which are called while the process is stopped. Ignored for
+ * processes running under the seccomp filter of the tracing context.
+ **/
+#define PINK_EASY_CFLAG_DETACH		(1 << 5)
+
+/**
+ * The system call handler is called on system call entry,
+ * see pink_easy_context_syscall_add()
+ **/
+#define PINK_EASY_SYSCALL_ENTRY		(1 << 0)
+
+/**
+ * The system call handler is called on system call exit,
+ * see pink_easy_context_syscall_add()
+ **/
+#define PINK_EASY_SYSCALL_EXIT		(1 << 1)
+
 struct pink_easy_context;
 
 /**
@@ -87,6 +123,7 @@ struct pink_easy_context;
      - WAIT              +      -                                                -
      - TRACE             +      pink_easy_process_t *current, const char *errctx -
      - PROCESS           -      pink_easy_process_t *current, const char *errctx -
+     - NOTIFY            +      const char *errctx                               -
      -----------------------------------------------------------------------------
    @endverbatim
  *
@@ -50,9 +50,77 @@ PINK_BEGIN_DECL
  *
  * Use pink_easy_context_new() to create one and pink_easy_context_destroy() to
  * free all allocated resources.
+ *
+ * The kernel binds a traced process to the thread which attached to it, so a
+ * context must be used from a single thread, which spawns or attaches its
+ * processes and runs its event loop. Contexts are independent of each other:
+ * worker threads may trace in parallel with a context each. The event loop
+ * waits only for the processes traced by the calling thread, and children of
+ * traced processes stay with the thread tracing their parent.
  **/
 typedef struct pink_easy_context pink_easy_context_t;
 
+/**
+ * Attach to processes with pink_trace_seize() instead of pink_trace_attach()
+ * and spawn children without the initial @e SIGSTOP, the tracing options are
+ * applied at attach time and inherited by automatically attached children.
+ * Group-stops are kept with pink_trace_listen() as job control expects.
+ *
+ * @note Availability: Linux (3.4 or newer)
+ **/
+#define PINK_EASY_OPTION_SEIZE		(1 << 0)
+
+/**
+ * Enable the per-tracee read cache, see pink_util_cache_enable(), for every
+ * traced process. Threads and @e vfork children share the cache of their
+ * parent since they share its address space. The cache forgets the memory
+ * map when a system call which may change it returns, in seccomp mode such
+ * system calls are added to the filter of processes spawned afterwards and
+ * stop the tracee at exit, without calling the callbacks.
+ *
+ * @note Availability: Linux
+ **/
+#define PINK_EASY_OPTION_CACHE		(1 << 1)
+
+/**
+ * Along with #PINK_EASY_OPTION_CACHE, keep strings read from read-only,
+ * private, file-backed mappings across stops, see pink_util_cache_strings().
+ *
+ * @warning Writing to the mapped files changes such strings without the
+ *          tracer noticing, do not use this option when the strings are
+ *          used for security decisions.
+ *
+ * @note Availability: Linux
+ **/
+#define PINK_EASY_OPTION_CACHE_STRINGS	(1 << 4)
+
+/**
+ * After waiting for a stop, collect all the stops which are pending already
+ * and handle them in turn before waiting again. Without this option
+ * pink_easy_loop() handles one stop per wait and, since the kernel reports
+ * the children in the same order every time, a busy process may keep the
+ * others waiting.
+ *
+ * @see pink_easy_context_get_batch_stats()
+ **/
+#define PINK_EASY_OPTION_BATCH		(1 << 2)
+
+/**
+ * Spawn children of pink_easy_execve() and friends with @e clone(2) using
+ * @c CLONE_VM and @c CLONE_VFORK on a small stack of their own, instead of
+ * @e fork(2). The page tables of the tracer are not copied, spawning takes
+ * the same time however large the tracer is. The child calls @e execve(2)
+ * before its first stop, hence neither the "exec" callback nor system call
+ * callbacks are called for the initial program, the first stop is the
+ * @e SIGTRAP raised by @e execve(2) which the event loop ignores.
+ *
+ * @note This option is ignored in seccomp mode and with
+ *       PINK_EASY_OPTION_SEIZE, which need the child to stop before it
+ *       calls @e execve(2), @e fork(2) is used then.
+ * @note Availability: Linux, except IA64
+ **/
+#define PINK_EASY_OPTION_SPAWN		(1 << 3)
+
 /**
  * Allocate a tracing context.
  *
@@ -118,6 +186,26 @@ void pink_easy_context_set_userdata(pink_easy_context_t *ctx, void *userdata,
 		pink_easy_free_func_t userdata_destroy)
 	PINK_GCC_ATTR((nonnull(1)));
 
+/**
+ * Set the options of the tracing context
+ *
+ * @note The options apply to processes attached or spawned afterwards.
+ *
+ * @param ctx Tracing context
+ * @param options Bitwise OR'ed PINK_EASY_OPTION_* flags
+ **/
+void pink_easy_context_set_options(pink_easy_context_t *ctx, int options)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Returns the options of the tracing context
+ *
+ * @param ctx Tracing context
+ * @return Bitwise OR'ed PINK_EASY_OPTION_* flags
+ **/
+int pink_easy_context_get_options(const pink_easy_context_t *ctx)
+	PINK_GCC_ATTR((nonnull(1)));
+
 /**
  * Returns the user data of the tracing context
  *
@@ -127,6 +215,147 @@ void pink_easy_context_set_userdata(pink_easy_context_t *ctx, void *userdata,
 void *pink_easy_context_get_userdata(const pink_easy_context_t *ctx)
 	PINK_GCC_ATTR((nonnull(1)));
 
+/**
+ * Returns the decode arena of the tracing context. The arena is reset
+ * before every event is handled, so strings decoded into it from a callback
+ * with pink_decode_string_arena() and friends need not be freed and are
+ * valid until the callback returns.
+ *
+ * In seccomp notification mode, see pink_easy_context_seccomp_notify(), each
+ * thread calling pink_easy_notify_handle() has an arena of its own, reset
+ * before each notification, so threads serving the same listener do not
+ * share one. Otherwise the arena belongs to the thread running the event
+ * loop and must not be used from other threads.
+ *
+ * @param ctx Tracing context
+ * @return Decode arena on success, NULL on failure and sets errno
+ *         accordingly
+ **/
+pink_arena_t *pink_easy_context_get_arena(pink_easy_context_t *ctx)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Returns the batch statistics of the tracing context, see
+ * PINK_EASY_OPTION_BATCH. The stops handled by pink_easy_loop_step() are
+ * counted as batches as well.
+ *
+ * @param ctx Tracing context
+ * @param batches Pointer to store the number of batches, may be NULL
+ * @param stops Pointer to store the number of stops handled in batches, may
+ *              be NULL
+ * @param max Pointer to store the size of the largest batch, may be NULL
+ **/
+void pink_easy_context_get_batch_stats(const pink_easy_context_t *ctx,
+		unsigned long *batches, unsigned long *stops, unsigned *max)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Set the size of the inline user data of process entries. Process entries
+ * are allocated from slabs owned by the tracing context and reused after the
+ * process exits, the inline user data is part of the entry so it needs no
+ * allocation of its own. It is zeroed when a new process is added.
+ *
+ * @note This function must be called before any process is added to the
+ *       context, e.g. right after pink_easy_context_new().
+ * @see pink_easy_process_get_inline_userdata()
+ *
+ * @param ctx Tracing context
+ * @param size Size of the inline user data in bytes
+ * @return true on success, false on failure and sets errno accordingly
+ **/
+bool pink_easy_context_set_inline_userdata_size(pink_easy_context_t *ctx, size_t size)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Returns the size of the inline user data of process entries
+ *
+ * @param ctx Tracing context
+ * @return Size of the inline user data in bytes
+ **/
+size_t pink_easy_context_get_inline_userdata_size(const pink_easy_context_t *ctx)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Add a system call to the set of system calls which stop the tracees in
+ * seccomp mode. Adding the first system call switches the tracing context to
+ * seccomp mode: pink_easy_execve() and friends and pink_easy_call() install a
+ * seccomp filter in the child which returns @e SECCOMP_RET_TRACE for the
+ * system calls in the set and allows the rest, and pink_easy_loop() resumes
+ * these processes and their children with pink_trace_cont() instead of
+ * pink_trace_syscall(). Only the system calls in the set stop the tracee and
+ * the "syscall" callback is called on their entry only.
+ *
+ * @note Availability: Linux (3.5 or newer)
+ * @note Processes attached with pink_easy_attach() are traced as usual.
+ * @note The child sets @e PR_SET_NO_NEW_PRIVS before installing the filter.
+ *
+ * @param ctx Tracing context
+ * @param bitness Bitness of the system call
+ * @param scno System call number
+ * @return true on success, false on failure and sets errno accordingly
+ **/
+bool pink_easy_context_seccomp_add(pink_easy_context_t *ctx, pink_bitness_t bitness, long scno)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Add a system call by name to the set of system calls which stop the tracees
+ * in seccomp mode, the name is resolved with pink_name_lookup().
+ *
+ * @note Availability: Linux (3.5 or newer)
+ * @see pink_easy_context_seccomp_add()
+ *
+ * @param ctx Tracing context
+ * @param bitness Bitness of the system call
+ * @param name Name of the system call
+ * @return true on success, false on failure and sets errno accordingly
+ **/
+bool pink_easy_context_seccomp_add_name(pink_easy_context_t *ctx, pink_bitness_t bitness, const char *name)
+	PINK_GCC_ATTR((nonnull(1,3)));
+
+/**
+ * Register a handler for a system call. The handler is called on entry and/or
+ * exit of the given system call, after the "syscall" callback. Dispatch is a
+ * single array lookup and the loop does not fetch registers for system calls
+ * without a handler unless the "syscall" callback exists.
+ *
+ * In seccomp mode (see pink_easy_context_seccomp_add()) the system calls with
+ * a handler stop the tracee too and the tracee is only stopped on system call
+ * exit if the handler asks for it with #PINK_EASY_SYSCALL_EXIT. In seccomp
+ * user notification mode handlers are called on system call entry only.
+ *
+ * @note Register the handlers before spawning children in seccomp mode, the
+ *       filter is built when the child is spawned.
+ *
+ * @param ctx Tracing context
+ * @param bitness Bitness of the system call
+ * @param scno System call number
+ * @param when Bitwise OR of #PINK_EASY_SYSCALL_ENTRY and
+ *             #PINK_EASY_SYSCALL_EXIT
+ * @param func Handler, NULL to remove the handler
+ * @return true on success, false on failure and sets errno accordingly
+ **/
+bool pink_easy_context_syscall_add(pink_easy_context_t *ctx, pink_bitness_t bitness, long scno,
+		int when, pink_easy_callback_syscall_t func)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Register a handler for a system call by name, the name is resolved with
+ * pink_name_lookup().
+ *
+ * @see pink_easy_context_syscall_add()
+ *
+ * @param ctx Tracing context
+ * @param bitness Bitness of the system call
+ * @param name Name of the system call
+ * @param when Bitwise OR of #PINK_EASY_SYSCALL_ENTRY and
+ *             #PINK_EASY_SYSCALL_EXIT
+ * @param func Handler, NULL to remove the handler
+ * @return true on success, false on failure and sets errno accordingly
+ **/
+bool pink_easy_context_syscall_add_name(pink_easy_context_t *ctx, pink_bitness_t bitness,
+		const char *name, int when, pink_easy_callback_syscall_t func)
+	PINK_GCC_ATTR((nonnull(1,3)));
+
 /**
  * Returns the process list
  *
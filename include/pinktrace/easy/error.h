@@ -78,6 +78,9 @@ typedef enum {
 	/** Process misbehave (i.e. indication of a pinktrace bug)**/
 	PINK_EASY_ERROR_PROCESS,
 
+	/** Seccomp user notification failed **/
+	PINK_EASY_ERROR_NOTIFY,
+
 	/** Maximum error number **/
 	PINK_EASY_ERROR_MAX,
 } pink_easy_error_t;
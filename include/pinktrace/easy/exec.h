@@ -42,8 +42,9 @@
 PINK_BEGIN_DECL
 
 /**
- * This function calls fork() to spawn a new child, does the necessary
- * preparation for tracing and then calls execve().
+ * This function calls fork(), or clone() with #PINK_EASY_OPTION_SPAWN, to
+ * spawn a new child, does the necessary preparation for tracing and then
+ * calls execve().
  *
  * @param ctx Tracing context
  * @param filename Path of the executable
@@ -56,8 +57,9 @@ bool pink_easy_execve(pink_easy_context_t *ctx, const char *filename,
 	PINK_GCC_ATTR((nonnull(1)));
 
 /**
- * This function calls fork() to spawn a new child, does the necessary
- * preparation for tracing, handles the arguments and calls execl().
+ * This function calls fork(), or clone() with #PINK_EASY_OPTION_SPAWN, to
+ * spawn a new child, does the necessary preparation for tracing, handles the
+ * arguments and calls execl().
  *
  * @param ctx Tracing context
  * @param file Filename of the executable
@@ -70,8 +72,9 @@ bool pink_easy_execl(pink_easy_context_t *ctx, const char *file,
 	PINK_GCC_ATTR((nonnull(1), sentinel(0)));
 
 /**
- * This function calls fork() to spawn a new child, does the necessary
- * preparation for tracing, handles the arguments and calls execlp().
+ * This function calls fork(), or clone() with #PINK_EASY_OPTION_SPAWN, to
+ * spawn a new child, does the necessary preparation for tracing, handles the
+ * arguments and calls execlp().
  *
  * @param ctx Tracing context
  * @param file Filename of the executable
@@ -84,8 +87,9 @@ bool pink_easy_execlp(pink_easy_context_t *ctx, const char *file,
 	PINK_GCC_ATTR((nonnull(1), sentinel(0)));
 
 /**
- * This function calls fork() to spawn a new child, does the necessary
- * preparation for tracing and then calls execv().
+ * This function calls fork(), or clone() with #PINK_EASY_OPTION_SPAWN, to
+ * spawn a new child, does the necessary preparation for tracing and then
+ * calls execv().
  *
  * @param ctx Tracing context
  * @param path Path of the executable
@@ -97,8 +101,9 @@ bool pink_easy_execv(pink_easy_context_t *ctx, const char *path,
 	PINK_GCC_ATTR((nonnull(1)));
 
 /**
- * This function calls fork() to spawn a new child, does the necessary
- * preparation for tracing and then calls execvp().
+ * This function calls fork(), or clone() with #PINK_EASY_OPTION_SPAWN, to
+ * spawn a new child, does the necessary preparation for tracing and then
+ * calls execvp().
  *
  * @param ctx Tracing context
  * @param file Name of the executable
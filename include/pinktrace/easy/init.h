@@ -50,6 +50,8 @@ extern unsigned pink_easy_os_release;
  * Initialize pinktrace-easy's internal variables.
  *
  * @warning This function @b must be called before any library interaction!
+ *          If worker threads trace in parallel, call it once before they
+ *          are started.
  *
  * @return true on success, false on failure and sets errno accordingly
  **/
@@ -37,14 +37,16 @@
 #include "config.h"
 #endif /* HAVE_CONFIG_H */
 
+#include <pthread.h>
+#include <signal.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <sys/types.h>
-#include <sys/queue.h>
 
 #include <pinktrace/pink.h>
 #include <pinktrace/easy/callback.h>
 #include <pinktrace/easy/error.h>
+#include <pinktrace/easy/process.h>
 
 #undef KERNEL_VERSION
 #define KERNEL_VERSION(a,b,c) (((a) << 16) + ((b) << 8) + (c))
@@ -63,6 +65,41 @@
 #define PINK_EASY_PROCESS_FOLLOWFORK		00040
 /** Process is a clone **/
 #define PINK_EASY_PROCESS_CLONE_THREAD		00100
+/** Process runs under the seccomp filter of the context **/
+#define PINK_EASY_PROCESS_SECCOMP		00200
+/** Stop at the exit of the current system call under the seccomp filter **/
+#define PINK_EASY_PROCESS_SYSEXIT		00400
+/** Process is attached with pink_trace_seize() **/
+#define PINK_EASY_PROCESS_SEIZED		01000
+/** Process is stopped until a verdict is posted with pink_easy_process_complete() **/
+#define PINK_EASY_PROCESS_PENDING		02000
+/** The system call was denied at entry, its return value is set at exit **/
+#define PINK_EASY_PROCESS_DENIED		04000
+/** Tracing options must be set up again for the trace level **/
+#define PINK_EASY_PROCESS_SETUP			010000
+/** Detach from the process the next time it is resumed or stops **/
+#define PINK_EASY_PROCESS_DETACH		020000
+/** Next SIGTRAP is to be ignored, it was raised by execve() **/
+#define PINK_EASY_PROCESS_IGNORE_ONE_SIGTRAP	040000
+/** Stop at the exit of the current system call, which may change the memory map **/
+#define PINK_EASY_PROCESS_MAPS			0100000
+
+/** System call numbers handlers may be registered for are below this **/
+#define PINK_EASY_SYSCALL_MAX			4096
+
+/** Maximum number of stops collected at once with PINK_EASY_OPTION_BATCH **/
+#define PINK_EASY_BATCH_MAX			64
+
+/** Signal which interrupts pink_easy_loop() waiting for stops when a verdict is posted **/
+#define PINK_EASY_WAKEUP_SIGNAL			SIGURG
+
+/** Number of system calls which may change the memory map **/
+#define PINK_EASY_MAP_SYSCALLS			12
+
+/** Seccomp filter data: stop at exit, the system call may change the memory map **/
+#define PINK_EASY_SECCOMP_MAPS			1
+/** Seccomp filter data: the callbacks did not ask for the system call **/
+#define PINK_EASY_SECCOMP_QUIET			2
 
 PINK_BEGIN_DECL
 
@@ -75,7 +112,7 @@ typedef enum {
 /** Process entry **/
 struct pink_easy_process {
 	/** PINK_EASY_PROCESS_* flags **/
-	short flags;
+	int flags;
 
 	/** Process Id of this entry **/
 	pid_t pid;
@@ -86,15 +123,61 @@ struct pink_easy_process {
 	/** Bitness (e.g. 32bit, 64bit) of this process **/
 	pink_bitness_t bitness;
 
+	/** Trace level, see pink_easy_process_set_trace_level() **/
+	pink_easy_trace_level_t level;
+
+	/** Error number of a denied system call, see PINK_EASY_PROCESS_DENIED **/
+	int deny_errno;
+
+	/** Serial number of the stop verdicts are accepted for, see
+	 * pink_easy_process_get_token() **/
+	unsigned long serial;
+
 	/** Per-process user data **/
 	void *userdata;
 
 	/** Destructor for user data **/
 	pink_easy_free_func_t userdata_destroy;
 
-	SLIST_ENTRY(pink_easy_process) entries;
+	/** Next free entry, only used while the entry is on the free list **/
+	struct pink_easy_process *next_free;
+
+	/** Inline user data, see pink_easy_context_set_inline_userdata_size() **/
+	char data[] PINK_GCC_ATTR((aligned));
+};
+
+/** System call handler, see pink_easy_context_syscall_add() **/
+struct pink_easy_syscall_handler {
+	/** PINK_EASY_SYSCALL_* flags, zero if there is no handler **/
+	int when;
+
+	/** Handler **/
+	pink_easy_callback_syscall_t func;
+};
+
+/** Verdict posted with pink_easy_process_complete() **/
+struct pink_easy_verdict_node {
+	/** Stop of the tracee the verdict is for **/
+	pink_easy_token_t token;
+
+	/** The verdict **/
+	pink_easy_verdict_t verdict;
+
+	/** Next verdict in the queue **/
+	struct pink_easy_verdict_node *next;
+};
+
+/** Process table, open addressing with linear probing keyed by process ID **/
+struct pink_easy_process_list {
+	/** Number of slots, zero or a power of two **/
+	unsigned size;
+
+	/** Number of entries **/
+	unsigned count;
+
+	/** Slots, NULL if empty **/
+	struct pink_easy_process **slots;
 };
-SLIST_HEAD(pink_easy_process_list, pink_easy_process);
 
 /** Tracing context **/
 struct pink_easy_context {
@@ -104,6 +187,9 @@ struct pink_easy_context {
 	/** pink_trace_setup() options **/
 	int ptrace_options;
 
+	/** PINK_EASY_OPTION_* flags **/
+	int options;
+
 	/** Last error **/
 	pink_easy_error_t error;
 
@@ -113,6 +199,76 @@ struct pink_easy_context {
 	/** Process list */
 	struct pink_easy_process_list process_list;
 
+	/** Size of the inline user data of process entries **/
+	size_t process_datasize;
+
+	/** Size of a process entry including the inline user data **/
+	size_t process_size;
+
+	/** Slabs process entries are allocated from **/
+	void *process_slabs;
+
+	/** Free list of process entries **/
+	struct pink_easy_process *process_free;
+
+	/** Trace in seccomp mode, see pink_easy_context_seccomp_add() **/
+	bool seccomp;
+
+	/** System calls which stop the tracee in seccomp mode, per bitness **/
+	long *seccomp_syscalls[2];
+
+	/** Number of system calls which stop the tracee, per bitness **/
+	unsigned seccomp_nsyscalls[2];
+
+	/** System call handlers indexed by system call number, per bitness **/
+	struct pink_easy_syscall_handler *syscall_handlers[2];
+
+	/** Number of entries of the system call handler arrays, per bitness **/
+	unsigned syscall_nhandlers[2];
+
+	/** System calls which may change the memory map, per bitness, -1 if unknown **/
+	long map_syscalls[2][PINK_EASY_MAP_SYSCALLS];
+
+	/** Use seccomp user notification instead of ptrace(2) **/
+	bool seccomp_notify;
+
+	/** Listener file descriptors of seccomp user notification **/
+	int *notify_fds;
+
+	/** Number of listener file descriptors **/
+	unsigned notify_nfds;
+
+	/** Decode arena, reset before every event, allocated on demand, used
+	 * only by the event loop thread, see _pink_easy_thread_arena() **/
+	pink_arena_t *arena;
+
+	/** File descriptor of pink_easy_loop_fd(), -1 if not created **/
+	int loop_fd;
+
+	/** Signal file descriptor for SIGCHLD, polled through loop_fd **/
+	int signal_fd;
+
+	/** Number of tracees waiting for their verdicts **/
+	unsigned npending;
+
+	/** Last serial number handed out to a process entry **/
+	unsigned long serial;
+
+	/** Queue of posted verdicts, last in first out, updated atomically **/
+	struct pink_easy_verdict_node *verdicts;
+
+	/** Event file descriptor written to when a verdict is posted, -1 if not created **/
+	int verdict_fd;
+
+	/** Thread running pink_easy_loop(), sent PINK_EASY_WAKEUP_SIGNAL when a
+	 * verdict is posted while loop_waiting is set, accessed atomically **/
+	pthread_t loop_thread;
+	int loop_waiting;
+
+	/** Batch statistics, see pink_easy_context_get_batch_stats() **/
+	unsigned long batches, batch_stops;
+	unsigned batch_max;
+
 	/** Callback table **/
 	pink_easy_callback_table_t callback_table;
 
@@ -122,25 +278,60 @@ struct pink_easy_context {
 	/** Destructor for the user data **/
 	pink_easy_free_func_t userdata_destroy;
 };
-#define PINK_EASY_FOREACH_PROCESS(node, ctx)	SLIST_FOREACH((node), &(ctx)->process_list, entries)
-#define PINK_EASY_INSERT_PROCESS(ctx, current)							\
+#define PINK_EASY_FOREACH_PROCESS(node, ctx)							\
+	for (unsigned _pink_slot = 0; _pink_slot < (ctx)->process_list.size; _pink_slot++)	\
+		if (((node) = (ctx)->process_list.slots[_pink_slot]) == NULL) {} else
+#define PINK_EASY_INSERT_PROCESS(ctx, current, newpid)						\
 	do {											\
-		(current) = calloc(1, sizeof(*(current)));					\
+		(current) = _pink_easy_process_alloc(ctx);					\
 		if ((current) == NULL) {							\
+			(ctx)->callback_table.error((ctx), PINK_EASY_ERROR_ALLOC, "malloc");	\
+			break;									\
+		}										\
+		(current)->pid = (newpid);							\
+		if (!_pink_easy_process_list_insert(&(ctx)->process_list, (current))) {	\
 			(ctx)->callback_table.error((ctx), PINK_EASY_ERROR_ALLOC, "calloc");	\
+			_pink_easy_process_free((ctx), (current));				\
+			(current) = NULL;							\
+			break;									\
 		}										\
-		SLIST_INSERT_HEAD(&(ctx)->process_list, (current), entries);			\
 		(ctx)->nprocs++;								\
 	} while (0)
 #define PINK_EASY_REMOVE_PROCESS(ctx, current)							\
 	do {											\
-		SLIST_REMOVE(&(ctx)->process_list, (current), pink_easy_process, entries);	\
+		pink_easy_process_list_remove(&(ctx)->process_list, (current));			\
 		if ((current)->userdata_destroy && (current)->userdata) {			\
 			(current)->userdata_destroy((current)->userdata);			\
 		}										\
-		free(current);									\
+		if ((current)->flags & PINK_EASY_PROCESS_PENDING)				\
+			(ctx)->npending--;							\
+		pink_util_forget((current)->pid);						\
+		_pink_easy_process_free((ctx), (current));					\
 		(ctx)->nprocs--;								\
 	} while (0)
 
+bool _pink_easy_process_list_insert(struct pink_easy_process_list *list,
+		struct pink_easy_process *proc);
+void _pink_easy_process_list_destroy(struct pink_easy_process_list *list);
+struct pink_easy_process *_pink_easy_process_alloc(struct pink_easy_context *ctx);
+void _pink_easy_process_free(struct pink_easy_context *ctx, struct pink_easy_process *proc);
+void _pink_easy_process_slabs_destroy(struct pink_easy_context *ctx);
+void _pink_easy_process_detach(struct pink_easy_context *ctx, struct pink_easy_process *proc, int sig);
+
+const struct pink_easy_syscall_handler *_pink_easy_syscall_handler(const struct pink_easy_context *ctx,
+		pink_bitness_t bitness, long scno, int when);
+bool _pink_easy_map_syscall(const struct pink_easy_context *ctx, pink_bitness_t bitness, long scno);
+
+struct sock_filter;
+struct sock_filter *_pink_easy_seccomp_filter(const struct pink_easy_context *ctx,
+		unsigned short *len);
+bool _pink_easy_seccomp_install(struct sock_filter *filter, unsigned short len);
+bool _pink_easy_seize_wait(int fds[2]);
+bool _pink_easy_seize_child(struct pink_easy_context *ctx, pid_t pid, int fds[2]);
+bool _pink_easy_notify_install(struct sock_filter *filter, unsigned short len, int sock);
+bool _pink_easy_notify_listen(struct pink_easy_context *ctx, pid_t pid, int sock[2]);
+void _pink_easy_loop_child(const struct pink_easy_context *ctx);
+pink_arena_t *_pink_easy_thread_arena(bool create);
+
 PINK_END_DECL
 #endif
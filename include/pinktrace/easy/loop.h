@@ -44,6 +44,23 @@ PINK_BEGIN_DECL
 /**
  * The main event loop
  *
+ * @warning The loop waits for any child of the calling thread with
+ *          @e waitpid(2), @c __WALL and @c __WNOTHREAD, since the
+ *          children of tracees are traced before they are known. The
+ *          calling thread must have no children but those it traces: the
+ *          loop would reap the others and their exit status would be lost.
+ *          Fork untraced children from another thread, children of other
+ *          threads are left alone.
+ *
+ * @note While tracees wait for their verdicts, see PINK_EASY_CFLAG_PENDING,
+ *       the loop keeps waiting for the stops of the other tracees and
+ *       pink_easy_process_complete() interrupts the wait by sending
+ *       @e SIGURG to the thread running the loop. The loop installs a
+ *       handler for @e SIGURG the first time it waits so, which replaces
+ *       the handler of the caller, if any; the signal must not be blocked in
+ *       the thread running the loop. The loop does not change the signal
+ *       mask itself.
+ *
  * @param ctx Tracing context
  * @return In case of success, if the "cb_end" callback exists this function
  *         calls it and returns what that callback returns; otherwise this
@@ -54,6 +71,49 @@ PINK_BEGIN_DECL
 int pink_easy_loop(pink_easy_context_t *ctx)
 	PINK_GCC_ATTR((nonnull(1)));
 
+/**
+ * Returns a file descriptor which becomes readable when traced processes
+ * have events pending or verdicts are posted with
+ * pink_easy_process_complete(), for use with poll(2), epoll(7) and the like.
+ * Call pink_easy_loop_step() when it is readable.
+ *
+ * The descriptor is an @e epoll(7) descriptor which watches a
+ * @e signalfd(2) for @e SIGCHLD, blocked by this function in the calling
+ * thread, and an @e eventfd(2) for verdicts. @e SIGCHLD must be blocked in all the
+ * threads of the tracer, otherwise it may be delivered to one of them
+ * instead of the descriptor. Since @e SIGCHLD is sent to the process and not
+ * to the tracing thread, only one thread may use such a descriptor.
+ * Children spawned with pink_easy_call() and
+ * pink_easy_execve() and friends do not inherit the blocked signal. The
+ * descriptor belongs to the context and is closed by
+ * pink_easy_context_destroy().
+ *
+ * @param ctx Tracing context
+ * @return The file descriptor on success, -1 on failure and sets errno
+ *         accordingly
+ **/
+int pink_easy_loop_fd(pink_easy_context_t *ctx)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Handle the events of traced processes which are pending, without blocking.
+ * Use this function instead of pink_easy_loop() to embed tracing into an
+ * event loop of your own, see pink_easy_loop_fd().
+ *
+ * @warning Like pink_easy_loop(), this function reaps any child of the
+ *          calling thread, which must have no children but those it
+ *          traces.
+ *
+ * @param ctx Tracing context
+ * @param retval Pointer to store what pink_easy_loop() would have returned
+ *               once the loop is over, may be NULL
+ * @return true if there are traced processes left, false if the loop is
+ *         over, i.e. all traced processes are gone, a callback aborted or
+ *         an error occurred
+ **/
+bool pink_easy_loop_step(pink_easy_context_t *ctx, int *retval)
+	PINK_GCC_ATTR((nonnull(1)));
+
 PINK_END_DECL
 /** @} */
 #endif
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LpIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _PINK_EASY_NOTIFY_H
+#define _PINK_EASY_NOTIFY_H
+
+/**
+ * @file pinktrace/easy/notify.h
+ * @brief Pink's easy seccomp user notification
+ * @defgroup pink_easy_notify Pink's easy seccomp user notification
+ * @ingroup pinktrace-easy
+ * @{
+ **/
+
+#include <stdbool.h>
+#include <pinktrace/pink.h>
+#include <pinktrace/easy/context.h>
+
+PINK_BEGIN_DECL
+
+/**
+ * Switch the tracing context to seccomp user notification mode.
+ *
+ * In this mode the children spawned by pink_easy_execve() and friends and
+ * pink_easy_call() are not traced with ptrace(2). Instead they install a
+ * seccomp filter which returns @e SECCOMP_RET_USER_NOTIF for the system calls
+ * added with pink_easy_context_seccomp_add() and allows the rest, and hand
+ * the listener file descriptor of the filter to the parent. The
+ * notifications are served with pink_easy_notify_handle() or
+ * pink_easy_notify_loop() which call the "syscall" callback on system call
+ * entry and the system call either continues or, if the callback returns
+ * #PINK_EASY_CFLAG_DENY, fails with @e EPERM. The system call arguments are
+ * available to the callback through pink_util_get_syscall(),
+ * pink_util_get_arg() and friends, the memory of the process should be read
+ * with the functions using @e process_vm_readv(2) as the process is not
+ * stopped by ptrace(2).
+ *
+ * @note Availability: Linux (5.5 or newer, 5.8 or newer for
+ *       pink_easy_notify_loop() to notice the exit of all processes)
+ * @note No processes are added to the process list in this mode and the
+ *       "syscall" callback gets a transient process entry which is only valid
+ *       during the call. The only other callbacks called are "exit" for the
+ *       children spawned by the context, "cleanup" and "error".
+ * @note @e sendmsg(2) must not be in the set of system calls, the child uses
+ *       it to send the listener file descriptor after installing the filter.
+ * @attention The process may change its memory after the callback has read
+ *            it, so the policy must not rely on the contents of writable
+ *            memory for security decisions.
+ *
+ * @param ctx Tracing context
+ * @param notify true to enable, false to disable seccomp user notification
+ * @return true on success, false on failure and sets errno accordingly
+ **/
+bool pink_easy_context_seccomp_notify(pink_easy_context_t *ctx, bool notify)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Returns the listener file descriptor of the last child spawned in seccomp
+ * user notification mode, suitable for @e poll(2).
+ *
+ * @param ctx Tracing context
+ * @return File descriptor or -1 if no child was spawned in this mode
+ **/
+int pink_easy_notify_fd(const pink_easy_context_t *ctx)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Receive and answer one notification from the given listener file
+ * descriptor. This call blocks until a notification is available.
+ *
+ * The core library keeps its system call information per thread so several
+ * threads may serve the same listener at the same time, provided the
+ * callbacks are thread safe. Notifications of processes which died in the
+ * meantime are silently skipped.
+ *
+ * @note Availability: Linux (5.5 or newer)
+ *
+ * @param ctx Tracing context
+ * @param fd Listener file descriptor, see pink_easy_notify_fd()
+ * @return true on success, false on failure and sets the error of the
+ *         context, #PINK_EASY_ERROR_CALLBACK_ABORT if the callback returned
+ *         #PINK_EASY_CFLAG_ABORT
+ **/
+bool pink_easy_notify_handle(pink_easy_context_t *ctx, int fd)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * The event loop of seccomp user notification mode, serves the listeners of
+ * all children spawned by the context until all processes using them exit.
+ *
+ * @attention The exit of the children is collected with @e waitpid(2) for
+ *            any child of the calling thread, which must have no children
+ *            but those spawned by the context, see pink_easy_loop().
+ *
+ * @param ctx Tracing context
+ * @return Same as pink_easy_loop()
+ **/
+int pink_easy_notify_loop(pink_easy_context_t *ctx)
+	PINK_GCC_ATTR((nonnull(1)));
+
+PINK_END_DECL
+/** @} */
+#endif
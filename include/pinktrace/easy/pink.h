@@ -45,6 +45,7 @@
 #include <pinktrace/easy/exec.h>
 #include <pinktrace/easy/func.h>
 #include <pinktrace/easy/loop.h>
+#include <pinktrace/easy/notify.h>
 #include <pinktrace/easy/process.h>
 #include <pinktrace/easy/vm.h>
 
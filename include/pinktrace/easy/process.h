@@ -57,6 +57,61 @@ typedef struct pink_easy_process pink_easy_process_t;
  **/
 typedef struct pink_easy_process_list pink_easy_process_list_t;
 
+/**
+ * @brief Verdict for a tracee left stopped with PINK_EASY_CFLAG_PENDING
+ * @see pink_easy_process_complete()
+ **/
+typedef struct pink_easy_verdict {
+	/**
+	 * Error number the system call fails with, zero to let it proceed.
+	 * At system call exit, the return value is set to the negated error
+	 * number.
+	 **/
+	int error;
+
+	/**
+	 * Bit mask of the arguments to replace with those in @e args, only
+	 * applied at system call entry
+	 **/
+	unsigned args_mask;
+
+	/** New system call arguments **/
+	long args[PINK_MAX_ARGS];
+} pink_easy_verdict_t;
+
+/**
+ * @brief Identifies a stop left pending with PINK_EASY_CFLAG_PENDING
+ * @see pink_easy_process_get_token()
+ **/
+typedef struct pink_easy_token {
+	/** Process ID of the tracee **/
+	pid_t pid;
+
+	/** Serial number of the stop, tells it apart from the stops of a
+	 * process which reuses the process ID later **/
+	unsigned long serial;
+} pink_easy_token_t;
+
+/**
+ * @brief Trace levels of a process
+ * @see pink_easy_process_set_trace_level()
+ **/
+typedef enum {
+	/** Stop at every system call, the level of processes if there is a
+	 * "syscall" callback or system call handlers **/
+	PINK_EASY_TRACE_SYSCALL = 0,
+	/** Stop at ptrace events, exec, fork and pre-exit, but not at system
+	 * calls, the level of processes otherwise **/
+	PINK_EASY_TRACE_EVENTS,
+	/** Stop at neither system calls nor events, except for exec. Children
+	 * of the process are not traced, unless the process runs under the
+	 * seccomp filter: they inherit the filter and are traced at this
+	 * level too. **/
+	PINK_EASY_TRACE_NONE,
+} pink_easy_trace_level_t;
+
+struct pink_easy_context;
+
 /**
  * Kill a process
  *
@@ -79,6 +134,95 @@ int pink_easy_process_kill(const pink_easy_process_t *proc, int sig);
  **/
 bool pink_easy_process_resume(const pink_easy_process_t *proc, int sig);
 
+/**
+ * Post the verdict for a tracee left stopped with PINK_EASY_CFLAG_PENDING.
+ * The tracing thread applies the verdict and resumes the tracee the next
+ * time its event loop runs. Verdicts whose token does not match the stop the
+ * tracee waits at, e.g. because the tracee was killed and its process ID
+ * reused, are ignored.
+ *
+ * @note This function may be called from any thread, it is the only
+ *       function of the tracing context which may be.
+ * @note If the tracing thread uses pink_easy_loop_fd(), @e SIGCHLD should
+ *       be blocked in the posting threads, otherwise the events of the other
+ *       tracees may be noticed late while a tracee is waiting for its verdict.
+ *       If it runs pink_easy_loop(), this function interrupts its wait with
+ *       @e SIGURG, see pink_easy_loop().
+ *
+ * @param ctx Tracing context
+ * @param token Token of the stop, see pink_easy_process_get_token()
+ * @param verdict The verdict, copied
+ * @return true on success, false on failure and sets errno accordingly
+ **/
+bool pink_easy_process_complete(struct pink_easy_context *ctx, pink_easy_token_t token,
+		const pink_easy_verdict_t *verdict)
+	PINK_GCC_ATTR((nonnull(1,3)));
+
+/**
+ * Detach from the process, and optionally from all the threads of its
+ * thread group, the next time it is resumed or stops. Pending register
+ * modifications are written back, a signal which is about to be delivered
+ * is delivered on detach. The "teardown" callback is called and the process
+ * is removed from the process list.
+ *
+ * @note Threads which run are detached at their next stop. Threads attached
+ *       with pink_trace_seize() are interrupted so that they stop, the
+ *       others may not stop before their next system call or event.
+ * @note Call this function from the tracing thread only. Return
+ *       PINK_EASY_CFLAG_DETACH from callbacks to detach the current process
+ *       alone.
+ * @note Processes running under the seccomp filter of the tracing context
+ *       can not be detached from: the filter stays installed and the
+ *       filtered system calls would fail with @e ENOSYS. This function
+ *       fails with @e EBUSY for them, and skips such threads of the group.
+ *
+ * @param ctx Tracing context
+ * @param proc Process entry
+ * @param group true to detach from the other threads of the thread group
+ * @return true on success, false on failure and sets errno accordingly
+ **/
+bool pink_easy_process_detach(const struct pink_easy_context *ctx,
+		pink_easy_process_t *proc, bool group)
+	PINK_GCC_ATTR((nonnull(1,2)));
+
+/**
+ * Set the trace level of the process. The level takes effect when the
+ * process is resumed, children of the process start at the same level.
+ * System calls denied with pink_easy_process_complete() stop at exit
+ * regardless.
+ *
+ * @note The trace level is ignored in seccomp notification mode. Under the
+ *       seccomp filter, the filter still stops the process at system call
+ *       entry but the process is resumed without calling the callbacks.
+ *
+ * @param proc Process entry
+ * @param level Trace level
+ **/
+void pink_easy_process_set_trace_level(pink_easy_process_t *proc,
+		pink_easy_trace_level_t level)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Returns the trace level of the process
+ *
+ * @param proc Process entry
+ * @return Trace level
+ **/
+pink_easy_trace_level_t pink_easy_process_get_trace_level(const pink_easy_process_t *proc)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Returns the token of the current stop of the process, to be passed to
+ * pink_easy_process_complete() if the callback returns
+ * PINK_EASY_CFLAG_PENDING. The token changes when the tracee is resumed
+ * after its verdict is applied.
+ *
+ * @param proc Process entry
+ * @return Token of the current stop
+ **/
+pink_easy_token_t pink_easy_process_get_token(const pink_easy_process_t *proc)
+	PINK_GCC_ATTR((nonnull(1)));
+
 /**
  * Returns the process ID of the entry
  *
@@ -152,6 +296,17 @@ void pink_easy_process_set_userdata(pink_easy_process_t *proc, void *userdata,
 void *pink_easy_process_get_userdata(const pink_easy_process_t *proc)
 	PINK_GCC_ATTR((nonnull(1)));
 
+/**
+ * Get the inline user data of the process entry. The size of the inline user
+ * data is set with pink_easy_context_set_inline_userdata_size(), its contents
+ * are zeroed when the process is added to the context.
+ *
+ * @param proc Process entry
+ * @return Pointer to the inline user data, suitably aligned for any type
+ **/
+void *pink_easy_process_get_inline_userdata(pink_easy_process_t *proc)
+	PINK_GCC_ATTR((nonnull(1)));
+
 /**
  * Remove a process from the process list.
  *
@@ -169,6 +324,9 @@ void pink_easy_process_list_remove(pink_easy_process_list_t *list,
 /**
  * Look up the process list for the given process ID.
  *
+ * @note The process list is a hash table keyed by process ID, look ups take
+ *       constant time on average.
+ *
  * @param list The process list
  * @param pid Process ID
  * @return The process on successful look up, NULL on failure
@@ -44,6 +44,8 @@ PINK_BEGIN_DECL
 /**
  * Transfer data from the remote process (tracee) to the local process (tracer)
  *
+ * @see pink_util_readn()
+ *
  * @param pid Process ID
  * @param addr Address in remote process' address space
  * @param dest Pointer to store the data
@@ -55,6 +57,8 @@ bool pink_easy_process_vm_readv(pid_t pid, long addr, void *dest, size_t len);
 /**
  * Transfer data from the local process (tracer) to the remote process (tracee)
  *
+ * @see pink_util_writen()
+ *
  * @param pid Process ID
  * @param addr Address in remote process' address space
  * @param src Pointer to the data
@@ -99,6 +99,30 @@ typedef enum {
 	PINK_EVENT_EXIT_SIGNAL,
 	/** Unknown event, shouldn't happen **/
 	PINK_EVENT_UNKNOWN,
+	/* Newer events follow, the values above are part of the ABI */
+	/**
+	 * Child has been stopped by a seccomp filter returning
+	 * SECCOMP_RET_TRACE
+	 *
+	 * @note Availability: Linux
+	 **/
+	PINK_EVENT_SECCOMP,
+	/**
+	 * Group-stop of a child attached with pink_trace_seize(), the stopping
+	 * signal is WSTOPSIG(status). Restart the child with
+	 * pink_trace_listen() to keep it stopped.
+	 *
+	 * @note Availability: Linux
+	 **/
+	PINK_EVENT_GROUP_STOP,
+	/**
+	 * Child attached with pink_trace_seize() has been stopped by
+	 * pink_trace_interrupt(), the initial stop of an automatically attached
+	 * child or the end of a group-stop after pink_trace_listen()
+	 *
+	 * @note Availability: Linux
+	 **/
+	PINK_EVENT_INTERRUPT,
 } pink_event_t;
 
 PINK_BEGIN_DECL
@@ -68,18 +68,204 @@
 #undef ia64_fpreg
 #undef pt_all_user_regs
 #endif /* defined(IA64) */
+
+/* Seccomp tracing is new in Linux-3.5, older headers lack the constants */
+#ifndef PTRACE_O_TRACESECCOMP
+#define PTRACE_O_TRACESECCOMP	0x00000080
+#endif /* !PTRACE_O_TRACESECCOMP */
+#ifndef PTRACE_EVENT_SECCOMP
+#define PTRACE_EVENT_SECCOMP	7
+#endif /* !PTRACE_EVENT_SECCOMP */
+
+/* PTRACE_SEIZE and friends are new in Linux-3.4 */
+#ifndef PTRACE_SEIZE
+#define PTRACE_SEIZE		0x4206
+#endif /* !PTRACE_SEIZE */
+#ifndef PTRACE_INTERRUPT
+#define PTRACE_INTERRUPT	0x4207
+#endif /* !PTRACE_INTERRUPT */
+#ifndef PTRACE_LISTEN
+#define PTRACE_LISTEN		0x4208
+#endif /* !PTRACE_LISTEN */
+#ifndef PTRACE_EVENT_STOP
+#define PTRACE_EVENT_STOP	128
+#endif /* !PTRACE_EVENT_STOP */
+
+#ifdef HAVE_SYS_UIO_H
+#include <sys/uio.h>
+#endif /* HAVE_SYS_UIO_H */
 #endif /* PINK_OS_LINUX */
 
 #define ADDR_MUL	((64 == __WORDSIZE) ? 8 : 4)
 
 #include <pinktrace/macros.h>
+#include <pinktrace/arena.h>
 #include <pinktrace/bitness.h>
 #include <pinktrace/socket.h>
+#include <pinktrace/trace.h>
 
 PINK_BEGIN_DECL
 
 bool _pink_decode_socket_address(pid_t pid, long addr, long addrlen,
 		pink_socket_address_t *paddr);
 
+#if PINK_OS_LINUX
+/* Fetch the arguments of socketcall(2) from the tracee with one vectored
+ * read: the file descriptor (word 0), if fd is not NULL, and nargs words
+ * starting at ind. */
+bool _pink_decode_socketcall_args(pid_t pid, pink_bitness_t bitness,
+		long *fd, unsigned ind, long *args, unsigned nargs);
+#endif /* PINK_OS_LINUX */
+
+/* Reserve len bytes at the end of the arena without allocating them, the
+ * first keep bytes of the previous reservation are carried over if it has to
+ * move to another block. */
+char *_pink_arena_reserve(pink_arena_t *arena, size_t len, size_t keep);
+void _pink_arena_commit(pink_arena_t *arena, size_t len);
+
+#if PINK_OS_LINUX
+#if defined(I386) || defined(X86_64)
+#include <sys/user.h>
+/* The USER area starts with the general purpose registers, so word offsets
+ * used with PTRACE_PEEKUSER index struct user_regs_struct directly. */
+#define PINK_TRACEE_HAVE_REGS		1
+#endif
+
+/** process_vm_readv(2) is not permitted for this tracee **/
+#define PINK_TRACEE_VM_NOREADV		00001
+/** Register snapshot is valid for this stop **/
+#define PINK_TRACEE_REGS		00002
+/** System call information is valid for this stop **/
+#define PINK_TRACEE_INFO		00004
+/** System call number seen at the last system call entry is valid **/
+#define PINK_TRACEE_ENTRY_SCNO		00010
+/** process_vm_writev(2) is not permitted for this tracee **/
+#define PINK_TRACEE_VM_NOWRITEV		00020
+
+/** Flags which are only valid until the tracee is resumed **/
+#define PINK_TRACEE_STOP_MASK		(PINK_TRACEE_REGS | PINK_TRACEE_INFO)
+
+/** Number of pages kept by a read cache **/
+#define PINK_CACHE_PAGES		4
+/** Number of hash buckets for the strings kept by a read cache **/
+#define PINK_CACHE_STRING_BUCKETS	256
+/** Maximum number of strings kept by a read cache **/
+#define PINK_CACHE_STRINGS_MAX		4096
+
+/** Mapping is read-only, private and file-backed **/
+#define PINK_CACHE_MAP_IMMUTABLE	00100
+
+/** Address range of a mapping **/
+struct pink_cache_map {
+	unsigned long start, end;
+
+	/** PROT_* flags and PINK_CACHE_MAP_IMMUTABLE **/
+	int flags;
+};
+
+/** String read from a read-only, private, file-backed mapping **/
+struct pink_cache_string {
+	struct pink_cache_string *next;
+
+	/** Address of the string in the tracee **/
+	unsigned long addr;
+
+	/** Length of the string, not including the zero-byte **/
+	size_t len;
+
+	char str[];
+};
+
+/** Read cache, see pink_util_cache_enable() **/
+struct pink_cache {
+	/** Number of tracees using the cache **/
+	unsigned refs;
+
+	/** Bit mask of the valid slots **/
+	unsigned valid;
+
+	/** Slot to replace next **/
+	unsigned next;
+
+	/** Page addresses of the slots **/
+	unsigned long addr[PINK_CACHE_PAGES];
+
+	/** Page data of the slots, allocated on the first miss **/
+	char *data;
+
+	/** Statistics **/
+	unsigned long hits, misses;
+
+	/** Mappings sorted by address, parsed on demand **/
+	bool maps_valid;
+	size_t nmaps;
+	struct pink_cache_map *maps;
+
+	/** Strings read from immutable mappings, hashed by address, kept only
+	 * if enabled with pink_util_cache_strings() **/
+	bool keep_strings;
+	unsigned nstrings;
+	struct pink_cache_string **strings;
+};
+
+/** Per-tracee state, see pink-linux-tracee.c **/
+struct pink_tracee {
+	/** Process ID of the tracee **/
+	pid_t pid;
+
+	/** PINK_TRACEE_* flags **/
+	unsigned flags;
+
+#ifdef PINK_TRACEE_HAVE_REGS
+	/** Register snapshot, see pink_util_regs_snapshot() **/
+	struct user_regs_struct regs;
+
+	/** Words of the snapshot modified since it was taken **/
+	unsigned long regs_dirty;
+#endif
+
+	/** System call information, see pink_trace_get_syscall_info() **/
+	pink_syscall_info_t info;
+
+	/** System call number seen at the last system call entry **/
+	long entry_scno;
+
+	/** Read cache, may be shared with other tracees **/
+	struct pink_cache *cache;
+
+	struct pink_tracee *next;
+};
+
+struct pink_tracee *_pink_tracee_lookup(pid_t pid);
+struct pink_tracee *_pink_tracee_get(pid_t pid);
+void _pink_tracee_remove(pid_t pid);
+bool _pink_tracee_flush(struct pink_tracee *tracee);
+bool _pink_tracee_resume(pid_t pid, bool syscall);
+bool _pink_tracee_release(pid_t pid, bool flush);
+const pink_syscall_info_t *_pink_tracee_info(pid_t pid);
+void _pink_tracee_invalidate(pid_t pid, long addr, size_t len);
+
+/* Memory map index and strings in immutable mappings, see pink-linux-maps.c.
+ * _pink_cache_maps_extent() returns how many of the len bytes at addr are
+ * mapped contiguously with all the given flags. */
+size_t _pink_cache_maps_extent(pid_t pid, struct pink_cache *cache, long addr,
+		size_t len, int flags);
+const struct pink_cache_string *_pink_cache_string_lookup(struct pink_cache *cache,
+		long addr);
+void _pink_cache_string_insert(pid_t pid, struct pink_cache *cache, long addr,
+		const char *str, size_t len);
+void _pink_cache_written(struct pink_cache *cache, long addr, size_t len);
+void _pink_cache_forget_maps(struct pink_cache *cache);
+
+/* Size of a page, looked up by whichever tracing thread needs it first */
+size_t _pink_util_pagesize(void);
+
+/* process_vm_readv(2), fails with ENOSYS if it can not be used for the
+ * tracee and pink_util_readn() should be used instead. */
+ssize_t _pink_util_vm_readv(pid_t pid, const struct iovec *local,
+		unsigned long liovcnt, const struct iovec *remote,
+		unsigned long riovcnt);
+#endif /* PINK_OS_LINUX */
+
 PINK_END_DECL
 #endif
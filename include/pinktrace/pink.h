@@ -59,6 +59,7 @@
 #include <pinktrace/macros.h>
 
 #include <pinktrace/about.h>
+#include <pinktrace/arena.h>
 #include <pinktrace/bitness.h>
 #include <pinktrace/decode.h>
 #include <pinktrace/encode.h>
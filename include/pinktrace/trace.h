@@ -37,8 +37,11 @@
  **/
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <sys/types.h>
 #include <pinktrace/macros.h>
+#include <pinktrace/bitness.h>
+#include <pinktrace/system.h>
 
 #if PINK_OS_LINUX || defined(DOXYGEN)
 /**
@@ -116,6 +119,18 @@
  * @note Availability: Linux
  **/
 #define PINK_TRACE_OPTION_EXIT      (1 << 6)
+/**
+ * This define represents the trace option SECCOMP.
+ * If this flag is set in the options argument of pink_trace_setup(), stop the
+ * child with (SIGTRAP | PTRACE_EVENT_SECCOMP << 8) when a seccomp filter
+ * returns @e SECCOMP_RET_TRACE. The @e SECCOMP_RET_DATA part of the filter's
+ * return value can be retrieved with pink_trace_geteventmsg().
+ *
+ * @note Availability: Linux (3.5 or newer)
+ * @note This option is not part of #PINK_TRACE_OPTION_ALL because older
+ *       kernels reject it.
+ **/
+#define PINK_TRACE_OPTION_SECCOMP   (1 << 7)
 
 /**
  * All trace options OR'ed together.
@@ -131,6 +146,67 @@
 	 PINK_TRACE_OPTION_VFORK_DONE |\
 	 PINK_TRACE_OPTION_EXIT)
 
+/**
+ * System call information operations
+ *
+ * @note Availability: Linux
+ * @see pink_trace_get_syscall_info()
+ **/
+typedef enum {
+	/** The process is not stopped at a system call **/
+	PINK_SYSCALL_INFO_NONE = 0,
+	/** The process is stopped at a system call entry **/
+	PINK_SYSCALL_INFO_ENTRY,
+	/** The process is stopped at a system call exit **/
+	PINK_SYSCALL_INFO_EXIT,
+	/** The process is stopped by a seccomp filter returning SECCOMP_RET_TRACE **/
+	PINK_SYSCALL_INFO_SECCOMP,
+} pink_syscall_info_op_t;
+
+/**
+ * System call information of a stopped process
+ *
+ * @note Availability: Linux
+ * @see pink_trace_get_syscall_info()
+ **/
+typedef struct {
+	/** Type of the stop, one of PINK_SYSCALL_INFO_* constants **/
+	pink_syscall_info_op_t op;
+
+	/** Architecture of the system call, one of AUDIT_ARCH_* constants **/
+	uint32_t arch;
+
+	/**
+	 * Bitness of the system call, #PINK_BITNESS_UNKNOWN if the architecture
+	 * is not known to pinktrace
+	 **/
+	pink_bitness_t bitness;
+
+	/** Instruction pointer **/
+	long ip;
+
+	/** Stack pointer **/
+	long sp;
+
+	/**
+	 * System call number, on system call exit this is the number seen at the
+	 * system call entry
+	 **/
+	long scno;
+
+	/** System call arguments, valid on entry and seccomp stops **/
+	long args[PINK_MAX_ARGS];
+
+	/** Return value, valid on exit stops **/
+	long ret;
+
+	/** True if the return value is an error, valid on exit stops **/
+	bool is_error;
+
+	/** SECCOMP_RET_DATA of the filter, valid on seccomp stops **/
+	uint32_t ret_data;
+} pink_syscall_info_t;
+
 #endif /* PINK_OS_LINUX... */
 
 PINK_BEGIN_DECL
@@ -281,6 +357,46 @@ bool pink_trace_geteventmsg(pid_t pid, unsigned long *data);
  **/
 bool pink_trace_setup(pid_t pid, int options);
 
+/**
+ * Attaches to the process specified in pid like pink_trace_attach() but does
+ * not stop the process and sets the tracing options at once. The children
+ * which are attached automatically, see #PINK_TRACE_OPTION_FORK, inherit the
+ * options and their first stop is #PINK_EVENT_INTERRUPT instead of @e SIGSTOP.
+ * Group-stops of such processes are reported as #PINK_EVENT_GROUP_STOP.
+ *
+ * @note Availability: Linux (3.4 or newer)
+ *
+ * @param pid Process ID
+ * @param options Bitwise OR'ed PINK_TRACE_OPTION_* flags
+ * @return true on success, false on failure and sets errno accordingly
+ **/
+bool pink_trace_seize(pid_t pid, int options);
+
+/**
+ * Stops a process attached with pink_trace_seize(), the stop is reported as
+ * #PINK_EVENT_INTERRUPT.
+ *
+ * @note Availability: Linux (3.4 or newer)
+ *
+ * @param pid Process ID
+ * @return true on success, false on failure and sets errno accordingly
+ **/
+bool pink_trace_interrupt(pid_t pid);
+
+/**
+ * Restarts a process attached with pink_trace_seize() which is in
+ * group-stop, see #PINK_EVENT_GROUP_STOP, but keeps it stopped until it
+ * receives @e SIGCONT. Unlike the other restarting requests this keeps the
+ * process stopped as job control expects, the tracer is notified when the
+ * group-stop ends.
+ *
+ * @note Availability: Linux (3.4 or newer)
+ *
+ * @param pid Process ID
+ * @return true on success, false on failure and sets errno accordingly
+ **/
+bool pink_trace_listen(pid_t pid);
+
 /**
  * Restarts the stopped child process and arranges it to be stopped after
  * the entry of the next system call which will *not* be executed.
@@ -307,6 +423,30 @@ bool pink_trace_sysemu(pid_t pid, int sig);
  **/
 bool pink_trace_sysemu_singlestep(pid_t pid, int sig);
 
+/**
+ * Retrieve information about the system call which caused the stop with a
+ * single @e PTRACE_GET_SYSCALL_INFO request. The information is kept until
+ * the process is resumed with one of the pink_trace_*() functions, and
+ * pink_bitness_get(), pink_util_get_syscall(), pink_util_get_arg(),
+ * pink_util_get_return() and the decoders built on them use it instead of
+ * peeking at the registers of the process.
+ *
+ * Whether the process is entering or exiting the system call is decided by
+ * the kernel, so unlike toggling a flag on every system call stop this can
+ * not get out of sync.
+ *
+ * @note Availability: Linux (5.3 or newer)
+ * @note If the kernel does not support the request, this function fails and
+ *       sets errno to @e ENOSYS. Later calls fail without calling ptrace(2).
+ * @note Tracing option #PINK_TRACE_OPTION_SYSGOOD must be set for the kernel
+ *       to tell system call stops apart.
+ *
+ * @param pid Process ID
+ * @param info Pointer to store the information
+ * @return true on success, false on failure and sets errno accordingly
+ **/
+bool pink_trace_get_syscall_info(pid_t pid, pink_syscall_info_t *info);
+
 #endif /* PINK_OS_LINUX... */
 
 /**
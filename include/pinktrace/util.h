@@ -39,6 +39,8 @@
 #include <stdbool.h>
 #include <sys/types.h>
 #include <pinktrace/macros.h>
+#include <pinktrace/arena.h>
+#include <pinktrace/trace.h>
 
 PINK_BEGIN_DECL
 
@@ -47,7 +49,8 @@ PINK_BEGIN_DECL
  * process's instruction space and places it in res, aka PT_READ_I.
  *
  * On Linux this reads a word at the given offset in the child's USER area, and
- * places it in res, aka PTRACE_PEEKUSER.
+ * places it in res, aka PTRACE_PEEKUSER. If a register snapshot was taken with
+ * pink_util_regs_snapshot(), the word is read from the snapshot.
  *
  * @warning Mostly for internal use, use higher level functions where possible.
  *
@@ -79,7 +82,10 @@ bool pink_util_peekdata(pid_t pid, long off, long *res);
  * traced process's instruction space, aka PT_WRITE_I.
  *
  * On Linux this copies the word val to the given offset in the child's USER
- * area, aka PTRACE_POKEUSER.
+ * area, aka PTRACE_POKEUSER. If a register snapshot was taken with
+ * pink_util_regs_snapshot(), the word is written to the snapshot instead and
+ * the modified registers are written back with a single @e PTRACE_SETREGS
+ * request when the process is resumed.
  *
  * @warning Mostly for internal use, use higher level functions where possible.
  *
@@ -126,10 +132,305 @@ bool pink_util_get_regs(pid_t pid, void *regs);
  **/
 bool pink_util_set_regs(pid_t pid, const void *regs);
 
+#if PINK_OS_LINUX || defined(DOXYGEN)
+/**
+ * Read up to len bytes of data of process pid, at address addr, to our address
+ * space dest.
+ *
+ * This function uses @e process_vm_readv(2) to read the whole range at once and
+ * stops at the first inaccessible page. If the kernel doesn't implement
+ * @e process_vm_readv(2) (ENOSYS) or it isn't permitted for the given process
+ * (EPERM) the data is read one word at a time using pink_util_peekdata().
+ * The latter is remembered per process, see pink_util_forget().
+ * Reads of at most a page are served from the read cache of the process, if
+ * it has one, see pink_util_cache_enable().
+ *
+ * @note Availability: Linux
+ * @warning Mostly for internal use, use higher level functions where possible.
+ *
+ * @param pid Process ID
+ * @param addr Address where the data is to be moved from.
+ * @param dest Pointer to store the data.
+ * @param len Number of bytes of data to move.
+ * @return Number of bytes read, which is less than len if the range crosses
+ *         into unmapped memory, or -1 on failure and sets errno accordingly
+ **/
+ssize_t pink_util_readn(pid_t pid, long addr, char *dest, size_t len);
+
+/**
+ * A read request of pink_util_readv()
+ *
+ * @note Availability: Linux
+ **/
+typedef struct {
+	/** Address in the process to read from **/
+	long addr;
+
+	/** Pointer to store the data **/
+	char *dest;
+
+	/** Number of bytes to read **/
+	size_t len;
+
+	/**
+	 * Number of bytes read, less than len if the range crosses into
+	 * unmapped memory, -1 if nothing could be read
+	 **/
+	ssize_t count;
+} pink_util_iovec_t;
+
+/**
+ * Serve several read requests of process pid at once.
+ *
+ * The requests are read with as few @e process_vm_readv(2) calls as possible.
+ * A request which runs into an inaccessible page ends there, the remaining
+ * requests are read with the next call. If @e process_vm_readv(2) can not be
+ * used, every request is read with pink_util_readn(). If the process has a
+ * read cache, its memory map tells where each request ends beforehand.
+ *
+ * @note Availability: Linux
+ * @warning Mostly for internal use, use higher level functions where possible.
+ *
+ * @param pid Process ID
+ * @param iov Array of read requests, the count member of each request is set
+ *            to the result of the request
+ * @param iovcnt Number of read requests
+ * @return true on success, false on failure and sets errno accordingly.
+ *         Inaccessible memory is no failure, check the count members.
+ **/
+bool pink_util_readv(pid_t pid, pink_util_iovec_t *iov, unsigned iovcnt)
+	PINK_GCC_ATTR((nonnull(2)));
+
+/**
+ * Read the zero-terminated string of process pid, at address addr, to our
+ * address space dest.
+ *
+ * The string is read with pink_util_readn() up to the next page boundary at a
+ * time and the zero-byte is looked for in the data read, so short strings
+ * usually take a single system call. The result is always zero-terminated.
+ *
+ * @note Availability: Linux
+ * @warning Mostly for internal use, use higher level functions where possible.
+ *
+ * @param pid Process ID
+ * @param addr Address of the string
+ * @param dest Pointer to store the string
+ * @param len Size of dest, at most len - 1 bytes of the string are read
+ * @param truncated Set to true if the string does not fit into dest or runs
+ *                  into inaccessible memory, false otherwise
+ * @return Length of the string read, or -1 on failure and sets errno
+ *         accordingly
+ **/
+ssize_t pink_util_readstr(pid_t pid, long addr, char *dest, size_t len, bool *truncated)
+	PINK_GCC_ATTR((nonnull(5)));
+
+/**
+ * Forget the per-process state pinktrace keeps for the given process.
+ * Call this function after the process has exited or has been detached, so
+ * that the state isn't applied to a new process with the same process ID.
+ *
+ * @note Availability: Linux
+ *
+ * @param pid Process ID
+ **/
+void pink_util_forget(pid_t pid);
+
+/**
+ * Enable or disable the read cache of the given process.
+ *
+ * The read cache keeps the last few pages read by pink_util_readn() and the
+ * functions built on it, like pink_util_moven() and pink_util_movestr(), so
+ * reading the same pages again during one stop makes no system call. The
+ * cache is invalidated when the process is resumed with one of the
+ * pink_trace_* functions and when its memory is written with pinktrace.
+ * The cache is dropped by pink_util_forget(). Pages are only cached while
+ * @e process_vm_readv(2) can be used for the process, filling them with
+ * @e PTRACE_PEEKDATA would cost more than the cache saves.
+ *
+ * Strings read with pink_util_movestr() and friends may be kept across stops
+ * as well, see pink_util_cache_strings().
+ *
+ * @note Availability: Linux
+ * @see pink_util_cache_share()
+ *
+ * @param pid Process ID
+ * @param enable true to enable the cache, false to disable it
+ * @return true on success, false on failure and sets errno accordingly
+ **/
+bool pink_util_cache_enable(pid_t pid, bool enable);
+
+/**
+ * Make the process pid use the read cache of the process owner, enabling it
+ * if needed. Use this for threads which share their address space, e.g.
+ * created with CLONE_VM, so that pages read from one of them are served
+ * to all of them while they are stopped. Resuming any of them invalidates
+ * the cache. The others may write to the shared memory while one is
+ * stopped, call pink_util_cache_invalidate() whenever any of them stops.
+ *
+ * @note Availability: Linux
+ *
+ * @param pid Process ID
+ * @param owner Process ID of the process whose read cache is to be shared
+ * @return true on success, false on failure and sets errno accordingly
+ **/
+bool pink_util_cache_share(pid_t pid, pid_t owner);
+
+/**
+ * Forget the pages kept by the read cache of the given process, which is
+ * shared with the processes using it, see pink_util_cache_share(). Strings
+ * kept from immutable mappings and the memory map are kept. Call this
+ * function when a process sharing the cache stops, pages read while it was
+ * running may be stale.
+ *
+ * @note Availability: Linux
+ *
+ * @param pid Process ID
+ **/
+void pink_util_cache_invalidate(pid_t pid);
+
+/**
+ * Get the statistics of the read cache of the given process. The counters
+ * are kept per cache, i.e. shared processes share the counters as well.
+ *
+ * @note Availability: Linux
+ *
+ * @param pid Process ID
+ * @param hits Pointer to store the number of page lookups served from the
+ *             cache,
+ *             may be NULL
+ * @param misses Pointer to store the number of pages read into the cache,
+ *               may be NULL
+ * @return true on success, false on failure and sets errno accordingly,
+ *         ENOENT if the process has no read cache
+ **/
+bool pink_util_cache_stats(pid_t pid, unsigned long *hits, unsigned long *misses);
+
+/**
+ * Keep the strings read with pink_util_movestr() and friends from read-only,
+ * private, file-backed mappings, e.g. the read-only data of the executable
+ * and its libraries, across stops in the read cache of the given process.
+ * They are served without reading the memory of the process again until
+ * pink_util_cache_invalidate_maps() is called, which must be done whenever
+ * the memory map of the process may have changed. The setting belongs to the
+ * cache, processes sharing it share the setting as well.
+ *
+ * @warning Such mappings are not immutable: writing to the mapped file, or
+ *          to the memory of the process through /proc/pid/mem, changes them
+ *          without the tracer noticing. The strings served from the cache
+ *          may then differ from what the process sees, do not base security
+ *          decisions on them.
+ *
+ * @note Availability: Linux
+ *
+ * @param pid Process ID
+ * @param enable true to keep strings, false to forget them and stop keeping
+ *               them
+ * @return true on success, false on failure and sets errno accordingly,
+ *         ENOENT if the process has no read cache
+ **/
+bool pink_util_cache_strings(pid_t pid, bool enable);
+
+/**
+ * Forget the memory map of the given process and the strings its read cache
+ * keeps from immutable mappings, if any. Call this function on exit from the system
+ * calls which change the memory map, i.e. @e munmap, @e mprotect,
+ * @e mremap, @e mmap and @e brk, and after @e execve unless the cache is
+ * replaced. The memory map is read from /proc again when needed.
+ *
+ * @note Availability: Linux
+ * @note Modifying a file changes its private mappings as well, strings read
+ *       from a file modified while mapped may be stale.
+ *
+ * @param pid Process ID
+ **/
+void pink_util_cache_invalidate_maps(pid_t pid);
+
+/**
+ * Check whether the given range of the memory of process pid is mapped with
+ * the given protection, using the memory map kept by the read cache of the
+ * process. No ptrace request is made, the memory map is read from /proc
+ * once, see pink_util_cache_invalidate_maps().
+ *
+ * @note Availability: Linux
+ *
+ * @param pid Process ID
+ * @param addr Start of the range
+ * @param len Length of the range
+ * @param prot Bitwise OR'ed PROT_READ, PROT_WRITE and PROT_EXEC flags
+ * @return true if the whole range is mapped with at least the given
+ *         protection, false otherwise and sets errno accordingly, EFAULT if
+ *         it is not and ENOENT if the process has no read cache
+ **/
+bool pink_util_cache_mapped(pid_t pid, long addr, size_t len, int prot);
+
+/**
+ * Take a snapshot of the general purpose registers of the stopped process with
+ * a single @e PTRACE_GETREGS request. Until the process is resumed with one of
+ * the pink_trace_*() functions, pink_util_peek() and all the functions built on
+ * it, e.g. pink_util_get_arg(), pink_util_get_syscall(), pink_bitness_get()
+ * and the decoders, read from the snapshot instead of issuing a
+ * @e PTRACE_PEEKUSER request per register.
+ *
+ * @note Availability: Linux
+ * @note On architectures other than x86 and x86_64 this function does nothing
+ *       and returns true.
+ * @warning If you resume the process without using pink_trace_*() functions,
+ *          call pink_util_regs_flush() and pink_util_regs_invalidate()
+ *          yourself.
+ *
+ * @param pid Process ID
+ * @return true on success, false on failure and sets errno accordingly
+ **/
+bool pink_util_regs_snapshot(pid_t pid);
+
+/**
+ * Write back the registers modified since pink_util_regs_snapshot() with a
+ * single @e PTRACE_SETREGS request. The pink_trace_*() functions which resume
+ * or detach the process call this function implicitly, pink_trace_kill()
+ * discards the modifications.
+ *
+ * @note Availability: Linux
+ *
+ * @param pid Process ID
+ * @return true on success, false on failure and sets errno accordingly
+ **/
+bool pink_util_regs_flush(pid_t pid);
+
+/**
+ * Set the system call information of the process, as if it was retrieved
+ * with pink_trace_get_syscall_info(). This is useful when the information
+ * comes from elsewhere, e.g. a seccomp user notification, so that
+ * pink_util_get_syscall(), pink_util_get_arg() and the decoders work for a
+ * process which is not stopped by ptrace(2). The bitness is worked out from
+ * the architecture. Use pink_util_forget() to drop the information.
+ *
+ * @note Availability: Linux
+ *
+ * @param pid Process ID
+ * @param info System call information
+ * @return true on success, false on failure and sets errno accordingly
+ **/
+bool pink_util_set_syscall_info(pid_t pid, const pink_syscall_info_t *info)
+	PINK_GCC_ATTR((nonnull(2)));
+
+/**
+ * Invalidate the register snapshot taken by pink_util_regs_snapshot().
+ * Modifications which were not written back with pink_util_regs_flush() are
+ * discarded.
+ *
+ * @note Availability: Linux
+ *
+ * @param pid Process ID
+ **/
+void pink_util_regs_invalidate(pid_t pid);
+#endif /* PINK_OS_LINUX... */
+
 /**
  * Move len bytes of data of process pid, at address addr, to our address space
  * dest.
  *
+ * @note On Linux this function is a wrapper around pink_util_readn() and
+ *       succeeds if at least some of the data could be read.
  * @warning Mostly for internal use, use higher level functions where possible.
  *
  * @param pid Process ID
@@ -153,6 +454,7 @@ bool pink_util_moven(pid_t pid, long addr, char *dest, size_t len);
  * Like pink_util_moven() but make the additional effort of looking for a
  * terminating zero-byte.
  *
+ * @note On Linux the data is read a page at a time, see pink_util_readstr()
  * @note On FreeBSD this function is equivalent to pink_util_moven()
  * @note Mostly for internal use, use higher level functions where possible
  **/
@@ -168,10 +470,23 @@ bool pink_util_movestr(pid_t pid, long addr, char *dest, size_t len);
 char *pink_util_movestr_persistent(pid_t pid, long addr)
 	PINK_GCC_ATTR((malloc));
 
+/**
+ * Like pink_util_movestr_persistent() but allocates the string from the
+ * given decode arena, the string must not be freed.
+ *
+ * @warning Mostly for internal use, use higher level functions where possible.
+ *
+ * @return The string on success and NULL on failure and sets errno accordingly
+ **/
+char *pink_util_movestr_arena(pid_t pid, long addr, pink_arena_t *arena)
+	PINK_GCC_ATTR((nonnull(3)));
+
 /**
  * Copy len bytes of data to process pid, at address addr, from our address space
  * src.
  *
+ * @note On Linux this function is a wrapper around pink_util_writen() which
+ *       fails unless all the data is written.
  * @warning Mostly for internal use, use higher level functions where possible.
  *
  * @param pid Process ID
@@ -192,10 +507,40 @@ bool pink_util_putn(pid_t pid, long addr, const char *src, size_t len);
 	pink_util_putn((pid), (addr), (const char *)(objp), sizeof *(objp))
 
 #if PINK_OS_LINUX || defined(DOXYGEN)
+/**
+ * Write up to len bytes of data to process pid, at address addr, from our
+ * address space src.
+ *
+ * This function uses @e process_vm_writev(2) to write the whole range at
+ * once. The part of the range @e process_vm_writev(2) refuses, e.g. because
+ * it is mapped read-only, is written one word at a time using
+ * pink_util_pokedata(), checking once per page that the memory is readable,
+ * or with the memory map of the read cache, if the process has one.
+ * If the kernel doesn't implement @e process_vm_writev(2) (ENOSYS) or it isn't
+ * permitted for the given process (EPERM) the whole range is written with
+ * pink_util_pokedata(). The latter is remembered per process, see
+ * pink_util_forget().
+ *
+ * @note Availability: Linux
+ * @warning Mostly for internal use, use higher level functions where possible.
+ *
+ * @param pid Process ID
+ * @param addr Address where the data is to be copied to
+ * @param src Pointer to the data to be moved
+ * @param len Length of data
+ * @return Number of bytes written, which is less than len if the range
+ *         crosses into unmapped memory, or -1 on failure and sets errno
+ *         accordingly
+ **/
+ssize_t pink_util_writen(pid_t pid, long addr, const char *src, size_t len);
+
 /**
  * Like pink_util_putn() but make the additional effort not to overwrite
  * unreadable addresses. Use this e.g. to write strings safely.
  *
+ * @note This function is a wrapper around pink_util_writen() which fails
+ *       unless all the data is written.
+ *
  * @note Availability: Linux
  * @warning Mostly for internal use, use higher level functions where possible.
  *
@@ -81,6 +81,9 @@ event_init(PyObject *mod)
 	PyModule_AddIntConstant(mod, "EVENT_GENUINE", PINK_EVENT_GENUINE);
 	PyModule_AddIntConstant(mod, "EVENT_EXIT_GENUINE", PINK_EVENT_EXIT_GENUINE);
 	PyModule_AddIntConstant(mod, "EVENT_EXIT_SIGNAL", PINK_EVENT_EXIT_SIGNAL);
+	PyModule_AddIntConstant(mod, "EVENT_SECCOMP", PINK_EVENT_SECCOMP);
+	PyModule_AddIntConstant(mod, "EVENT_GROUP_STOP", PINK_EVENT_GROUP_STOP);
+	PyModule_AddIntConstant(mod, "EVENT_INTERRUPT", PINK_EVENT_INTERRUPT);
 	PyModule_AddIntConstant(mod, "EVENT_UNKNOWN", PINK_EVENT_UNKNOWN);
 }
 
@@ -456,6 +456,7 @@ trace_init(
 	PyModule_AddIntConstant(mod, "OPTION_EXEC", PINK_TRACE_OPTION_EXEC);
 	PyModule_AddIntConstant(mod, "OPTION_VFORK_DONE", PINK_TRACE_OPTION_VFORK_DONE);
 	PyModule_AddIntConstant(mod, "OPTION_EXIT", PINK_TRACE_OPTION_EXIT);
+	PyModule_AddIntConstant(mod, "OPTION_SECCOMP", PINK_TRACE_OPTION_SECCOMP);
 	PyModule_AddIntConstant(mod, "OPTION_ALL", PINK_TRACE_OPTION_ALL);
 #endif /* PINK_OS_LINUX */
 }
@@ -231,6 +231,16 @@ Init_PinkTrace(void)
 	 * cannot prevent the exit from happening at this point.
 	 */
 	rb_define_const(trace_mod, "OPTION_EXIT", INT2FIX(PINK_TRACE_OPTION_EXIT));
+	/*
+	 * Document-const: PinkTrace::Trace::OPTION_SECCOMP
+	 * (Availability: Linux)
+	 *
+	 * This constant represents the trace option +SECCOMP+. If this flag is
+	 * set in the options argument of PinkTrace::Trace.setup, stop the child
+	 * with (SIGTRAP | PTRACE_EVENT_SECCOMP << 8) when a seccomp filter
+	 * returns SECCOMP_RET_TRACE. This option is not part of +OPTION_ALL+.
+	 */
+	rb_define_const(trace_mod, "OPTION_SECCOMP", INT2FIX(PINK_TRACE_OPTION_SECCOMP));
 	/*
 	 * Document-const: PinkTrace::Trace::OPTION_EXIT
 	 * (Availability: Linux)
@@ -332,6 +342,30 @@ Init_PinkTrace(void)
 	 * The traced child has been terminated with a signal.
 	 */
 	rb_define_const(event_mod, "EVENT_EXIT_SIGNAL", INT2FIX(PINK_EVENT_EXIT_SIGNAL));
+	/*
+	 * Document-const: PinkTrace::Event::EVENT_SECCOMP
+	 * (Availability: Linux)
+	 *
+	 * The traced child has been stopped by a seccomp filter returning
+	 * SECCOMP_RET_TRACE.
+	 */
+	rb_define_const(event_mod, "EVENT_SECCOMP", INT2FIX(PINK_EVENT_SECCOMP));
+	/*
+	 * Document-const: PinkTrace::Event::EVENT_GROUP_STOP
+	 * (Availability: Linux)
+	 *
+	 * Group-stop of a traced child attached with PTRACE_SEIZE.
+	 */
+	rb_define_const(event_mod, "EVENT_GROUP_STOP", INT2FIX(PINK_EVENT_GROUP_STOP));
+	/*
+	 * Document-const: PinkTrace::Event::EVENT_INTERRUPT
+	 * (Availability: Linux)
+	 *
+	 * The traced child attached with PTRACE_SEIZE has been stopped by
+	 * PTRACE_INTERRUPT, or this is the first stop of an automatically
+	 * attached child.
+	 */
+	rb_define_const(event_mod, "EVENT_INTERRUPT", INT2FIX(PINK_EVENT_INTERRUPT));
 	/*
 	 * Document-const: PinkTrace::Event::EVENT_UNKNOWN
 	 *
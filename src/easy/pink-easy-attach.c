@@ -30,6 +30,7 @@
 #include <pinktrace/easy/pink.h>
 
 #include <assert.h>
+#include <errno.h>
 #include <stdarg.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -41,17 +42,23 @@ bool pink_easy_attach(pink_easy_context_t *ctx, pid_t pid, pid_t ppid)
 {
 	struct pink_easy_process *current;
 
-	if (!pink_trace_attach(pid)) {
+	bool seize = ctx->options & PINK_EASY_OPTION_SEIZE;
+
+	if (seize ? !(pink_trace_seize(pid, ctx->ptrace_options) && pink_trace_interrupt(pid))
+			: !pink_trace_attach(pid)) {
 		ctx->callback_table.error(ctx, PINK_EASY_ERROR_ATTACH, pid);
 		goto fail;
 	}
 
-	PINK_EASY_INSERT_PROCESS(ctx, current);
+	PINK_EASY_INSERT_PROCESS(ctx, current, pid);
 	if (current == NULL)
 		goto fail;
 
 	current->ppid = ppid;
-	current->flags |= PINK_EASY_PROCESS_ATTACHED | PINK_EASY_PROCESS_IGNORE_ONE_SIGSTOP;
+	current->flags |= PINK_EASY_PROCESS_ATTACHED | PINK_EASY_PROCESS_STARTUP;
+	/* PTRACE_SEIZE does not stop the process, PTRACE_INTERRUPT does
+	 * without a signal. */
+	current->flags |= seize ? PINK_EASY_PROCESS_SEIZED : PINK_EASY_PROCESS_IGNORE_ONE_SIGSTOP;
 	if (current->ppid > 0) /* clone */
 		current->flags |= PINK_EASY_PROCESS_CLONE_THREAD;
 	return true;
@@ -59,3 +66,38 @@ fail:
 	kill(pid, SIGCONT);
 	return false;
 }
+
+/* Runs in the child: wait until the parent has seized us */
+bool _pink_easy_seize_wait(int fds[2])
+{
+	char c;
+	ssize_t r;
+
+	close(fds[1]);
+	do {
+		r = read(fds[0], &c, 1);
+	} while (r < 0 && errno == EINTR);
+	close(fds[0]);
+
+	return r == 1;
+}
+
+/* Runs in the parent: seize the child and let it go on */
+bool _pink_easy_seize_child(pink_easy_context_t *ctx, pid_t pid, int fds[2])
+{
+	char c = 0;
+	bool r;
+
+	close(fds[0]);
+	r = pink_trace_seize(pid, ctx->ptrace_options)
+		&& pink_trace_interrupt(pid)
+		&& write(fds[1], &c, 1) == 1;
+	close(fds[1]);
+	if (!r) {
+		ctx->callback_table.error(ctx, PINK_EASY_ERROR_ATTACH, pid);
+		kill(pid, SIGKILL);
+		waitpid(pid, NULL, __WALL);
+	}
+
+	return r;
+}
@@ -31,32 +31,85 @@
 
 #include <stdlib.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <signal.h>
 #include <sys/types.h>
+#include <sys/socket.h>
 #include <sys/wait.h>
 
 bool pink_easy_call(pink_easy_context_t *ctx, pink_easy_child_func_t func, void *userdata)
 {
 	pid_t pid;
+	int fds[2];
+	bool seize = !ctx->seccomp_notify && ctx->options & PINK_EASY_OPTION_SEIZE;
+	unsigned short filter_len;
+	struct sock_filter *filter;
 	pink_easy_process_t *current;
 
+	filter = NULL;
+	if ((ctx->seccomp || ctx->seccomp_notify)
+			&& !(filter = _pink_easy_seccomp_filter(ctx, &filter_len))) {
+		ctx->callback_table.error(ctx, PINK_EASY_ERROR_ALLOC, "seccomp");
+		return false;
+	}
+	if (ctx->seccomp_notify && socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) < 0) {
+		free(filter);
+		ctx->callback_table.error(ctx, PINK_EASY_ERROR_FORK, "socketpair");
+		return false;
+	}
+	if (seize && pipe2(fds, O_CLOEXEC) < 0) {
+		free(filter);
+		ctx->callback_table.error(ctx, PINK_EASY_ERROR_FORK, "pipe");
+		return false;
+	}
+
 	pid = fork();
 	if (pid < 0) {
+		free(filter);
+		if (ctx->seccomp_notify || seize) {
+			close(fds[0]);
+			close(fds[1]);
+		}
 		ctx->callback_table.error(ctx, PINK_EASY_ERROR_FORK, "fork");
 		return false;
 	} else if (pid == 0) { /* child */
-		if (!pink_trace_me())
+		_pink_easy_loop_child(ctx);
+		if (ctx->seccomp_notify) {
+			/* Not traced, the parent serves the listener */
+			close(fds[0]);
+			if (!_pink_easy_notify_install(filter, filter_len, fds[1]))
+				_exit(ctx->callback_table.cerror(PINK_EASY_CHILD_ERROR_SETUP));
+			goto run;
+		}
+		if (seize) {
+			/* Wait until the parent has seized us */
+			if (!_pink_easy_seize_wait(fds))
+				_exit(ctx->callback_table.cerror(PINK_EASY_CHILD_ERROR_SETUP));
+		} else {
+			if (!pink_trace_me())
+				_exit(ctx->callback_table.cerror(PINK_EASY_CHILD_ERROR_SETUP));
+			kill(getpid(), SIGSTOP);
+		}
+		/* Tracer has set up tracing options, including seccomp */
+		if (filter && !_pink_easy_seccomp_install(filter, filter_len))
 			_exit(ctx->callback_table.cerror(PINK_EASY_CHILD_ERROR_SETUP));
-		kill(getpid(), SIGSTOP);
+run:
 		_exit(func(userdata));
 	}
 	/* parent */
-	PINK_EASY_INSERT_PROCESS(ctx, current);
+	free(filter);
+	if (ctx->seccomp_notify)
+		return _pink_easy_notify_listen(ctx, pid, fds);
+	if (seize && !_pink_easy_seize_child(ctx, pid, fds))
+		return false;
+	PINK_EASY_INSERT_PROCESS(ctx, current, pid);
 	if (current == NULL) {
 		kill(pid, SIGKILL);
 		return false;
 	}
-	current->pid = pid;
-	current->flags = PINK_EASY_PROCESS_STARTUP | PINK_EASY_PROCESS_IGNORE_ONE_SIGSTOP;
+	current->flags = PINK_EASY_PROCESS_STARTUP;
+	current->flags |= seize ? PINK_EASY_PROCESS_SEIZED : PINK_EASY_PROCESS_IGNORE_ONE_SIGSTOP;
+	if (ctx->seccomp)
+		current->flags |= PINK_EASY_PROCESS_SECCOMP;
 	return true;
 }
@@ -61,6 +61,7 @@ void pink_easy_errback_stderr(const struct pink_easy_context *ctx, ...)
 		break;
 	case PINK_EASY_ERROR_ALLOC:
 	case PINK_EASY_ERROR_FORK:
+	case PINK_EASY_ERROR_NOTIFY:
 		errctx = va_arg(ap, const char *);
 		fprintf(stderr, "%s: %s (errno:%d %s)\n",
 				pink_easy_strerror(ctx->error),
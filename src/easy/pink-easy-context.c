@@ -28,16 +28,27 @@
 #include <pinktrace/easy/internal.h>
 
 #include <assert.h>
+#include <errno.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include <pinktrace/pink.h>
 #include <pinktrace/easy/pink.h>
 
+/* System calls which may change the memory map, the read cache forgets the
+ * memory map and the strings from immutable mappings when they return */
+static const char *const map_syscalls[PINK_EASY_MAP_SYSCALLS] = {
+	"mmap", "mmap2", "old_mmap", "munmap", "mremap", "brk",
+	"mprotect", "pkey_mprotect", "remap_file_pages",
+	"ipc", "shmat", "shmdt",
+};
+
 pink_easy_context_t *pink_easy_context_new(int ptrace_options,
 		const pink_easy_callback_table_t *callback_table,
 		void *userdata, pink_easy_free_func_t userdata_destroy)
 {
+	unsigned b, i;
 	pink_easy_context_t *ctx;
 
 	ctx = malloc(sizeof(pink_easy_context_t));
@@ -47,6 +58,7 @@ pink_easy_context_t *pink_easy_context_new(int ptrace_options,
 	/* Properties */
 	ctx->nprocs = 0;
 	ctx->ptrace_options = ptrace_options;
+	ctx->options = 0;
 	ctx->error = PINK_EASY_ERROR_SUCCESS;
 
 	/* Callbacks */
@@ -57,7 +69,47 @@ pink_easy_context_t *pink_easy_context_new(int ptrace_options,
 		ctx->callback_table.error = pink_easy_errback_stderr;
 
 	/* Process list */
-	SLIST_INIT(&ctx->process_list);
+	ctx->process_list.size = 0;
+	ctx->process_list.count = 0;
+	ctx->process_list.slots = NULL;
+	ctx->process_datasize = 0;
+	ctx->process_size = sizeof(struct pink_easy_process);
+	ctx->process_slabs = NULL;
+	ctx->process_free = NULL;
+
+	/* Seccomp */
+	ctx->seccomp = false;
+	ctx->seccomp_syscalls[0] = ctx->seccomp_syscalls[1] = NULL;
+	ctx->seccomp_nsyscalls[0] = ctx->seccomp_nsyscalls[1] = 0;
+	ctx->syscall_handlers[0] = ctx->syscall_handlers[1] = NULL;
+	ctx->syscall_nhandlers[0] = ctx->syscall_nhandlers[1] = 0;
+	ctx->seccomp_notify = false;
+	ctx->notify_fds = NULL;
+	ctx->notify_nfds = 0;
+
+	/* Read cache */
+	for (b = 0; b < 2; b++) {
+		for (i = 0; i < PINK_EASY_MAP_SYSCALLS; i++)
+			ctx->map_syscalls[b][i] = pink_name_lookup(map_syscalls[i], b);
+	}
+
+	/* Decode arena */
+	ctx->arena = NULL;
+
+	/* Event loop */
+	ctx->loop_fd = -1;
+	ctx->signal_fd = -1;
+
+	/* Deferred verdicts */
+	ctx->npending = 0;
+	ctx->serial = 0;
+	ctx->verdicts = NULL;
+	ctx->verdict_fd = -1;
+	ctx->loop_waiting = 0;
+
+	/* Batch statistics */
+	ctx->batches = ctx->batch_stops = 0;
+	ctx->batch_max = 0;
 
 	/* User data */
 	ctx->userdata = userdata;
@@ -82,15 +134,40 @@ void
 pink_easy_context_destroy(pink_easy_context_t *ctx)
 {
 	pink_easy_process_t *current;
+	struct pink_easy_verdict_node *node;
 
 	if (ctx->userdata_destroy && ctx->userdata)
 		ctx->userdata_destroy(ctx->userdata);
 
-	SLIST_FOREACH(current, &ctx->process_list, entries) {
+	PINK_EASY_FOREACH_PROCESS(current, ctx) {
 		if (current->userdata_destroy && current->userdata)
 			current->userdata_destroy(current->userdata);
-		free(current);
 	}
+	_pink_easy_process_list_destroy(&ctx->process_list);
+	_pink_easy_process_slabs_destroy(ctx);
+
+	free(ctx->seccomp_syscalls[0]);
+	free(ctx->seccomp_syscalls[1]);
+	free(ctx->syscall_handlers[0]);
+	free(ctx->syscall_handlers[1]);
+
+	for (unsigned i = 0; i < ctx->notify_nfds; i++)
+		close(ctx->notify_fds[i]);
+	free(ctx->notify_fds);
+
+	pink_arena_free(ctx->arena);
+
+	if (ctx->loop_fd >= 0)
+		close(ctx->loop_fd);
+	if (ctx->signal_fd >= 0)
+		close(ctx->signal_fd);
+
+	while ((node = ctx->verdicts) != NULL) {
+		ctx->verdicts = node->next;
+		free(node);
+	}
+	if (ctx->verdict_fd >= 0)
+		close(ctx->verdict_fd);
 
 	free(ctx);
 }
@@ -102,12 +179,185 @@ pink_easy_context_set_userdata(pink_easy_context_t *ctx, void *userdata, pink_ea
 	ctx->userdata_destroy = userdata_destroy;
 }
 
+void
+pink_easy_context_set_options(pink_easy_context_t *ctx, int options)
+{
+	ctx->options = options;
+}
+
+int
+pink_easy_context_get_options(const pink_easy_context_t *ctx)
+{
+	return ctx->options;
+}
+
 void *
 pink_easy_context_get_userdata(const pink_easy_context_t *ctx)
 {
 	return ctx->userdata;
 }
 
+/* Decode arenas of the threads handling seccomp notifications, several
+ * threads may serve the same listener at the same time */
+static pthread_key_t thread_arena_key;
+static pthread_once_t thread_arena_once = PTHREAD_ONCE_INIT;
+static int thread_arena_error;
+
+static void thread_arena_free(void *arena)
+{
+	pink_arena_free(arena);
+}
+
+static void thread_arena_init(void)
+{
+	thread_arena_error = pthread_key_create(&thread_arena_key, thread_arena_free);
+}
+
+pink_arena_t *
+_pink_easy_thread_arena(bool create)
+{
+	pink_arena_t *arena;
+
+	pthread_once(&thread_arena_once, thread_arena_init);
+	if (thread_arena_error) {
+		errno = thread_arena_error;
+		return NULL;
+	}
+
+	arena = pthread_getspecific(thread_arena_key);
+	if (!arena && create) {
+		arena = pink_arena_new(0);
+		if (arena && (errno = pthread_setspecific(thread_arena_key, arena))) {
+			pink_arena_free(arena);
+			return NULL;
+		}
+	}
+	return arena;
+}
+
+pink_arena_t *
+pink_easy_context_get_arena(pink_easy_context_t *ctx)
+{
+	if (ctx->seccomp_notify)
+		return _pink_easy_thread_arena(true);
+	if (!ctx->arena)
+		ctx->arena = pink_arena_new(0);
+	return ctx->arena;
+}
+
+void
+pink_easy_context_get_batch_stats(const pink_easy_context_t *ctx,
+		unsigned long *batches, unsigned long *stops, unsigned *max)
+{
+	if (batches)
+		*batches = ctx->batches;
+	if (stops)
+		*stops = ctx->batch_stops;
+	if (max)
+		*max = ctx->batch_max;
+}
+
+bool
+pink_easy_context_set_inline_userdata_size(pink_easy_context_t *ctx, size_t size)
+{
+	size_t align;
+
+	if (ctx->process_slabs) {
+		errno = EBUSY;
+		return false;
+	}
+
+	/* Round up so that consecutive entries in a slab stay aligned */
+	align = __alignof__(struct pink_easy_process);
+	ctx->process_datasize = size;
+	ctx->process_size = (sizeof(struct pink_easy_process) + size + align - 1) & ~(align - 1);
+	return true;
+}
+
+size_t
+pink_easy_context_get_inline_userdata_size(const pink_easy_context_t *ctx)
+{
+	return ctx->process_datasize;
+}
+
+bool
+pink_easy_context_syscall_add(pink_easy_context_t *ctx, pink_bitness_t bitness, long scno,
+		int when, pink_easy_callback_syscall_t func)
+{
+	unsigned n;
+	struct pink_easy_syscall_handler *handlers;
+
+	if ((bitness != PINK_BITNESS_32 && bitness != PINK_BITNESS_64)
+			|| scno < 0 || scno >= PINK_EASY_SYSCALL_MAX
+			|| (func && !(when & (PINK_EASY_SYSCALL_ENTRY | PINK_EASY_SYSCALL_EXIT)))) {
+		errno = EINVAL;
+		return false;
+	}
+
+	n = ctx->syscall_nhandlers[bitness];
+	if ((unsigned)scno >= n) {
+		if (!func)
+			return true;
+		handlers = realloc(ctx->syscall_handlers[bitness],
+				(scno + 1) * sizeof(struct pink_easy_syscall_handler));
+		if (!handlers)
+			return false;
+		memset(handlers + n, 0, (scno + 1 - n) * sizeof(struct pink_easy_syscall_handler));
+		ctx->syscall_handlers[bitness] = handlers;
+		ctx->syscall_nhandlers[bitness] = scno + 1;
+	}
+
+	ctx->syscall_handlers[bitness][scno].when = func ? when : 0;
+	ctx->syscall_handlers[bitness][scno].func = func;
+	return true;
+}
+
+bool
+pink_easy_context_syscall_add_name(pink_easy_context_t *ctx, pink_bitness_t bitness,
+		const char *name, int when, pink_easy_callback_syscall_t func)
+{
+	long scno;
+
+	scno = pink_name_lookup(name, bitness);
+	if (scno < 0) {
+		errno = EINVAL;
+		return false;
+	}
+
+	return pink_easy_context_syscall_add(ctx, bitness, scno, when, func);
+}
+
+const struct pink_easy_syscall_handler *
+_pink_easy_syscall_handler(const pink_easy_context_t *ctx, pink_bitness_t bitness,
+		long scno, int when)
+{
+	const struct pink_easy_syscall_handler *handler;
+
+	if (bitness != PINK_BITNESS_32 && bitness != PINK_BITNESS_64)
+		return NULL;
+	if (scno < 0 || (unsigned long)scno >= ctx->syscall_nhandlers[bitness])
+		return NULL;
+
+	handler = &ctx->syscall_handlers[bitness][scno];
+	return (handler->when & when) ? handler : NULL;
+}
+
+bool
+_pink_easy_map_syscall(const pink_easy_context_t *ctx, pink_bitness_t bitness, long scno)
+{
+	unsigned i;
+
+	if (bitness != PINK_BITNESS_32 && bitness != PINK_BITNESS_64)
+		return false;
+
+	for (i = 0; i < PINK_EASY_MAP_SYSCALLS; i++) {
+		if (ctx->map_syscalls[bitness][i] == scno)
+			return scno >= 0;
+	}
+
+	return false;
+}
+
 pink_easy_process_list_t *
 pink_easy_context_get_process_list(pink_easy_context_t *ctx)
 {
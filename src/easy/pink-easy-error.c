@@ -64,6 +64,8 @@ pink_easy_strerror(pink_easy_error_t e)
 		return "ptrace() failed";
 	case PINK_EASY_ERROR_PROCESS:
 		return "Process misbehave";
+	case PINK_EASY_ERROR_NOTIFY:
+		return "seccomp notification failed";
 	case PINK_EASY_ERROR_MAX:
 	default:
 		return "Unknown error";
@@ -32,61 +32,229 @@
 #include <stdarg.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <alloca.h>
 #include <errno.h>
+#include <sched.h>
+#include <signal.h>
 #include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
 #include <sys/wait.h>
 
+/* clone() takes the top of the child's stack, except on IA64 */
+#ifndef __ia64__
+#define HAVE_SPAWN 1
+#endif
+
+/* Stack of children spawned with PINK_EASY_OPTION_SPAWN, execvp() may use
+ * up to this much for the path search besides a copy of the arguments */
+#define SPAWN_STACK_SIZE (128 * 1024)
+
 enum {
 	PINK_INTERNAL_FUNC_EXECVE,
 	PINK_INTERNAL_FUNC_EXECV,
 	PINK_INTERNAL_FUNC_EXECVP,
 };
 
+static void exec_child(int type, const char *filename, char *const argv[], char *const envp[])
+{
+	switch (type) {
+	case PINK_INTERNAL_FUNC_EXECVE:
+		execve(filename, argv, envp);
+		break;
+	case PINK_INTERNAL_FUNC_EXECV:
+		execv(filename, argv);
+		break;
+	case PINK_INTERNAL_FUNC_EXECVP:
+		execvp(filename, argv);
+		break;
+	default:
+		abort(); /* TODO assert_not_reached() */
+	}
+}
+
+#ifdef HAVE_SPAWN
+/* Arguments of a spawned child, which shares the memory of the parent. The
+ * parent is suspended until the child calls execve() or exits. */
+struct spawn_args {
+	const pink_easy_context_t *ctx;
+	int type;
+	const char *filename;
+	char *const *argv;
+	char *const *envp;
+	sigset_t mask;
+};
+
+static int spawn_child(void *data)
+{
+	int sig;
+	struct sigaction sa;
+	const struct spawn_args *args = data;
+
+	/* Signal handlers of the parent must not run in the child, all signals
+	 * are blocked until they are reset */
+	for (sig = 1; sig < NSIG; sig++) {
+		if (sigaction(sig, NULL, &sa) < 0
+				|| sa.sa_handler == SIG_DFL
+				|| sa.sa_handler == SIG_IGN)
+			continue;
+		sa.sa_handler = SIG_DFL;
+		sa.sa_flags = 0;
+		sigaction(sig, &sa, NULL);
+	}
+	sigprocmask(SIG_SETMASK, &args->mask, NULL);
+	_pink_easy_loop_child(args->ctx);
+
+	/* The parent can not run before execve() so there is no stop here,
+	 * execve() raises SIGTRAP instead */
+	if (!pink_trace_me())
+		_exit(args->ctx->callback_table.cerror(PINK_EASY_CHILD_ERROR_SETUP));
+	exec_child(args->type, args->filename, args->argv, args->envp);
+	/* execve() failed */
+	_exit(args->ctx->callback_table.cerror(PINK_EASY_CHILD_ERROR_EXEC));
+}
+
+/* Spawn a child without copying the page tables of the tracer */
+static pid_t spawn(pink_easy_context_t *ctx, int type,
+		const char *filename, char *const argv[], char *const envp[])
+{
+	int save_errno;
+	pid_t pid;
+	size_t size;
+	void *stack;
+	sigset_t all;
+	struct spawn_args args;
+
+	size = SPAWN_STACK_SIZE;
+	for (unsigned i = 0; argv[i]; i++)
+		size += sizeof(char *);
+	size = (size + sysconf(_SC_PAGESIZE) - 1) & ~(sysconf(_SC_PAGESIZE) - 1);
+	stack = mmap(NULL, size, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+	if (stack == MAP_FAILED)
+		return -1;
+
+	args.ctx = ctx;
+	args.type = type;
+	args.filename = filename;
+	args.argv = argv;
+	args.envp = envp;
+
+	sigfillset(&all);
+	sigprocmask(SIG_BLOCK, &all, &args.mask);
+	pid = clone(spawn_child, (char *)stack + size,
+			CLONE_VM | CLONE_VFORK | SIGCHLD, &args);
+	save_errno = errno;
+	sigprocmask(SIG_SETMASK, &args.mask, NULL);
+	munmap(stack, size);
+	errno = save_errno;
+
+	return pid;
+}
+#endif
+
 static bool pink_easy_exec_helper(pink_easy_context_t *ctx, int type,
 		const char *filename, char *const argv[], char *const envp[])
 {
 	pid_t pid;
+	int fds[2];
+	bool seize = !ctx->seccomp_notify && ctx->options & PINK_EASY_OPTION_SEIZE;
+	bool spawned = false;
+	unsigned short filter_len;
+	struct sock_filter *filter;
 	pink_easy_process_t *current;
 
+	filter = NULL;
+	if ((ctx->seccomp || ctx->seccomp_notify)
+			&& !(filter = _pink_easy_seccomp_filter(ctx, &filter_len))) {
+		ctx->callback_table.error(ctx, PINK_EASY_ERROR_ALLOC, "seccomp");
+		return false;
+	}
+	if (ctx->seccomp_notify && socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) < 0) {
+		free(filter);
+		ctx->callback_table.error(ctx, PINK_EASY_ERROR_FORK, "socketpair");
+		return false;
+	}
+	if (seize && pipe2(fds, O_CLOEXEC) < 0) {
+		free(filter);
+		ctx->callback_table.error(ctx, PINK_EASY_ERROR_FORK, "pipe");
+		return false;
+	}
+
+#ifdef HAVE_SPAWN
+	if (ctx->options & PINK_EASY_OPTION_SPAWN && !filter && !seize) {
+		pid = spawn(ctx, type, filename, argv, envp);
+		if (pid < 0) {
+			ctx->callback_table.error(ctx, PINK_EASY_ERROR_FORK, "clone");
+			return false;
+		}
+		spawned = true;
+		goto parent;
+	}
+#endif
+
 	pid = fork();
 	if (pid < 0) {
+		free(filter);
+		if (ctx->seccomp_notify || seize) {
+			close(fds[0]);
+			close(fds[1]);
+		}
 		ctx->callback_table.error(ctx, PINK_EASY_ERROR_FORK, "fork");
 		return false;
 	} else if (pid == 0) { /* child */
-		if (!pink_trace_me())
-			_exit(ctx->callback_table.cerror(PINK_EASY_CHILD_ERROR_SETUP));
-		/* Induce a ptrace stop. Tracer (our parent) will resume us
-		 * with PTRACE_SYSCALL and may examine the immediately
-		 * following execve syscall.  Note: This can't be done on NOMMU
-		 * systems with vfork because the parent would be blocked and
-		 * stopping would deadlock.
-		 */
-		kill(getpid(), SIGSTOP);
-		switch (type) {
-		case PINK_INTERNAL_FUNC_EXECVE:
-			execve(filename, argv, envp);
-			break;
-		case PINK_INTERNAL_FUNC_EXECV:
-			execv(filename, argv);
-			break;
-		case PINK_INTERNAL_FUNC_EXECVP:
-			execvp(filename, argv);
-			break;
-		default:
-			abort(); /* TODO assert_not_reached() */
+		_pink_easy_loop_child(ctx);
+		if (ctx->seccomp_notify) {
+			/* Not traced, the parent serves the listener */
+			close(fds[0]);
+			if (!_pink_easy_notify_install(filter, filter_len, fds[1]))
+				_exit(ctx->callback_table.cerror(PINK_EASY_CHILD_ERROR_SETUP));
+			goto run;
+		}
+		if (seize) {
+			/* Wait until the parent has seized us, it stops us
+			 * with PTRACE_INTERRUPT instead of SIGSTOP. */
+			if (!_pink_easy_seize_wait(fds))
+				_exit(ctx->callback_table.cerror(PINK_EASY_CHILD_ERROR_SETUP));
+		} else {
+			if (!pink_trace_me())
+				_exit(ctx->callback_table.cerror(PINK_EASY_CHILD_ERROR_SETUP));
+			/* Induce a ptrace stop. Tracer (our parent) will resume us
+			 * with PTRACE_SYSCALL and may examine the immediately
+			 * following execve syscall.  Note: This can't be done on NOMMU
+			 * systems with vfork because the parent would be blocked and
+			 * stopping would deadlock.
+			 */
+			kill(getpid(), SIGSTOP);
 		}
+		/* Tracer has set up tracing options, including seccomp */
+		if (filter && !_pink_easy_seccomp_install(filter, filter_len))
+			_exit(ctx->callback_table.cerror(PINK_EASY_CHILD_ERROR_SETUP));
+run:
+		exec_child(type, filename, argv, envp);
 		/* execve() failed */
 		_exit(ctx->callback_table.cerror(PINK_EASY_CHILD_ERROR_EXEC));
 	}
 	/* parent */
-	PINK_EASY_INSERT_PROCESS(ctx, current);
+	free(filter);
+parent:
+	if (ctx->seccomp_notify)
+		return _pink_easy_notify_listen(ctx, pid, fds);
+	if (seize && !_pink_easy_seize_child(ctx, pid, fds))
+		return false;
+	PINK_EASY_INSERT_PROCESS(ctx, current, pid);
 	if (current == NULL) {
 		kill(pid, SIGKILL);
 		return false;
 	}
-	current->pid = pid;
-	current->flags = PINK_EASY_PROCESS_STARTUP | PINK_EASY_PROCESS_IGNORE_ONE_SIGSTOP;
+	current->flags = PINK_EASY_PROCESS_STARTUP;
+	if (spawned)
+		current->flags |= PINK_EASY_PROCESS_IGNORE_ONE_SIGTRAP;
+	else
+		current->flags |= seize ? PINK_EASY_PROCESS_SEIZED : PINK_EASY_PROCESS_IGNORE_ONE_SIGSTOP;
+	if (ctx->seccomp)
+		current->flags |= PINK_EASY_PROCESS_SECCOMP;
 	return true;
 }
 
@@ -114,11 +282,13 @@ bool pink_easy_execl(pink_easy_context_t *ctx, const char *file,
 		++narg;
 	va_end(ap);
 
-	/* Copy the arguments to argv array */
-	argv = (char **)alloca(narg * sizeof(char *));
+	/* Copy the arguments to argv array, the initial argument first */
+	argv = (char **)alloca((narg + 2) * sizeof(char *));
 	if (argv) {
-		for (unsigned int i = 0; i < narg; i++)
+		argv[0] = (char *)arg;
+		for (unsigned int i = 1; i <= narg; i++)
 			argv[i] = va_arg(orig_ap, char *);
+		argv[narg + 1] = NULL;
 		va_end(orig_ap);
 		return pink_easy_exec_helper(ctx, PINK_INTERNAL_FUNC_EXECVE, file, argv, environ);
 	}
@@ -147,11 +317,13 @@ bool pink_easy_execlp(pink_easy_context_t *ctx, const char *file,
 		++narg;
 	va_end(ap);
 
-	/* Copy the arguments to argv array */
-	argv = (char **)alloca(narg * sizeof(char *));
+	/* Copy the arguments to argv array, the initial argument first */
+	argv = (char **)alloca((narg + 2) * sizeof(char *));
 	if (argv) {
-		for (unsigned int i = 0; i < narg; i++)
+		argv[0] = (char *)arg;
+		for (unsigned int i = 1; i <= narg; i++)
 			argv[i] = va_arg(orig_ap, char *);
+		argv[narg + 1] = NULL;
 		va_end(orig_ap);
 		return pink_easy_exec_helper(ctx, PINK_INTERNAL_FUNC_EXECVP, file, argv, NULL);
 	}
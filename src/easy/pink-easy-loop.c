@@ -31,13 +31,34 @@
 #include <pinktrace/easy/pink.h>
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <errno.h>
+#include <sched.h>
+#include <setjmp.h>
+#include <signal.h>
 #include <sys/types.h>
-#include <sys/queue.h>
 #include <sys/wait.h>
+#include <sys/syscall.h>
 #include <sys/utsname.h>
+#if defined(HAVE_SYS_SIGNALFD_H) && defined(HAVE_SYS_EPOLL_H) && defined(HAVE_SYS_EVENTFD_H)
+#define HAVE_LOOP_FD 1
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#endif
+
+#ifndef KCMP_VM
+#define KCMP_VM 1
+#endif
+
+/* Where the handler of PINK_EASY_WAKEUP_SIGNAL jumps to while the tracing
+ * thread waits for stops with tracees pending, see loop_wait_pending() */
+static __thread sigjmp_buf wakeup_env;
+static __thread volatile sig_atomic_t wakeup_armed;
+static int wakeup_installed;
 
 static void handle_ptrace_error(pink_easy_context_t *ctx,
 		pink_easy_process_t *current,
@@ -52,16 +73,286 @@ static void handle_ptrace_error(pink_easy_context_t *ctx,
 	PINK_EASY_REMOVE_PROCESS(ctx, current);
 }
 
+/* PINK_EASY_CFLAG_DETACH is ignored for seccomp-filtered processes, the
+ * filter outlives the tracer and fails the filtered system calls with ENOSYS
+ * once nobody traces the process any more. */
+static void cflag_detach(pink_easy_process_t *current)
+{
+	if (!(current->flags & PINK_EASY_PROCESS_SECCOMP))
+		current->flags |= PINK_EASY_PROCESS_DETACH;
+}
+
+static bool resume_tracee(pink_easy_context_t *ctx, pink_easy_process_t *current, int sig)
+{
+	int options;
+
+	/* A denied system call gets its return value at exit first */
+	if ((current->flags & (PINK_EASY_PROCESS_DETACH | PINK_EASY_PROCESS_DENIED))
+			== PINK_EASY_PROCESS_DETACH) {
+		_pink_easy_process_detach(ctx, current, sig);
+		return true;
+	}
+
+	/* Children and pre-exit stops are not traced at the lowest level, exec
+	 * is still, it would raise SIGTRAP otherwise. Children inherit the
+	 * seccomp filter, which fails the filtered system calls with ENOSYS
+	 * unless they are traced. */
+	if (current->flags & PINK_EASY_PROCESS_SETUP) {
+		options = ctx->ptrace_options;
+		if (current->level == PINK_EASY_TRACE_NONE) {
+			options &= ~(PINK_TRACE_OPTION_VFORK_DONE
+					| PINK_TRACE_OPTION_EXIT);
+			if (!(current->flags & PINK_EASY_PROCESS_SECCOMP))
+				options &= ~(PINK_TRACE_OPTION_FORK
+						| PINK_TRACE_OPTION_VFORK
+						| PINK_TRACE_OPTION_CLONE);
+		}
+		if (!pink_trace_setup(current->pid, options))
+			return false;
+		current->flags &= ~PINK_EASY_PROCESS_SETUP;
+	}
+
+	/* Under the seccomp filter, the filter decides which system calls
+	 * stop the tracee, the exit stop is only requested by handlers and
+	 * the read cache. Denied system calls stop at exit whatever the trace
+	 * level. */
+	if (current->flags & (PINK_EASY_PROCESS_DENIED | PINK_EASY_PROCESS_MAPS)
+			|| (current->level == PINK_EASY_TRACE_SYSCALL
+				&& (current->flags & (PINK_EASY_PROCESS_SECCOMP | PINK_EASY_PROCESS_SYSEXIT))
+					!= PINK_EASY_PROCESS_SECCOMP))
+		return pink_trace_syscall(current->pid, sig);
+
+	/* The exit of the current system call goes unseen and changes to the
+	 * memory map go unnoticed until the next stop, unless the seccomp
+	 * filter stops the system calls which make them */
+	current->flags &= ~PINK_EASY_PROCESS_INSYSCALL;
+	if (!(ctx->options & PINK_EASY_OPTION_CACHE && current->flags & PINK_EASY_PROCESS_SECCOMP))
+		pink_util_cache_invalidate_maps(current->pid);
+	return pink_trace_cont(current->pid, sig, NULL);
+}
+
+/* Leave the tracee stopped until pink_easy_process_complete() posts a
+ * verdict for it */
+static void park_tracee(pink_easy_context_t *ctx, pink_easy_process_t *current)
+{
+	current->flags |= PINK_EASY_PROCESS_PENDING;
+	ctx->npending++;
+}
+
+/* Apply the verdict to the tracee and resume it */
+static void apply_verdict(pink_easy_context_t *ctx, pink_easy_process_t *current,
+		const pink_easy_verdict_t *verdict)
+{
+	unsigned i;
+
+	current->flags &= ~PINK_EASY_PROCESS_PENDING;
+	ctx->npending--;
+	/* Further verdicts for this stop are stale */
+	current->serial = ++ctx->serial;
+
+	if (current->flags & PINK_EASY_PROCESS_INSYSCALL) {
+		for (i = 0; i < PINK_MAX_ARGS; i++) {
+			if (verdict->args_mask & (1U << i)
+					&& !pink_util_set_arg(current->pid, current->bitness, i, verdict->args[i]))
+				goto fail;
+		}
+		/* Invalidate the system call, the return value is set when
+		 * the tracee stops at its exit */
+		if (verdict->error) {
+			if (!pink_util_set_syscall(current->pid, current->bitness, PINK_SYSCALL_INVALID))
+				goto fail;
+			current->flags |= PINK_EASY_PROCESS_DENIED | PINK_EASY_PROCESS_SYSEXIT;
+			current->deny_errno = verdict->error;
+		}
+	} else if (verdict->error && !pink_util_set_return(current->pid, -verdict->error)) {
+		goto fail;
+	}
+
+	if (!resume_tracee(ctx, current, 0))
+		handle_ptrace_error(ctx, current, "syscall");
+	return;
+fail:
+	handle_ptrace_error(ctx, current, "verdict");
+}
+
+/* Apply the verdicts posted with pink_easy_process_complete() */
+static void handle_verdicts(pink_easy_context_t *ctx)
+{
+	struct pink_easy_verdict_node *node, *next, *list;
+	pink_easy_process_t *current;
+
+#ifdef HAVE_LOOP_FD
+	uint64_t count;
+
+	/* Verdicts posted after this point make the descriptor readable again */
+	if (ctx->verdict_fd >= 0 && read(ctx->verdict_fd, &count, sizeof(count)) < 0) {
+		/* EAGAIN, nothing was posted since the last time */
+	}
+#endif
+	/* Take the whole queue and restore the order of posting */
+	list = NULL;
+	for (node = __sync_lock_test_and_set(&ctx->verdicts, NULL); node; node = next) {
+		next = node->next;
+		node->next = list;
+		list = node;
+	}
+
+	for (node = list; node; node = next) {
+		next = node->next;
+		current = pink_easy_process_list_lookup(&(ctx->process_list), node->token.pid);
+		if (current && current->flags & PINK_EASY_PROCESS_PENDING
+				&& current->serial == node->token.serial)
+			apply_verdict(ctx, current, &node->verdict);
+		free(node);
+	}
+}
+
+static bool want_syscall(const pink_easy_context_t *ctx)
+{
+	return ctx->callback_table.syscall
+		|| ctx->syscall_nhandlers[PINK_BITNESS_32]
+		|| ctx->syscall_nhandlers[PINK_BITNESS_64];
+}
+
+/* Call the "syscall" callback and the handler of the system call.
+ * Returns the callback flags or -1 if fetching the registers failed. */
+static int dispatch_syscall(pink_easy_context_t *ctx, pink_easy_process_t *current,
+		bool entering, bool have_info, const pink_syscall_info_t *info)
+{
+	int r;
+	long scno;
+	const struct pink_easy_syscall_handler *handler;
+
+	if (!want_syscall(ctx))
+		return 0;
+
+	/* Without system call information, fetch all registers at once, the
+	 * snapshot is invalidated when the tracee is resumed. */
+	if (!have_info && !pink_util_regs_snapshot(current->pid))
+		return -1;
+
+	handler = NULL;
+	if (ctx->syscall_nhandlers[PINK_BITNESS_32] || ctx->syscall_nhandlers[PINK_BITNESS_64]) {
+		if (have_info)
+			scno = info->scno;
+		else if (!pink_util_get_syscall(current->pid, current->bitness, &scno))
+			return -1;
+		handler = _pink_easy_syscall_handler(ctx, current->bitness, scno,
+				PINK_EASY_SYSCALL_ENTRY | PINK_EASY_SYSCALL_EXIT);
+	}
+
+	if (!entering)
+		current->flags &= ~PINK_EASY_PROCESS_SYSEXIT;
+	else if (handler && handler->when & PINK_EASY_SYSCALL_EXIT)
+		current->flags |= PINK_EASY_PROCESS_SYSEXIT;
+
+	r = 0;
+	if (ctx->callback_table.syscall)
+		r = ctx->callback_table.syscall(ctx, current, entering);
+	if (handler && !(r & (PINK_EASY_CFLAG_ABORT | PINK_EASY_CFLAG_DROP))
+			&& handler->when & (entering ? PINK_EASY_SYSCALL_ENTRY : PINK_EASY_SYSCALL_EXIT))
+		r |= handler->func(ctx, current, entering);
+	return r;
+}
+
+static pink_bitness_t get_bitness(pink_easy_process_t *current)
+{
+	pink_syscall_info_t info;
+
+	/* Prefer the architecture reported by the kernel over peeking at the
+	 * registers, the information is available at any ptrace stop. */
+	if (pink_trace_get_syscall_info(current->pid, &info)
+			&& info.bitness != PINK_BITNESS_UNKNOWN)
+		return info.bitness;
+	return pink_bitness_get(current->pid);
+}
+
+/* The read cache keeps the memory map and strings from immutable mappings,
+ * forget them when a system call which changes the memory map returns. */
+static void check_maps(const pink_easy_context_t *ctx, pink_easy_process_t *current,
+		bool have_info, const pink_syscall_info_t *info)
+{
+	long scno;
+
+	if (have_info)
+		scno = info->scno;
+	else if (!pink_util_get_syscall(current->pid, current->bitness, &scno))
+		scno = -1;
+
+	if (!pink_name_syscall(scno, current->bitness)
+			|| _pink_easy_map_syscall(ctx, current->bitness, scno))
+		pink_util_cache_invalidate_maps(current->pid);
+}
+
+/* Does the new child share the address space of its parent? */
+static bool share_vm(pink_easy_process_t *current, pid_t new_pid, unsigned event)
+{
+	long scno, flags;
+#ifdef __NR_clone3
+	long args;
+	uint64_t flags3;
+#endif
+#ifdef __NR_kcmp
+	int r;
+
+	/* Whatever the system call, e.g. clone3(2) used by newer C libraries
+	 * to create threads */
+	r = syscall(__NR_kcmp, (long)current->pid, (long)new_pid, KCMP_VM, 0L, 0L);
+	if (r >= 0)
+		return r == 0;
+#endif
+
+	/* The kernel is built without kcmp(2), decode the flags */
+	if (event == PTRACE_EVENT_VFORK)
+		return true;
+	if (event != PTRACE_EVENT_CLONE
+			|| !pink_util_get_syscall(current->pid, current->bitness, &scno))
+		return false;
+	if (scno == pink_name_lookup("clone", current->bitness))
+		return pink_util_get_arg(current->pid, current->bitness, 0, &flags)
+			&& flags & CLONE_VM;
+#ifdef __NR_clone3
+	/* Same number for every bitness, flags come first in struct clone_args */
+	if (scno == __NR_clone3)
+		return pink_util_get_arg(current->pid, current->bitness, 0, &args)
+			&& pink_util_readn(current->pid, args, (char *)&flags3, sizeof(flags3))
+				== (ssize_t)sizeof(flags3)
+			&& flags3 & CLONE_VM;
+#endif
+	return false;
+}
+
+/* Enable the read cache of a process, keeping strings if asked to */
+static void enable_cache(const pink_easy_context_t *ctx, pid_t pid)
+{
+	if (pink_util_cache_enable(pid, true) && ctx->options & PINK_EASY_OPTION_CACHE_STRINGS)
+		pink_util_cache_strings(pid, true);
+}
+
+/* Set up the read cache of a new child, threads and vfork children share the
+ * address space, hence the cache, of their parent. */
+static void setup_child_cache(const pink_easy_context_t *ctx, pink_easy_process_t *current,
+		pid_t new_pid, unsigned event)
+{
+	if (share_vm(current, new_pid, event))
+		pink_util_cache_share(new_pid, current->pid);
+	else
+		enable_cache(ctx, new_pid);
+}
+
 static bool handle_startup(pink_easy_context_t *ctx, pink_easy_process_t *current)
 {
-	/* Set up tracing options */
-	if (!pink_trace_setup(current->pid, ctx->ptrace_options)) {
+	pink_easy_process_t *parent;
+
+	/* Set up tracing options, seized processes have them already */
+	if (!(current->flags & PINK_EASY_PROCESS_SEIZED)
+			&& !pink_trace_setup(current->pid, ctx->ptrace_options)) {
 		handle_ptrace_error(ctx, current, "setup");
 		return false;
 	}
 
 	/* Figure out bitness */
-	current->bitness = pink_bitness_get(current->pid);
+	current->bitness = get_bitness(current);
 	if (current->bitness == PINK_BITNESS_UNKNOWN) {
 		handle_ptrace_error(ctx, current, "bitness");
 		return false;
@@ -73,225 +364,655 @@ static bool handle_startup(pink_easy_context_t *ctx, pink_easy_process_t *curren
 			|| ctx->ptrace_options & PINK_TRACE_OPTION_CLONE)
 		current->flags |= PINK_EASY_PROCESS_FOLLOWFORK;
 
+	/* A child may already share the cache of its parent */
+	if (ctx->options & PINK_EASY_OPTION_CACHE)
+		enable_cache(ctx, current->pid);
+
+	/* Children start at the trace level of their parent, without system
+	 * call callbacks there is no need to stop at system calls */
+	parent = NULL;
+	if (current->ppid != -1)
+		parent = pink_easy_process_list_lookup(&(ctx->process_list), current->ppid);
+	if (parent)
+		current->level = parent->level;
+	else
+		current->level = want_syscall(ctx) ? PINK_EASY_TRACE_SYSCALL : PINK_EASY_TRACE_EVENTS;
+
 	/* Happy birthday! */
 	current->flags &= ~PINK_EASY_PROCESS_STARTUP;
-	if (ctx->callback_table.startup) {
-		pink_easy_process_t *parent = NULL;
-		if (current->ppid != -1)
-			parent = pink_easy_process_list_lookup(&(ctx->process_list), current->ppid);
+	if (ctx->callback_table.startup)
 		ctx->callback_table.startup(ctx, current, parent);
-	}
 
 	return true;
 }
 
-int pink_easy_loop(pink_easy_context_t *ctx)
+/* Handle the wait status of a traced process, returns false if a callback
+ * aborted the loop. */
+static bool handle_event(pink_easy_context_t *ctx, pid_t pid, int status)
 {
-	/* Enter the event loop */
-	while (ctx->nprocs != 0) {
-		pid_t pid;
-		int r, status, sig;
-		unsigned event;
-		pink_easy_process_t *current;
+	int r, sig;
+	unsigned event;
+	bool have_info;
+	pink_syscall_info_t info;
+	pink_easy_process_t *current;
 
-		pid = waitpid(-1, &status, __WALL);
-		if (pid < 0) {
-			switch (errno) {
-			case EINTR:
-				continue;
-			case ECHILD:
-				goto cleanup;
-			default:
-				ctx->fatal = true;
-				ctx->error = PINK_EASY_ERROR_WAIT;
-				ctx->callback_table.error(ctx);
-				goto cleanup;
-			}
-		}
+	/* Whatever was decoded for the previous event is gone */
+	if (ctx->arena)
+		pink_arena_reset(ctx->arena);
 
-		current = pink_easy_process_list_lookup(&(ctx->process_list), pid);
-		/* FIXME: pink_event_decide() is broken by design! */
-		event = ((unsigned) status >> 16);
-
-		/* Under Linux, execve changes pid to thread leader's pid,
-		 * and we see this changed pid on EVENT_EXEC and later,
-		 * execve sysexit. Leader "disappears" without exit
-		 * notification. Let user know that, drop leader's tcb,
-		 * and fix up pid in execve thread's tcb.
-		 * Effectively, execve thread's tcb replaces leader's tcb.
-		 *
-		 * BTW, leader is 'stuck undead' (doesn't report WIFEXITED
-		 * on exit syscall) in multithreaded programs exactly
-		 * in order to handle this case.
-		 *
-		 * PTRACE_GETEVENTMSG returns old pid starting from Linux 3.0.
-		 * On 2.6 and earlier, it can return garbage.
-		 */
-		if (event == PTRACE_EVENT_EXEC) {
-			pink_bitness_t old_bitness = current->bitness;
-			pink_easy_process_t *execve_thread = current;
-			long old_pid = 0;
-
-			if (pink_easy_os_release < KERNEL_VERSION(3,0,0))
-				goto dont_switch_procs;
-			if (!pink_trace_geteventmsg(pid, (unsigned long *)&old_pid))
-				goto dont_switch_procs;
-			if (old_pid <= 0 || old_pid == pid)
-				goto dont_switch_procs;
-			execve_thread = pink_easy_process_list_lookup(&(ctx->process_list), old_pid);
-			if (!execve_thread)
-				goto dont_switch_procs;
-
-			/* Drop leader, switch to the thread, reusing leader's pid */
-			PINK_EASY_REMOVE_PROCESS(ctx, current);
-			current = execve_thread;
-			current->pid = pid;
+	current = pink_easy_process_list_lookup(&(ctx->process_list), pid);
+	/* FIXME: pink_event_decide() is broken by design! */
+	event = ((unsigned) status >> 16);
+
+	/* Under Linux, execve changes pid to thread leader's pid,
+	 * and we see this changed pid on EVENT_EXEC and later,
+	 * execve sysexit. Leader "disappears" without exit
+	 * notification. Let user know that, drop leader's tcb,
+	 * and fix up pid in execve thread's tcb.
+	 * Effectively, execve thread's tcb replaces leader's tcb.
+	 *
+	 * BTW, leader is 'stuck undead' (doesn't report WIFEXITED
+	 * on exit syscall) in multithreaded programs exactly
+	 * in order to handle this case.
+	 *
+	 * PTRACE_GETEVENTMSG returns old pid starting from Linux 3.0.
+	 * On 2.6 and earlier, it can return garbage.
+	 */
+	if (event == PTRACE_EVENT_EXEC) {
+		pink_bitness_t old_bitness = current->bitness;
+		pink_easy_process_t *execve_thread = current;
+		long old_pid = 0;
+
+		if (pink_easy_os_release < KERNEL_VERSION(3,0,0))
+			goto dont_switch_procs;
+		if (!pink_trace_geteventmsg(pid, (unsigned long *)&old_pid))
+			goto dont_switch_procs;
+		if (old_pid <= 0 || old_pid == pid)
+			goto dont_switch_procs;
+		execve_thread = pink_easy_process_list_lookup(&(ctx->process_list), old_pid);
+		if (!execve_thread)
+			goto dont_switch_procs;
+
+		/* Drop leader, switch to the thread, reusing leader's pid */
+		PINK_EASY_REMOVE_PROCESS(ctx, current);
+		current = execve_thread;
+		pink_easy_process_list_remove(&(ctx->process_list), current);
+		pink_util_forget(current->pid);
+		current->pid = pid;
+		/* The leader's slot was just freed, this can not fail */
+		_pink_easy_process_list_insert(&(ctx->process_list), current);
 dont_switch_procs:
-			/* Update bitness */
-			current->bitness = pink_bitness_get(current->pid);
-			if (current->bitness == PINK_BITNESS_UNKNOWN) {
-				handle_ptrace_error(ctx, current, "bitness");
-				continue;
+		/* The process has a new address space */
+		if (ctx->options & PINK_EASY_OPTION_CACHE) {
+			pink_util_cache_enable(current->pid, false);
+			enable_cache(ctx, current->pid);
+		}
+		/* Update bitness */
+		current->bitness = get_bitness(current);
+		if (current->bitness == PINK_BITNESS_UNKNOWN) {
+			handle_ptrace_error(ctx, current, "bitness");
+			return true;
+		}
+		if (ctx->callback_table.exec) {
+			r = ctx->callback_table.exec(ctx, current, old_bitness);
+			if (r & PINK_EASY_CFLAG_ABORT) {
+				ctx->error = PINK_EASY_ERROR_CALLBACK_ABORT;
+				return false;
 			}
-			if (ctx->callback_table.exec) {
-				r = ctx->callback_table.exec(ctx, current, old_bitness);
-				if (r & PINK_EASY_CFLAG_ABORT) {
-					ctx->error = PINK_EASY_ERROR_CALLBACK_ABORT;
-					goto cleanup;
-				}
-				if (r & PINK_EASY_CFLAG_DROP) {
-					PINK_EASY_REMOVE_PROCESS(ctx, current);
-					continue;
-				}
+			if (r & PINK_EASY_CFLAG_DROP) {
+				PINK_EASY_REMOVE_PROCESS(ctx, current);
+				return true;
 			}
+			if (r & PINK_EASY_CFLAG_DETACH)
+				cflag_detach(current);
 		}
+	}
 
-		if (current == NULL) {
-			/* We might see the child's initial trap before we see the parent
-			 * return from the clone syscall. Leave the child suspended until
-			 * the parent returns from its system call. Only then we will have
-			 * the association between parent and child.
-			 */
-			PINK_EASY_INSERT_PROCESS(ctx, current);
-			current->pid = pid;
-			current->flags = PINK_EASY_PROCESS_STARTUP;
-			continue;
-		}
+	if (current == NULL) {
+		/* A child we detached from exited */
+		if (WIFSIGNALED(status) || WIFEXITED(status))
+			return true;
+		/* We might see the child's initial trap before we see the parent
+		 * return from the clone syscall. Leave the child suspended until
+		 * the parent returns from its system call. Only then we will have
+		 * the association between parent and child.
+		 */
+		PINK_EASY_INSERT_PROCESS(ctx, current, pid);
+		if (current == NULL)
+			return true;
+		current->flags = PINK_EASY_PROCESS_STARTUP;
+		return true;
+	}
 
-		if (WIFSIGNALED(status) || WIFEXITED(status)) {
-			PINK_EASY_REMOVE_PROCESS(ctx, current);
-			if (ctx->callback_table.exit) {
-				r = ctx->callback_table.exit(ctx, pid, status);
-				if (r & PINK_EASY_CFLAG_ABORT) {
-					ctx->error = PINK_EASY_ERROR_CALLBACK_ABORT;
-					goto cleanup;
-				}
+	if (WIFSIGNALED(status) || WIFEXITED(status)) {
+		PINK_EASY_REMOVE_PROCESS(ctx, current);
+		if (ctx->callback_table.exit) {
+			r = ctx->callback_table.exit(ctx, pid, status);
+			if (r & PINK_EASY_CFLAG_ABORT) {
+				ctx->error = PINK_EASY_ERROR_CALLBACK_ABORT;
+				return false;
 			}
-			continue;
 		}
-		if (!WIFSTOPPED(status)) {
-			ctx->callback_table.error(ctx, PINK_EASY_ERROR_PROCESS, current, "WIFSTOPPED");
+		return true;
+	}
+	if (!WIFSTOPPED(status)) {
+		ctx->callback_table.error(ctx, PINK_EASY_ERROR_PROCESS, current, "WIFSTOPPED");
+		PINK_EASY_REMOVE_PROCESS(ctx, current);
+		return true;
+	}
+
+	/* Pages of a read cache shared with other threads may have been read
+	 * at their stops while this one was running and writing to them */
+	if (ctx->options & PINK_EASY_OPTION_CACHE)
+		pink_util_cache_invalidate(current->pid);
+
+	/* Is this the very first time we see this tracee stopped? */
+	if (current->flags & PINK_EASY_PROCESS_STARTUP && !handle_startup(ctx, current))
+		return true;
+
+	/* Threads marked by pink_easy_process_detach() while they were running
+	 * are detached at their next stop, with the signal to be delivered */
+	if ((current->flags & (PINK_EASY_PROCESS_DETACH | PINK_EASY_PROCESS_DENIED))
+			== PINK_EASY_PROCESS_DETACH) {
+		sig = WSTOPSIG(status);
+		if (event != 0 || sig == (SIGTRAP|0x80)
+				|| (sig == SIGSTOP && current->flags & PINK_EASY_PROCESS_IGNORE_ONE_SIGSTOP)
+				|| (sig == SIGTRAP && current->flags & PINK_EASY_PROCESS_IGNORE_ONE_SIGTRAP))
+			sig = 0;
+		_pink_easy_process_detach(ctx, current, sig);
+		return true;
+	}
+
+	/* These events stop the tracee inside the system call, if a callback
+	 * raises the level to stop at system calls, the next system call stop
+	 * is the exit. Resuming with PTRACE_CONT clears the flag. */
+	if (event == PTRACE_EVENT_FORK || event == PTRACE_EVENT_VFORK
+			|| event == PTRACE_EVENT_CLONE || event == PTRACE_EVENT_EXEC
+			|| event == PTRACE_EVENT_VFORK_DONE)
+		current->flags |= PINK_EASY_PROCESS_INSYSCALL;
+
+	if (event == PTRACE_EVENT_STOP) {
+		/* Seized process: initial stop, PTRACE_INTERRUPT or the
+		 * end of a group-stop. Keep group-stops with
+		 * PTRACE_LISTEN so that the process stays stopped until
+		 * SIGCONT, the signal was reported when it was sent. */
+		if (pink_event_decide(status) == PINK_EVENT_GROUP_STOP) {
+			if (!pink_trace_listen(current->pid))
+				handle_ptrace_error(ctx, current, "listen");
+			return true;
+		}
+		goto restart_tracee_with_sig_0;
+	} else if (event == PTRACE_EVENT_FORK || event == PTRACE_EVENT_VFORK || event == PTRACE_EVENT_CLONE) {
+		pink_easy_process_t *new_thread;
+		long new_pid;
+		if (!pink_trace_geteventmsg(current->pid, (unsigned long *)&new_pid)) {
+			handle_ptrace_error(ctx, current, "geteventmsg");
+			return true;
+		}
+		if (ctx->options & PINK_EASY_OPTION_CACHE)
+			setup_child_cache(ctx, current, new_pid, event);
+		new_thread = pink_easy_process_list_lookup(&(ctx->process_list), new_pid);
+		if (new_thread == NULL) {
+			/* Not attached to the thread yet, nor is it alive... */
+			PINK_EASY_INSERT_PROCESS(ctx, new_thread, new_pid);
+			if (new_thread == NULL)
+				goto restart_tracee_with_sig_0;
+			new_thread->flags = PINK_EASY_PROCESS_STARTUP;
+			/* Children of seized processes start with
+			 * PTRACE_EVENT_STOP instead of SIGSTOP */
+			if (current->flags & PINK_EASY_PROCESS_SEIZED)
+				new_thread->flags |= PINK_EASY_PROCESS_SEIZED;
+			else
+				new_thread->flags |= PINK_EASY_PROCESS_IGNORE_ONE_SIGSTOP;
+			/* Seccomp filters are inherited */
+			new_thread->flags |= current->flags & PINK_EASY_PROCESS_SECCOMP;
+			new_thread->ppid = current->pid;
+		} else {
+			/* Thread is waiting for Pink to let her go on... */
+			new_thread->ppid = current->pid;
+			new_thread->bitness = current->bitness;
+			new_thread->level = current->level;
+			new_thread->flags &= ~PINK_EASY_PROCESS_STARTUP;
+			new_thread->flags |= current->flags
+				& (PINK_EASY_PROCESS_SECCOMP | PINK_EASY_PROCESS_SEIZED);
+			/* Happy birthday! */
+			if (ctx->callback_table.startup)
+				ctx->callback_table.startup(ctx, new_thread, current);
+			if (!resume_tracee(ctx, new_thread, 0))
+				handle_ptrace_error(ctx, current, "syscall");
+		}
+	} else if (event == PTRACE_EVENT_EXIT && ctx->callback_table.pre_exit) {
+		unsigned long status;
+		if (!pink_trace_geteventmsg(current->pid, &status)) {
+			handle_ptrace_error(ctx, current, "geteventmsg");
+			return true;
+		}
+		r = ctx->callback_table.pre_exit(ctx, current, (int)status);
+		if (r & PINK_EASY_CFLAG_ABORT) {
+			ctx->error = PINK_EASY_ERROR_CALLBACK_ABORT;
+			return false;
+		}
+		if (r & PINK_EASY_CFLAG_DROP) {
 			PINK_EASY_REMOVE_PROCESS(ctx, current);
-			continue;
+			return true;
 		}
+		if (r & PINK_EASY_CFLAG_DETACH)
+			cflag_detach(current);
+	} else if (event == PTRACE_EVENT_SECCOMP) {
+		unsigned long data = 0;
 
-		/* Is this the very first time we see this tracee stopped? */
-		if (current->flags & PINK_EASY_PROCESS_STARTUP && !handle_startup(ctx, current))
-			continue;
-
-		if (event == PTRACE_EVENT_FORK || event == PTRACE_EVENT_VFORK || event == PTRACE_EVENT_CLONE) {
-			pink_easy_process_t *new_thread;
-			long new_pid;
-			if (!pink_trace_geteventmsg(current->pid, (unsigned long *)&new_pid)) {
-				handle_ptrace_error(ctx, current, "geteventmsg");
-				continue;
-			}
-			new_thread = pink_easy_process_list_lookup(&(ctx->process_list), new_pid);
-			if (new_thread == NULL) {
-				/* Not attached to the thread yet, nor is it alive... */
-				PINK_EASY_INSERT_PROCESS(ctx, new_thread);
-				new_thread->pid = pid;
-				new_thread->flags = (PINK_EASY_PROCESS_STARTUP | PINK_EASY_PROCESS_IGNORE_ONE_SIGSTOP);
-				new_thread->ppid = current->pid;
-			} else {
-				/* Thread is waiting for Pink to let her go on... */
-				new_thread->ppid = current->pid;
-				new_thread->bitness = current->bitness;
-				new_thread->flags &= ~PINK_EASY_PROCESS_STARTUP;
-				/* Happy birthday! */
-				if (ctx->callback_table.startup)
-					ctx->callback_table.startup(ctx, new_thread, current);
-				if (!pink_trace_syscall(new_thread->pid, 0))
-					handle_ptrace_error(ctx, current, "syscall");
+		/* The return value of the filter tells which system calls
+		 * stop at exit for the read cache */
+		if (ctx->options & PINK_EASY_OPTION_CACHE
+				&& !pink_trace_geteventmsg(current->pid, &data)) {
+			handle_ptrace_error(ctx, current, "geteventmsg");
+			return true;
+		}
+		if (data & PINK_EASY_SECCOMP_MAPS)
+			current->flags |= PINK_EASY_PROCESS_INSYSCALL | PINK_EASY_PROCESS_MAPS;
+		if (!(data & PINK_EASY_SECCOMP_QUIET) && want_syscall(ctx)
+				&& current->level == PINK_EASY_TRACE_SYSCALL) {
+			/* The filter stops the tracee on system call entry, the
+			 * following system call stop, if any, is the exit. */
+			current->flags |= PINK_EASY_PROCESS_INSYSCALL;
+			have_info = pink_trace_get_syscall_info(current->pid, &info);
+			if (!have_info && errno != ENOSYS) {
+				handle_ptrace_error(ctx, current, "get_syscall_info");
+				return true;
 			}
-		} else if (event == PTRACE_EVENT_EXIT && ctx->callback_table.pre_exit) {
-			unsigned long status;
-			if (!pink_trace_geteventmsg(current->pid, &status)) {
-				handle_ptrace_error(ctx, current, "geteventmsg");
-				continue;
+			r = dispatch_syscall(ctx, current, true, have_info, &info);
+			if (r < 0) {
+				handle_ptrace_error(ctx, current, "getregs");
+				return true;
 			}
-			r = ctx->callback_table.pre_exit(ctx, current, (int)status);
 			if (r & PINK_EASY_CFLAG_ABORT) {
 				ctx->error = PINK_EASY_ERROR_CALLBACK_ABORT;
-				goto cleanup;
+				return false;
 			}
 			if (r & PINK_EASY_CFLAG_DROP) {
 				PINK_EASY_REMOVE_PROCESS(ctx, current);
-				continue;
+				return true;
+			}
+			if (r & PINK_EASY_CFLAG_DETACH)
+				cflag_detach(current);
+			if (r & PINK_EASY_CFLAG_PENDING) {
+				park_tracee(ctx, current);
+				return true;
 			}
 		}
+	}
 
-		sig = WSTOPSIG(status);
-
-		if (event != 0) /* Ptrace event */
-			goto restart_tracee_with_sig_0;
+	sig = WSTOPSIG(status);
 
-		/* Is this post-attach SIGSTOP? */
-		if (sig == SIGSTOP && (current->flags & PINK_EASY_PROCESS_IGNORE_ONE_SIGSTOP)) {
-			current->flags &= ~PINK_EASY_PROCESS_IGNORE_ONE_SIGSTOP;
-			goto restart_tracee_with_sig_0;
-		}
-		if (sig != (SIGTRAP|0x80)) {
-			if (ctx->callback_table.signal) {
-				r = ctx->callback_table.signal(ctx, current, status);
-				if (r & PINK_EASY_CFLAG_ABORT) {
-					ctx->error = PINK_EASY_ERROR_CALLBACK_ABORT;
-					goto cleanup;
-				}
-				if (r & PINK_EASY_CFLAG_DROP) {
-					PINK_EASY_REMOVE_PROCESS(ctx, current);
-					continue;
-				}
-				if (r & PINK_EASY_CFLAG_SIGIGN)
-					goto restart_tracee_with_sig_0;
-			}
-			goto restart_tracee;
-		}
+	if (event != 0) /* Ptrace event */
+		goto restart_tracee_with_sig_0;
 
-		/* System call trap! */
-		current->flags ^= PINK_EASY_PROCESS_INSYSCALL;
-		if (ctx->callback_table.syscall) {
-			bool entering = current->flags & PINK_EASY_PROCESS_INSYSCALL;
-			r = ctx->callback_table.syscall(ctx, current, entering);
+	/* Is this post-attach SIGSTOP? */
+	if (sig == SIGSTOP && (current->flags & PINK_EASY_PROCESS_IGNORE_ONE_SIGSTOP)) {
+		current->flags &= ~PINK_EASY_PROCESS_IGNORE_ONE_SIGSTOP;
+		goto restart_tracee_with_sig_0;
+	}
+	/* Is this the SIGTRAP raised by execve() in a spawned child? */
+	if (sig == SIGTRAP && (current->flags & PINK_EASY_PROCESS_IGNORE_ONE_SIGTRAP)) {
+		current->flags &= ~PINK_EASY_PROCESS_IGNORE_ONE_SIGTRAP;
+		goto restart_tracee_with_sig_0;
+	}
+	if (sig != (SIGTRAP|0x80)) {
+		if (ctx->callback_table.signal) {
+			r = ctx->callback_table.signal(ctx, current, status);
 			if (r & PINK_EASY_CFLAG_ABORT) {
 				ctx->error = PINK_EASY_ERROR_CALLBACK_ABORT;
-				goto cleanup;
+				return false;
 			}
 			if (r & PINK_EASY_CFLAG_DROP) {
 				PINK_EASY_REMOVE_PROCESS(ctx, current);
-				continue;
+				return true;
 			}
+			if (r & PINK_EASY_CFLAG_DETACH)
+				cflag_detach(current);
+			if (r & PINK_EASY_CFLAG_SIGIGN)
+				goto restart_tracee_with_sig_0;
 		}
+		goto restart_tracee;
+	}
+
+	/* System call trap! */
+	have_info = pink_trace_get_syscall_info(current->pid, &info);
+	if (!have_info && errno != ENOSYS) {
+		handle_ptrace_error(ctx, current, "get_syscall_info");
+		return true;
+	}
+	if (have_info && info.op != PINK_SYSCALL_INFO_NONE) {
+		/* The kernel knows whether this is entry or exit */
+		if (info.op == PINK_SYSCALL_INFO_EXIT)
+			current->flags &= ~PINK_EASY_PROCESS_INSYSCALL;
+		else
+			current->flags |= PINK_EASY_PROCESS_INSYSCALL;
+		if (info.bitness != PINK_BITNESS_UNKNOWN)
+			current->bitness = info.bitness;
+	} else {
+		have_info = false;
+		current->flags ^= PINK_EASY_PROCESS_INSYSCALL;
+	}
+	/* The system call was denied by a verdict at entry */
+	if (current->flags & PINK_EASY_PROCESS_DENIED
+			&& !(current->flags & PINK_EASY_PROCESS_INSYSCALL)) {
+		current->flags &= ~PINK_EASY_PROCESS_DENIED;
+		if (!pink_util_set_return(current->pid, -current->deny_errno)) {
+			handle_ptrace_error(ctx, current, "verdict");
+			return true;
+		}
+	}
+	if (ctx->options & PINK_EASY_OPTION_CACHE
+			&& !(current->flags & PINK_EASY_PROCESS_INSYSCALL))
+		check_maps(ctx, current, have_info, &info);
+	/* Stopped at exit for the read cache only */
+	if (current->flags & PINK_EASY_PROCESS_MAPS) {
+		current->flags &= ~PINK_EASY_PROCESS_MAPS;
+		if (!(current->flags & PINK_EASY_PROCESS_SYSEXIT))
+			goto restart_tracee_with_sig_0;
+	}
+	if (current->level != PINK_EASY_TRACE_SYSCALL)
+		goto restart_tracee_with_sig_0;
+	r = dispatch_syscall(ctx, current,
+			current->flags & PINK_EASY_PROCESS_INSYSCALL,
+			have_info, &info);
+	if (r < 0) {
+		handle_ptrace_error(ctx, current, "getregs");
+		return true;
+	}
+	if (r & PINK_EASY_CFLAG_ABORT) {
+		ctx->error = PINK_EASY_ERROR_CALLBACK_ABORT;
+		return false;
+	}
+	if (r & PINK_EASY_CFLAG_DROP) {
+		PINK_EASY_REMOVE_PROCESS(ctx, current);
+		return true;
+	}
+	if (r & PINK_EASY_CFLAG_DETACH)
+		cflag_detach(current);
+	if (r & PINK_EASY_CFLAG_PENDING) {
+		park_tracee(ctx, current);
+		return true;
+	}
 
 restart_tracee_with_sig_0:
-		sig = 0;
+	sig = 0;
 restart_tracee:
-		if (!pink_trace_syscall(current->pid, sig))
-			handle_ptrace_error(ctx, current, "syscall");
+	if (!resume_tracee(ctx, current, sig))
+		handle_ptrace_error(ctx, current, "syscall");
+	return true;
+}
+
+/* waitpid() failed for good, no children left is no error */
+static void wait_failed(pink_easy_context_t *ctx)
+{
+	if (errno != ECHILD) {
+		ctx->fatal = true;
+		ctx->error = PINK_EASY_ERROR_WAIT;
+		ctx->callback_table.error(ctx);
+	}
+}
+
+/* Collect the stops which are pending already, waitpid() reports the
+ * children in the same order every time so handling one stop at a time lets
+ * the first ones starve the others. The first stop, if any, is given.
+ * Returns the number of stops handled or -1 if the loop is over. */
+static int handle_batch(pink_easy_context_t *ctx, pid_t pid, int status)
+{
+	unsigned i, n;
+	struct {
+		pid_t pid;
+		int status;
+	} batch[PINK_EASY_BATCH_MAX];
+
+	n = 0;
+	if (pid > 0) {
+		batch[0].pid = pid;
+		batch[0].status = status;
+		n = 1;
+	}
+	while (n < PINK_EASY_BATCH_MAX) {
+		pid = waitpid(-1, &status, __WALL | __WNOTHREAD | WNOHANG);
+		if (pid == 0)
+			break;
+		if (pid < 0) {
+			if (errno == EINTR)
+				continue;
+			if (n > 0)
+				break;
+			wait_failed(ctx);
+			return -1;
+		}
+		batch[n].pid = pid;
+		batch[n].status = status;
+		n++;
+	}
+	if (n == 0)
+		return 0;
+
+	ctx->batches++;
+	ctx->batch_stops += n;
+	if (n > ctx->batch_max)
+		ctx->batch_max = n;
+
+	for (i = 0; i < n && ctx->nprocs != 0; i++) {
+		if (!handle_event(ctx, batch[i].pid, batch[i].status))
+			return -1;
 	}
+	return n;
+}
 
-cleanup:
+static int loop_done(pink_easy_context_t *ctx)
+{
 	return ctx->callback_table.cleanup
 		? ctx->callback_table.cleanup(ctx)
 		: (ctx->error ? EXIT_FAILURE : EXIT_SUCCESS);
 }
+
+/* Handle the verdicts and the stops which are pending, without blocking.
+ * Returns false if the loop is over. */
+static bool loop_pending(pink_easy_context_t *ctx)
+{
+	int r;
+
+#ifdef HAVE_LOOP_FD
+	/* Stops after this point make the descriptor readable again */
+	if (ctx->signal_fd >= 0) {
+		struct signalfd_siginfo info;
+
+		while (read(ctx->signal_fd, &info, sizeof(info)) > 0)
+			/* void */;
+	}
+#endif
+
+	handle_verdicts(ctx);
+
+	/* A full batch means there may be more pending stops, whose SIGCHLD
+	 * was consumed above already */
+	while (ctx->nprocs != 0) {
+		r = handle_batch(ctx, 0, 0);
+		if (r < 0)
+			return false;
+		if (r < PINK_EASY_BATCH_MAX && ctx->nprocs != 0)
+			return true;
+	}
+	return false;
+}
+
+static void wakeup_handler(int sig)
+{
+	if (wakeup_armed) {
+		wakeup_armed = 0;
+		siglongjmp(wakeup_env, 1);
+	}
+}
+
+/* Install the handler of PINK_EASY_WAKEUP_SIGNAL, without SA_RESTART so that
+ * the signal interrupts the wait even if it arrives during the system call */
+static bool wakeup_install(void)
+{
+	struct sigaction sa;
+
+	if (__atomic_load_n(&wakeup_installed, __ATOMIC_RELAXED))
+		return true;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = wakeup_handler;
+	sigemptyset(&sa.sa_mask);
+	if (sigaction(PINK_EASY_WAKEUP_SIGNAL, &sa, NULL) < 0)
+		return false;
+	__atomic_store_n(&wakeup_installed, 1, __ATOMIC_RELAXED);
+	return true;
+}
+
+/* Some tracees wait for their verdicts, block until one of the others stops
+ * or pink_easy_process_complete() sends PINK_EASY_WAKEUP_SIGNAL. The signal
+ * may arrive before the wait starts, the handler jumps out then; the wait
+ * does not reap the stop so that jumping out after it returned loses nothing,
+ * loop_pending() collects the stops. Returns false if the loop is over. */
+static bool loop_wait_pending(pink_easy_context_t *ctx)
+{
+	siginfo_t info;
+
+	if (!wakeup_install()) {
+		ctx->fatal = true;
+		ctx->error = PINK_EASY_ERROR_WAIT;
+		ctx->callback_table.error(ctx);
+		return false;
+	}
+
+	ctx->loop_thread = pthread_self();
+	if (!sigsetjmp(wakeup_env, 1)) {
+		wakeup_armed = 1;
+		__atomic_store_n(&ctx->loop_waiting, 1, __ATOMIC_SEQ_CST);
+		if (!__atomic_load_n(&ctx->verdicts, __ATOMIC_SEQ_CST)
+				&& waitid(P_ALL, 0, &info, WEXITED | WSTOPPED | WNOWAIT | __WALL | __WNOTHREAD) < 0
+				&& errno != EINTR) {
+			wakeup_armed = 0;
+			__atomic_store_n(&ctx->loop_waiting, 0, __ATOMIC_RELAXED);
+			wait_failed(ctx);
+			return false;
+		}
+		wakeup_armed = 0;
+	}
+	__atomic_store_n(&ctx->loop_waiting, 0, __ATOMIC_RELAXED);
+
+	return loop_pending(ctx);
+}
+
+int pink_easy_loop(pink_easy_context_t *ctx)
+{
+	/* Enter the event loop */
+	while (ctx->nprocs != 0) {
+		pid_t pid;
+		int status;
+
+		if (ctx->npending != 0) {
+			if (!loop_wait_pending(ctx))
+				break;
+			continue;
+		}
+
+		/* Tracees belong to the thread which traced them, wait only
+		 * for those of this thread so that worker threads may run a
+		 * loop each */
+		pid = waitpid(-1, &status, __WALL | __WNOTHREAD);
+		if (pid < 0) {
+			if (errno == EINTR)
+				continue;
+			wait_failed(ctx);
+			break;
+		}
+
+		if (!(ctx->options & PINK_EASY_OPTION_BATCH)) {
+			if (!handle_event(ctx, pid, status))
+				break;
+		} else if (handle_batch(ctx, pid, status) < 0) {
+			break;
+		}
+	}
+
+	return loop_done(ctx);
+}
+
+#ifdef HAVE_LOOP_FD
+static bool loop_fd_add(pink_easy_context_t *ctx, int fd)
+{
+	struct epoll_event event;
+
+	event.events = EPOLLIN;
+	event.data.fd = fd;
+	return epoll_ctl(ctx->loop_fd, EPOLL_CTL_ADD, fd, &event) == 0;
+}
+#endif
+
+int pink_easy_loop_fd(pink_easy_context_t *ctx)
+{
+#ifdef HAVE_LOOP_FD
+	int fd;
+	sigset_t mask;
+
+	if (ctx->loop_fd >= 0)
+		return ctx->loop_fd;
+
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGCHLD);
+	errno = pthread_sigmask(SIG_BLOCK, &mask, NULL);
+	if (errno)
+		return -1;
+	if (ctx->signal_fd < 0) {
+		ctx->signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+		if (ctx->signal_fd < 0)
+			return -1;
+	}
+	if (ctx->verdict_fd < 0) {
+		fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if (fd < 0)
+			return -1;
+		__sync_lock_test_and_set(&ctx->verdict_fd, fd);
+	}
+
+	/* Readable when a tracee stops or a verdict is posted */
+	ctx->loop_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (ctx->loop_fd < 0)
+		return -1;
+	if (!loop_fd_add(ctx, ctx->signal_fd) || !loop_fd_add(ctx, ctx->verdict_fd)) {
+		close(ctx->loop_fd);
+		ctx->loop_fd = -1;
+		return -1;
+	}
+	return ctx->loop_fd;
+#else
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
+/* Called in a newly spawned child, which must not inherit the SIGCHLD
+ * blocked for pink_easy_loop_fd() */
+void _pink_easy_loop_child(const pink_easy_context_t *ctx)
+{
+#ifdef HAVE_LOOP_FD
+	sigset_t mask;
+
+	if (ctx->signal_fd < 0)
+		return;
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGCHLD);
+	pthread_sigmask(SIG_UNBLOCK, &mask, NULL);
+#endif
+}
+
+bool pink_easy_loop_step(pink_easy_context_t *ctx, int *retval)
+{
+	int r;
+
+	if (ctx->nprocs != 0 && loop_pending(ctx))
+		return true;
+
+	r = loop_done(ctx);
+	if (retval)
+		*retval = r;
+	return false;
+}
@@ -0,0 +1,392 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <pinktrace/easy/internal.h>
+#include <pinktrace/pink.h>
+#include <pinktrace/easy/pink.h>
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <alloca.h>
+#include <sys/types.h>
+#include <sys/ioctl.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+
+#ifdef HAVE_LINUX_SECCOMP_H
+#include <linux/filter.h>
+#include <linux/seccomp.h>
+#endif /* HAVE_LINUX_SECCOMP_H */
+
+#ifndef PR_SET_NO_NEW_PRIVS
+#define PR_SET_NO_NEW_PRIVS	38
+#endif /* !PR_SET_NO_NEW_PRIVS */
+
+#if defined(SECCOMP_IOCTL_NOTIF_RECV) && defined(SECCOMP_USER_NOTIF_FLAG_CONTINUE) && defined(__NR_seccomp)
+bool
+pink_easy_context_seccomp_notify(pink_easy_context_t *ctx, bool notify)
+{
+	ctx->seccomp_notify = notify;
+	return true;
+}
+
+/* Runs in the child: install the filter and send the listener to the parent.
+ * The filter is already active when sendmsg(2) is called. */
+bool
+_pink_easy_notify_install(struct sock_filter *filter, unsigned short len, int sock)
+{
+	int fd;
+	bool r;
+	char c;
+	struct iovec iov;
+	struct msghdr msg;
+	struct cmsghdr *cmsg;
+	struct sock_fprog prog;
+	union {
+		char buf[CMSG_SPACE(sizeof(int))];
+		struct cmsghdr align;
+	} control;
+
+	prog.len = len;
+	prog.filter = filter;
+
+	if (prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) < 0)
+		return false;
+	fd = syscall(__NR_seccomp, SECCOMP_SET_MODE_FILTER,
+			SECCOMP_FILTER_FLAG_NEW_LISTENER, &prog);
+	if (fd < 0)
+		return false;
+
+	c = 0;
+	iov.iov_base = &c;
+	iov.iov_len = 1;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.buf;
+	msg.msg_controllen = sizeof(control.buf);
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+	memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+	r = !(sendmsg(sock, &msg, 0) < 0);
+	close(fd);
+	close(sock);
+	return r;
+}
+
+/* Runs in the parent: receive the listener of the child */
+bool
+_pink_easy_notify_listen(pink_easy_context_t *ctx, pid_t pid, int sock[2])
+{
+	int fd, *fds;
+	char c;
+	ssize_t r;
+	struct iovec iov;
+	struct msghdr msg;
+	struct cmsghdr *cmsg;
+	union {
+		char buf[CMSG_SPACE(sizeof(int))];
+		struct cmsghdr align;
+	} control;
+
+	close(sock[1]);
+
+	iov.iov_base = &c;
+	iov.iov_len = 1;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.buf;
+	msg.msg_controllen = sizeof(control.buf);
+
+	do {
+		r = recvmsg(sock[0], &msg, MSG_CMSG_CLOEXEC);
+	} while (r < 0 && errno == EINTR);
+	close(sock[0]);
+
+	fd = -1;
+	cmsg = r > 0 ? CMSG_FIRSTHDR(&msg) : NULL;
+	if (cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+		memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+	if (fd < 0) {
+		/* The child failed to set up the filter, it reports the reason */
+		if (r >= 0)
+			errno = ENOMSG;
+		ctx->error = PINK_EASY_ERROR_FORK;
+		ctx->callback_table.error(ctx, PINK_EASY_ERROR_FORK, "recvmsg");
+		kill(pid, SIGKILL);
+		waitpid(pid, NULL, 0);
+		return false;
+	}
+
+	fds = realloc(ctx->notify_fds, (ctx->notify_nfds + 1) * sizeof(int));
+	if (!fds) {
+		close(fd);
+		ctx->error = PINK_EASY_ERROR_ALLOC;
+		ctx->callback_table.error(ctx, PINK_EASY_ERROR_ALLOC, "realloc");
+		kill(pid, SIGKILL);
+		waitpid(pid, NULL, 0);
+		return false;
+	}
+	fds[ctx->notify_nfds++] = fd;
+	ctx->notify_fds = fds;
+	return true;
+}
+
+bool
+pink_easy_notify_handle(pink_easy_context_t *ctx, int fd)
+{
+	int r;
+	unsigned i;
+	pink_arena_t *arena;
+	pink_syscall_info_t info;
+	pink_easy_process_t *current;
+	const struct pink_easy_syscall_handler *handler;
+	struct seccomp_notif req;
+	struct seccomp_notif_resp resp;
+
+	memset(&req, 0, sizeof(req));
+	if (ioctl(fd, SECCOMP_IOCTL_NOTIF_RECV, &req) < 0) {
+		/* ENOENT: the process died before we received the notification */
+		if (errno == ENOENT || errno == EINTR)
+			return true;
+		ctx->error = PINK_EASY_ERROR_NOTIFY;
+		ctx->fatal = true;
+		ctx->callback_table.error(ctx, PINK_EASY_ERROR_NOTIFY, "recv");
+		return false;
+	}
+
+	/* Other threads may handle notifications meanwhile, each has an arena */
+	arena = _pink_easy_thread_arena(false);
+	if (arena)
+		pink_arena_reset(arena);
+
+	memset(&info, 0, sizeof(info));
+	info.op = PINK_SYSCALL_INFO_SECCOMP;
+	info.arch = req.data.arch;
+	info.ip = req.data.instruction_pointer;
+	info.scno = req.data.nr;
+	for (i = 0; i < PINK_MAX_ARGS; i++)
+		info.args[i] = req.data.args[i];
+
+	/* Transient process entry, only valid during the callback */
+	current = alloca(ctx->process_size);
+	memset(current, 0, ctx->process_size);
+	current->flags = PINK_EASY_PROCESS_SECCOMP;
+	current->pid = req.pid;
+	current->ppid = -1;
+
+	r = 0;
+	if (!pink_util_set_syscall_info(req.pid, &info)) {
+		ctx->callback_table.error(ctx, PINK_EASY_ERROR_ALLOC, "malloc");
+	} else {
+		current->bitness = pink_bitness_get(req.pid);
+		handler = _pink_easy_syscall_handler(ctx, current->bitness,
+				req.data.nr, PINK_EASY_SYSCALL_ENTRY);
+		if (ctx->callback_table.syscall)
+			r = ctx->callback_table.syscall(ctx, current, true);
+		if (handler && !(r & PINK_EASY_CFLAG_ABORT))
+			r |= handler->func(ctx, current, true);
+		pink_util_forget(req.pid);
+	}
+	if (current->userdata_destroy && current->userdata)
+		current->userdata_destroy(current->userdata);
+
+	/* Whatever the callback read from the process memory is only
+	 * meaningful if the process is still alive, i.e. its pid has not been
+	 * reused in the meantime. */
+	if (ioctl(fd, SECCOMP_IOCTL_NOTIF_ID_VALID, &req.id) < 0)
+		goto out;
+
+	memset(&resp, 0, sizeof(resp));
+	resp.id = req.id;
+	if (r & PINK_EASY_CFLAG_DENY)
+		resp.error = -EPERM;
+	else
+		resp.flags = SECCOMP_USER_NOTIF_FLAG_CONTINUE;
+	if (ioctl(fd, SECCOMP_IOCTL_NOTIF_SEND, &resp) < 0 && errno != ENOENT) {
+		ctx->error = PINK_EASY_ERROR_NOTIFY;
+		ctx->fatal = true;
+		ctx->callback_table.error(ctx, PINK_EASY_ERROR_NOTIFY, "send");
+		return false;
+	}
+
+out:
+	if (r & PINK_EASY_CFLAG_ABORT) {
+		ctx->error = PINK_EASY_ERROR_CALLBACK_ABORT;
+		return false;
+	}
+	return true;
+}
+
+static bool
+notify_reap(pink_easy_context_t *ctx, int options)
+{
+	int r, status;
+	pid_t pid;
+
+	while ((pid = waitpid(-1, &status, __WALL | __WNOTHREAD | options)) > 0) {
+		if (!WIFEXITED(status) && !WIFSIGNALED(status))
+			continue;
+		if (!ctx->callback_table.exit)
+			continue;
+		r = ctx->callback_table.exit(ctx, pid, status);
+		if (r & PINK_EASY_CFLAG_ABORT) {
+			ctx->error = PINK_EASY_ERROR_CALLBACK_ABORT;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+int
+pink_easy_notify_loop(pink_easy_context_t *ctx)
+{
+	unsigned i, n;
+	struct pollfd *pfd;
+
+	pfd = NULL;
+	while (ctx->notify_nfds > 0) {
+		struct pollfd *p;
+
+		n = ctx->notify_nfds;
+		p = realloc(pfd, n * sizeof(struct pollfd));
+		if (!p) {
+			ctx->error = PINK_EASY_ERROR_ALLOC;
+			ctx->fatal = true;
+			ctx->callback_table.error(ctx, PINK_EASY_ERROR_ALLOC, "realloc");
+			goto cleanup;
+		}
+		pfd = p;
+		for (i = 0; i < n; i++) {
+			pfd[i].fd = ctx->notify_fds[i];
+			pfd[i].events = POLLIN;
+			pfd[i].revents = 0;
+		}
+
+		if (poll(pfd, n, -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			ctx->error = PINK_EASY_ERROR_NOTIFY;
+			ctx->fatal = true;
+			ctx->callback_table.error(ctx, PINK_EASY_ERROR_NOTIFY, "poll");
+			goto cleanup;
+		}
+
+		for (i = 0; i < n; i++) {
+			if (pfd[i].revents & POLLIN) {
+				if (!pink_easy_notify_handle(ctx, pfd[i].fd))
+					goto cleanup;
+			} else if (pfd[i].revents & (POLLHUP | POLLERR | POLLNVAL)) {
+				/* All processes using the filter exited */
+				close(pfd[i].fd);
+				pfd[i].fd = -1;
+			}
+		}
+
+		/* Forget the listeners which hung up */
+		ctx->notify_nfds = 0;
+		for (i = 0; i < n; i++) {
+			if (pfd[i].fd >= 0)
+				ctx->notify_fds[ctx->notify_nfds++] = pfd[i].fd;
+		}
+
+		if (!notify_reap(ctx, WNOHANG))
+			goto cleanup;
+	}
+
+	notify_reap(ctx, 0);
+
+cleanup:
+	free(pfd);
+	return ctx->callback_table.cleanup
+		? ctx->callback_table.cleanup(ctx)
+		: (ctx->error ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+#else
+bool
+pink_easy_context_seccomp_notify(PINK_GCC_ATTR((unused)) pink_easy_context_t *ctx,
+		PINK_GCC_ATTR((unused)) bool notify)
+{
+	errno = ENOTSUP;
+	return false;
+}
+
+bool
+_pink_easy_notify_install(PINK_GCC_ATTR((unused)) struct sock_filter *filter,
+		PINK_GCC_ATTR((unused)) unsigned short len,
+		PINK_GCC_ATTR((unused)) int sock)
+{
+	errno = ENOTSUP;
+	return false;
+}
+
+bool
+_pink_easy_notify_listen(pink_easy_context_t *ctx, pid_t pid,
+		PINK_GCC_ATTR((unused)) int sock[2])
+{
+	errno = ENOTSUP;
+	ctx->error = PINK_EASY_ERROR_FORK;
+	ctx->callback_table.error(ctx, PINK_EASY_ERROR_FORK, "seccomp");
+	kill(pid, SIGKILL);
+	waitpid(pid, NULL, 0);
+	return false;
+}
+
+bool
+pink_easy_notify_handle(PINK_GCC_ATTR((unused)) pink_easy_context_t *ctx,
+		PINK_GCC_ATTR((unused)) int fd)
+{
+	errno = ENOTSUP;
+	return false;
+}
+
+int
+pink_easy_notify_loop(pink_easy_context_t *ctx)
+{
+	return ctx->callback_table.cleanup
+		? ctx->callback_table.cleanup(ctx)
+		: (ctx->error ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+#endif /* SECCOMP_IOCTL_NOTIF_RECV && SECCOMP_USER_NOTIF_FLAG_CONTINUE && __NR_seccomp */
+
+int
+pink_easy_notify_fd(const pink_easy_context_t *ctx)
+{
+	return ctx->notify_nfds ? ctx->notify_fds[ctx->notify_nfds - 1] : -1;
+}
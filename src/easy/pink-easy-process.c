@@ -29,12 +29,15 @@
 #include <pinktrace/pink.h>
 #include <pinktrace/easy/pink.h>
 
+#include <dirent.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <signal.h>
 #include <sys/types.h>
-#include <sys/queue.h>
 #include <sys/syscall.h>
 #include <asm/unistd.h>
 
@@ -64,6 +67,120 @@ pink_easy_process_resume(const pink_easy_process_t *proc, int sig)
 		return pink_trace_resume(proc->pid, sig);
 }
 
+bool
+pink_easy_process_complete(pink_easy_context_t *ctx, pink_easy_token_t token,
+		const pink_easy_verdict_t *verdict)
+{
+	int fd;
+	uint64_t one = 1;
+	struct pink_easy_verdict_node *node;
+
+	node = malloc(sizeof(struct pink_easy_verdict_node));
+	if (!node)
+		return false;
+	node->token = token;
+	node->verdict = *verdict;
+	do {
+		node->next = ctx->verdicts;
+	} while (!__sync_bool_compare_and_swap(&ctx->verdicts, node->next, node));
+
+	/* The tracing thread checks the queue after creating the descriptor,
+	 * a verdict posted before is not missed */
+	fd = __sync_fetch_and_add(&ctx->verdict_fd, 0);
+	if (fd >= 0 && write(fd, &one, sizeof(one)) < 0) {
+		/* The counter is full, the descriptor is readable already */
+	}
+
+	/* The tracing thread checks the queue after setting the flag, either it
+	 * sees the verdict or the signal interrupts its wait */
+	if (__atomic_load_n(&ctx->loop_waiting, __ATOMIC_SEQ_CST))
+		pthread_kill(ctx->loop_thread, PINK_EASY_WAKEUP_SIGNAL);
+	return true;
+}
+
+static void
+mark_detach(pink_easy_process_t *proc)
+{
+	proc->flags |= PINK_EASY_PROCESS_DETACH;
+	/* Make a running process stop so that it is detached soon, the stop
+	 * is discarded on detach if the process is stopped already */
+	if (proc->flags & PINK_EASY_PROCESS_SEIZED)
+		pink_trace_interrupt(proc->pid);
+}
+
+bool
+pink_easy_process_detach(const pink_easy_context_t *ctx, pink_easy_process_t *proc,
+		bool group)
+{
+	pid_t tid;
+	char path[32];
+	DIR *dir;
+	struct dirent *ent;
+	pink_easy_process_t *thread;
+
+	/* The seccomp filter stays installed after detach */
+	if (proc->flags & PINK_EASY_PROCESS_SECCOMP) {
+		errno = EBUSY;
+		return false;
+	}
+
+	if (group) {
+		snprintf(path, sizeof(path), "/proc/%ld/task", (long)proc->pid);
+		dir = opendir(path);
+		if (!dir)
+			return false;
+		while ((ent = readdir(dir)) != NULL) {
+			tid = atoi(ent->d_name);
+			if (tid <= 0 || tid == proc->pid)
+				continue;
+			thread = pink_easy_process_list_lookup(&(ctx->process_list), tid);
+			if (thread && !(thread->flags & PINK_EASY_PROCESS_SECCOMP))
+				mark_detach(thread);
+		}
+		closedir(dir);
+	}
+
+	mark_detach(proc);
+	return true;
+}
+
+void
+_pink_easy_process_detach(pink_easy_context_t *ctx, pink_easy_process_t *proc, int sig)
+{
+	if (ctx->callback_table.teardown)
+		ctx->callback_table.teardown(ctx, proc);
+	/* Pending register modifications are written back */
+	if (!pink_trace_detach(proc->pid, sig) && errno != ESRCH)
+		ctx->callback_table.error(ctx, PINK_EASY_ERROR_TRACE, proc, "detach");
+	PINK_EASY_REMOVE_PROCESS(ctx, proc);
+}
+
+void
+pink_easy_process_set_trace_level(pink_easy_process_t *proc,
+		pink_easy_trace_level_t level)
+{
+	/* Children and pre-exit stops are traced unless the level is none */
+	if ((proc->level == PINK_EASY_TRACE_NONE) != (level == PINK_EASY_TRACE_NONE))
+		proc->flags |= PINK_EASY_PROCESS_SETUP;
+	proc->level = level;
+}
+
+pink_easy_trace_level_t
+pink_easy_process_get_trace_level(const pink_easy_process_t *proc)
+{
+	return proc->level;
+}
+
+pink_easy_token_t
+pink_easy_process_get_token(const pink_easy_process_t *proc)
+{
+	pink_easy_token_t token;
+
+	token.pid = proc->pid;
+	token.serial = proc->serial;
+	return token;
+}
+
 pid_t
 pink_easy_process_get_pid(const pink_easy_process_t *proc)
 {
@@ -100,6 +217,12 @@ pink_easy_process_get_userdata(const pink_easy_process_t *proc)
 	return proc->userdata;
 }
 
+void *
+pink_easy_process_get_inline_userdata(pink_easy_process_t *proc)
+{
+	return proc->data;
+}
+
 void
 pink_easy_process_set_userdata(pink_easy_process_t *proc, void *userdata, pink_easy_free_func_t userdata_destroy)
 {
@@ -107,14 +230,135 @@ pink_easy_process_set_userdata(pink_easy_process_t *proc, void *userdata, pink_e
 	proc->userdata_destroy = userdata_destroy;
 }
 
+/* Number of process entries per slab */
+#define PROCESS_SLAB_ENTRIES	64
+
+/* Slabs are chained through their first word, entries start after a header
+ * which keeps them aligned like the inline user data. */
+#define PROCESS_SLAB_HEADER	__alignof__(struct pink_easy_process)
+
+static bool
+process_slab_new(pink_easy_context_t *ctx)
+{
+	unsigned i;
+	char *slab;
+	pink_easy_process_t *proc;
+
+	slab = malloc(PROCESS_SLAB_HEADER + PROCESS_SLAB_ENTRIES * ctx->process_size);
+	if (!slab)
+		return false;
+
+	*(void **)slab = ctx->process_slabs;
+	ctx->process_slabs = slab;
+
+	for (i = PROCESS_SLAB_ENTRIES; i > 0; i--) {
+		proc = (pink_easy_process_t *)(slab + PROCESS_SLAB_HEADER + (i - 1) * ctx->process_size);
+		proc->next_free = ctx->process_free;
+		ctx->process_free = proc;
+	}
+
+	return true;
+}
+
+pink_easy_process_t *
+_pink_easy_process_alloc(pink_easy_context_t *ctx)
+{
+	pink_easy_process_t *proc;
+
+	if (!ctx->process_free && !process_slab_new(ctx))
+		return NULL;
+
+	proc = ctx->process_free;
+	ctx->process_free = proc->next_free;
+	memset(proc, 0, ctx->process_size);
+	/* Verdicts meant for an earlier process with the same ID never match */
+	proc->serial = ++ctx->serial;
+	return proc;
+}
+
+void
+_pink_easy_process_free(pink_easy_context_t *ctx, pink_easy_process_t *proc)
+{
+	proc->next_free = ctx->process_free;
+	ctx->process_free = proc;
+}
+
+void
+_pink_easy_process_slabs_destroy(pink_easy_context_t *ctx)
+{
+	void *slab, *next;
+
+	for (slab = ctx->process_slabs; slab; slab = next) {
+		next = *(void **)slab;
+		free(slab);
+	}
+	ctx->process_slabs = NULL;
+	ctx->process_free = NULL;
+}
+
+/* Multiplicative hashing spreads consecutive process IDs over the table */
+static inline unsigned
+process_hash(pid_t pid, unsigned mask)
+{
+	return ((unsigned)pid * 2654435761U) & mask;
+}
+
+static void
+process_list_place(struct pink_easy_process **slots, unsigned mask, pink_easy_process_t *proc)
+{
+	unsigned i;
+
+	for (i = process_hash(proc->pid, mask); slots[i]; i = (i + 1) & mask)
+		/* void */;
+	slots[i] = proc;
+}
+
+bool
+_pink_easy_process_list_insert(pink_easy_process_list_t *list, pink_easy_process_t *proc)
+{
+	unsigned i, size;
+	struct pink_easy_process **slots;
+
+	/* Keep the load factor below 3/4 so probe sequences stay short */
+	if ((list->count + 1) * 4 > list->size * 3) {
+		size = list->size ? list->size * 2 : 64;
+		slots = calloc(size, sizeof(*slots));
+		if (!slots)
+			return false;
+		for (i = 0; i < list->size; i++) {
+			if (list->slots[i])
+				process_list_place(slots, size - 1, list->slots[i]);
+		}
+		free(list->slots);
+		list->slots = slots;
+		list->size = size;
+	}
+
+	process_list_place(list->slots, list->size - 1, proc);
+	list->count++;
+	return true;
+}
+
+void
+_pink_easy_process_list_destroy(pink_easy_process_list_t *list)
+{
+	free(list->slots);
+	list->slots = NULL;
+	list->size = list->count = 0;
+}
+
 pink_easy_process_t *
 pink_easy_process_list_lookup(const pink_easy_process_list_t *list, pid_t pid)
 {
-	pink_easy_process_t *node;
+	unsigned i, mask;
+
+	if (!list->size)
+		return NULL;
 
-	SLIST_FOREACH(node, list, entries) {
-		if (node->pid == pid)
-			return node;
+	mask = list->size - 1;
+	for (i = process_hash(pid, mask); list->slots[i]; i = (i + 1) & mask) {
+		if (list->slots[i]->pid == pid)
+			return list->slots[i];
 	}
 
 	return NULL;
@@ -123,19 +367,49 @@ pink_easy_process_list_lookup(const pink_easy_process_list_t *list, pid_t pid)
 void
 pink_easy_process_list_remove(pink_easy_process_list_t *list, const pink_easy_process_t *proc)
 {
-	SLIST_REMOVE(list, proc, pink_easy_process, entries);
+	unsigned i, j, k, mask;
+
+	if (!list->size)
+		return;
+
+	mask = list->size - 1;
+	for (i = process_hash(proc->pid, mask); list->slots[i] != proc; i = (i + 1) & mask) {
+		if (!list->slots[i])
+			return;
+	}
+
+	/* Shift the following entries of the cluster back instead of leaving a
+	 * tombstone, an entry moves into the hole unless its home slot lies
+	 * cyclically in between. */
+	for (j = i;;) {
+		list->slots[i] = NULL;
+		for (;;) {
+			j = (j + 1) & mask;
+			if (!list->slots[j]) {
+				list->count--;
+				return;
+			}
+			k = process_hash(list->slots[j]->pid, mask);
+			if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+				continue;
+			break;
+		}
+		list->slots[i] = list->slots[j];
+		i = j;
+	}
 }
 
 unsigned pink_easy_process_list_walk(const pink_easy_process_list_t *list,
 		pink_easy_walk_func_t func, void *userdata)
 {
-	unsigned count;
-	pink_easy_process_t *node;
+	unsigned i, count;
 
 	count = 0;
-	SLIST_FOREACH(node, list, entries) {
+	for (i = 0; i < list->size; i++) {
+		if (!list->slots[i])
+			continue;
 		++count;
-		if (!func(node, userdata))
+		if (!func(list->slots[i], userdata))
 			break;
 	}
 
@@ -0,0 +1,332 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <pinktrace/easy/internal.h>
+#include <pinktrace/pink.h>
+#include <pinktrace/easy/pink.h>
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include <sys/prctl.h>
+
+#ifdef HAVE_LINUX_SECCOMP_H
+#include <linux/audit.h>
+#include <linux/filter.h>
+#include <linux/seccomp.h>
+#endif /* HAVE_LINUX_SECCOMP_H */
+
+#ifndef PR_SET_NO_NEW_PRIVS
+#define PR_SET_NO_NEW_PRIVS	38
+#endif /* !PR_SET_NO_NEW_PRIVS */
+
+#if defined(SECCOMP_MODE_FILTER) && defined(SECCOMP_RET_TRACE)
+/* Audit architecture of each bitness, zero if the bitness is not supported */
+static const uint32_t seccomp_arch[2] = {
+#if defined(X86_64)
+	[PINK_BITNESS_32] = AUDIT_ARCH_I386,
+	[PINK_BITNESS_64] = AUDIT_ARCH_X86_64,
+#elif defined(I386)
+	[PINK_BITNESS_32] = AUDIT_ARCH_I386,
+#elif defined(IA64)
+	[PINK_BITNESS_64] = AUDIT_ARCH_IA64,
+#elif defined(POWERPC64)
+	[PINK_BITNESS_32] = AUDIT_ARCH_PPC,
+	[PINK_BITNESS_64] = AUDIT_ARCH_PPC64,
+#elif defined(POWERPC)
+	[PINK_BITNESS_32] = AUDIT_ARCH_PPC,
+#elif defined(ARM)
+	[PINK_BITNESS_32] = AUDIT_ARCH_ARM,
+#endif
+};
+
+#if defined(X86_64)
+/* System calls of the x32 ABI have this bit set, pinktrace does not know
+ * about them so they always stop the tracee. */
+#define SECCOMP_X32_SYSCALL_BIT	0x40000000
+#define SECCOMP_X32_LEN		2
+#else
+#define SECCOMP_X32_LEN		0
+#endif
+
+static bool
+seccomp_in_set(const pink_easy_context_t *ctx, unsigned b, long scno)
+{
+	unsigned i;
+
+	for (i = 0; i < ctx->seccomp_nsyscalls[b]; i++) {
+		if (ctx->seccomp_syscalls[b][i] == scno)
+			return true;
+	}
+
+	return false;
+}
+
+/* Whether the system call has a handler and is not in the set already */
+static bool
+seccomp_handled(const pink_easy_context_t *ctx, unsigned b, long scno)
+{
+	return ctx->syscall_handlers[b][scno].func && !seccomp_in_set(ctx, b, scno);
+}
+
+/* The read cache forgets the memory map when a system call which may change
+ * it returns, such system calls stop the tracee at exit with the cache */
+static bool
+seccomp_maps(const pink_easy_context_t *ctx)
+{
+	return ctx->options & PINK_EASY_OPTION_CACHE && !ctx->seccomp_notify;
+}
+
+/* Whether the system call stops the tracee only for the read cache */
+static bool
+seccomp_map_only(const pink_easy_context_t *ctx, unsigned b, long scno)
+{
+	return scno >= 0 && !seccomp_in_set(ctx, b, scno)
+		&& !((unsigned long)scno < ctx->syscall_nhandlers[b]
+			&& ctx->syscall_handlers[b][scno].func);
+}
+
+/* Return value of the filter for a system call the callbacks asked for */
+static uint32_t
+seccomp_action(const pink_easy_context_t *ctx, uint32_t action, unsigned b, long scno)
+{
+	if (seccomp_maps(ctx) && _pink_easy_map_syscall(ctx, b, scno))
+		action |= PINK_EASY_SECCOMP_MAPS;
+	return action;
+}
+
+/* Number of system calls which stop the tracee: the set of the context, the
+ * system calls with a handler and those the read cache needs */
+static unsigned
+seccomp_count(const pink_easy_context_t *ctx, unsigned b)
+{
+	unsigned i, n, scno;
+
+	n = ctx->seccomp_nsyscalls[b];
+	for (scno = 0; scno < ctx->syscall_nhandlers[b]; scno++) {
+		if (seccomp_handled(ctx, b, scno))
+			n++;
+	}
+	if (seccomp_maps(ctx)) {
+		for (i = 0; i < PINK_EASY_MAP_SYSCALLS; i++) {
+			if (seccomp_map_only(ctx, b, ctx->map_syscalls[b][i]))
+				n++;
+		}
+	}
+
+	return n;
+}
+
+/* Number of instructions of the filter:
+ * one to load the architecture, per bitness three to check the architecture
+ * and load the system call number plus two per system call and one to allow
+ * the rest, one to trace unknown architectures. */
+static size_t
+seccomp_filter_len(const pink_easy_context_t *ctx)
+{
+	size_t len;
+	unsigned b;
+
+	len = 2;
+	for (b = 0; b < 2; b++) {
+		if (!seccomp_arch[b])
+			continue;
+		len += 4 + 2 * seccomp_count(ctx, b);
+		if (b == PINK_BITNESS_64)
+			len += SECCOMP_X32_LEN;
+	}
+
+	return len;
+}
+
+struct sock_filter *
+_pink_easy_seccomp_filter(const pink_easy_context_t *ctx, unsigned short *len)
+{
+	unsigned b, i;
+	size_t n;
+	uint32_t action;
+	struct sock_filter *filter;
+
+	n = seccomp_filter_len(ctx);
+	if (n > BPF_MAXINSNS) {
+		errno = E2BIG;
+		return NULL;
+	}
+	filter = malloc(n * sizeof(struct sock_filter));
+	if (!filter)
+		return NULL;
+
+#ifdef SECCOMP_RET_USER_NOTIF
+	action = ctx->seccomp_notify ? SECCOMP_RET_USER_NOTIF : SECCOMP_RET_TRACE;
+#else
+	action = SECCOMP_RET_TRACE;
+#endif
+
+	n = 0;
+	filter[n++] = (struct sock_filter)BPF_STMT(BPF_LD | BPF_W | BPF_ABS,
+			offsetof(struct seccomp_data, arch));
+	for (b = 0; b < 2; b++) {
+		size_t body;
+
+		if (!seccomp_arch[b])
+			continue;
+
+		body = 2 + 2 * seccomp_count(ctx, b);
+		if (b == PINK_BITNESS_64)
+			body += SECCOMP_X32_LEN;
+
+		/* Skip to the next architecture unless this one matches */
+		filter[n++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,
+				seccomp_arch[b], 1, 0);
+		filter[n++] = (struct sock_filter)BPF_STMT(BPF_JMP | BPF_JA, body);
+		filter[n++] = (struct sock_filter)BPF_STMT(BPF_LD | BPF_W | BPF_ABS,
+				offsetof(struct seccomp_data, nr));
+#if defined(X86_64)
+		if (b == PINK_BITNESS_64) {
+			filter[n++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K,
+					SECCOMP_X32_SYSCALL_BIT, 0, 1);
+			filter[n++] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, action);
+		}
+#endif
+		/* Pairs of instructions keep all jumps short */
+		for (i = 0; i < ctx->seccomp_nsyscalls[b]; i++) {
+			filter[n++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,
+					(uint32_t)ctx->seccomp_syscalls[b][i], 0, 1);
+			filter[n++] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K,
+					seccomp_action(ctx, action, b, ctx->seccomp_syscalls[b][i]));
+		}
+		for (i = 0; i < ctx->syscall_nhandlers[b]; i++) {
+			if (!seccomp_handled(ctx, b, i))
+				continue;
+			filter[n++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, i, 0, 1);
+			filter[n++] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K,
+					seccomp_action(ctx, action, b, i));
+		}
+		for (i = 0; seccomp_maps(ctx) && i < PINK_EASY_MAP_SYSCALLS; i++) {
+			if (!seccomp_map_only(ctx, b, ctx->map_syscalls[b][i]))
+				continue;
+			filter[n++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,
+					(uint32_t)ctx->map_syscalls[b][i], 0, 1);
+			filter[n++] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K,
+					action | PINK_EASY_SECCOMP_MAPS | PINK_EASY_SECCOMP_QUIET);
+		}
+		filter[n++] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW);
+	}
+	filter[n++] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, action);
+
+	*len = n;
+	return filter;
+}
+
+bool
+_pink_easy_seccomp_install(struct sock_filter *filter, unsigned short len)
+{
+	struct sock_fprog prog;
+
+	prog.len = len;
+	prog.filter = filter;
+
+	if (prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) < 0)
+		return false;
+	return !(prctl(PR_SET_SECCOMP, SECCOMP_MODE_FILTER, &prog, 0, 0) < 0);
+}
+
+bool
+pink_easy_context_seccomp_add(pink_easy_context_t *ctx, pink_bitness_t bitness, long scno)
+{
+	long *syscalls;
+
+	if (bitness != PINK_BITNESS_32 && bitness != PINK_BITNESS_64) {
+		errno = EINVAL;
+		return false;
+	}
+	if (!seccomp_arch[bitness]) {
+		errno = ENOTSUP;
+		return false;
+	}
+
+	if (seccomp_in_set(ctx, bitness, scno))
+		goto done;
+	if (seccomp_filter_len(ctx) + 2 > BPF_MAXINSNS) {
+		errno = E2BIG;
+		return false;
+	}
+
+	syscalls = realloc(ctx->seccomp_syscalls[bitness],
+			(ctx->seccomp_nsyscalls[bitness] + 1) * sizeof(long));
+	if (!syscalls)
+		return false;
+	syscalls[ctx->seccomp_nsyscalls[bitness]++] = scno;
+	ctx->seccomp_syscalls[bitness] = syscalls;
+
+done:
+	ctx->seccomp = true;
+	ctx->ptrace_options |= PINK_TRACE_OPTION_SECCOMP;
+	return true;
+}
+#else
+struct sock_filter *
+_pink_easy_seccomp_filter(PINK_GCC_ATTR((unused)) const pink_easy_context_t *ctx,
+		PINK_GCC_ATTR((unused)) unsigned short *len)
+{
+	errno = ENOTSUP;
+	return NULL;
+}
+
+bool
+_pink_easy_seccomp_install(PINK_GCC_ATTR((unused)) struct sock_filter *filter,
+		PINK_GCC_ATTR((unused)) unsigned short len)
+{
+	errno = ENOTSUP;
+	return false;
+}
+
+bool
+pink_easy_context_seccomp_add(PINK_GCC_ATTR((unused)) pink_easy_context_t *ctx,
+		PINK_GCC_ATTR((unused)) pink_bitness_t bitness,
+		PINK_GCC_ATTR((unused)) long scno)
+{
+	errno = ENOTSUP;
+	return false;
+}
+#endif /* SECCOMP_MODE_FILTER && SECCOMP_RET_TRACE */
+
+bool
+pink_easy_context_seccomp_add_name(pink_easy_context_t *ctx, pink_bitness_t bitness, const char *name)
+{
+	long scno;
+
+	scno = pink_name_lookup(name, bitness);
+	if (scno < 0) {
+		errno = EINVAL;
+		return false;
+	}
+
+	return pink_easy_context_seccomp_add(ctx, bitness, scno);
+}
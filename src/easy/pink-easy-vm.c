@@ -38,83 +38,13 @@
 
 #include <stdbool.h>
 #include <sys/types.h>
-#include <unistd.h>
-#include <errno.h>
-#include <asm/unistd.h>
-#ifdef HAVE_SYS_UIO_H
-#include <sys/uio.h>
-#endif
 
 bool pink_easy_process_vm_readv(pid_t pid, long addr, void *dest, size_t len)
 {
-	static bool process_vm_readv_not_supported = false;
-	int r;
-	struct iovec local[1], remote[1];
-
-	if (!process_vm_readv_not_supported
-			|| pink_easy_os_release < KERNEL_VERSION(3,2,0)) {
-vm_readv_didnt_work:
-		return pink_util_moven(pid, addr, dest, len);
-	}
-
-	local[0].iov_base = dest;
-	remote[0].iov_base = (void *)addr;
-	local[0].iov_len = remote[0].iov_len = len;
-#ifdef HAVE_PROCESS_VM_READV
-	r = process_vm_readv(pid,
-			local, 1,
-			remote, 1,
-			/*flags:*/ 0
-	);
-#elif defined(__NR_process_vm_readv)
-	r = syscall(__NR_process_vm_readv, (long)pid, local, 1, remote, 1, 0);
-#else
-	process_vm_readv_not_supported = true;
-	goto vm_readv_didnt_work;
-#endif
-
-	if (r < 0) {
-		if (errno == ENOSYS)
-			process_vm_readv_not_supported = true;
-		goto vm_readv_didnt_work;
-	}
-
-	return true;
+	return pink_util_moven(pid, addr, dest, len);
 }
 
 bool pink_easy_process_vm_writev(pid_t pid, long addr, const void *src, size_t len)
 {
-	static bool process_vm_writev_not_supported = false;
-	int r;
-	struct iovec local[1], remote[1];
-
-	if (!process_vm_writev_not_supported
-			|| pink_easy_os_release < KERNEL_VERSION(3,2,0)) {
-vm_writev_didnt_work:
-		return pink_util_putn(pid, addr, src, len);
-	}
-
-	local[0].iov_base = (void *)src;
-	remote[0].iov_base = (void *)addr;
-	local[0].iov_len = remote[0].iov_len = len;
-#ifdef HAVE_PROCESS_VM_WRITEV
-	r = process_vm_writev(pid,
-			local, 1,
-			remote, 1,
-			/*flags:*/ 0
-	);
-#elif defined(__NR_process_vm_writev)
-	r = syscall(__NR_process_vm_writev, (long)pid, local, 1, remote, 1, 0);
-#else
-	process_vm_writev_not_supported = true;
-	goto vm_writev_didnt_work;
-#endif
-
-	if (r < 0) {
-		if (errno == ENOSYS)
-			process_vm_writev_not_supported = true;
-		goto vm_writev_didnt_work;
-	}
-
-	return true;
+	return pink_util_putn(pid, addr, src, len);
 }
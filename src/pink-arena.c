@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <pinktrace/internal.h>
+#include <pinktrace/pink.h>
+
+/* Default size of the blocks, a typical execve(2) argument and environment
+ * vector fits in one. */
+#define ARENA_BLOCK_SIZE	(64 * 1024)
+
+/* Alignment of the allocations */
+#define ARENA_ALIGN		(2 * sizeof(void *))
+#define ARENA_ALIGN_UP(x)	(((x) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1))
+
+struct pink_arena_block {
+	struct pink_arena_block *next;
+	size_t size;
+	size_t used;
+	char data[] PINK_GCC_ATTR((aligned(ARENA_ALIGN)));
+};
+
+struct pink_arena {
+	size_t block_size;
+
+	/* Blocks before current are full, those after it are free */
+	struct pink_arena_block *head;
+	struct pink_arena_block *current;
+};
+
+pink_arena_t *
+pink_arena_new(size_t block_size)
+{
+	pink_arena_t *arena;
+
+	arena = malloc(sizeof(pink_arena_t));
+	if (PINK_GCC_UNLIKELY(!arena))
+		return NULL;
+
+	arena->block_size = block_size ? block_size : ARENA_BLOCK_SIZE;
+	arena->head = arena->current = NULL;
+	return arena;
+}
+
+void
+pink_arena_free(pink_arena_t *arena)
+{
+	struct pink_arena_block *block, *next;
+
+	if (!arena)
+		return;
+
+	for (block = arena->head; block; block = next) {
+		next = block->next;
+		free(block);
+	}
+	free(arena);
+}
+
+void
+pink_arena_reset(pink_arena_t *arena)
+{
+	/* Blocks after the current one are reset as they are reached */
+	arena->current = arena->head;
+	if (arena->current)
+		arena->current->used = 0;
+}
+
+char *
+_pink_arena_reserve(pink_arena_t *arena, size_t len, size_t keep)
+{
+	size_t size;
+	char *old;
+	struct pink_arena_block *block;
+
+	block = arena->current;
+	if (PINK_GCC_LIKELY(block)) {
+		old = block->data + ARENA_ALIGN_UP(block->used);
+		if (PINK_GCC_LIKELY(ARENA_ALIGN_UP(block->used) + len <= block->size))
+			return old;
+	}
+	else {
+		old = NULL;
+	}
+
+	if (block && block->next && block->next->size >= len) {
+		/* Reuse a block kept by pink_arena_reset() */
+		block = block->next;
+	}
+	else {
+		if (PINK_GCC_UNLIKELY(len > SIZE_MAX - sizeof(struct pink_arena_block))) {
+			errno = ENOMEM;
+			return NULL;
+		}
+		size = len > arena->block_size ? len : arena->block_size;
+		block = malloc(sizeof(struct pink_arena_block) + size);
+		if (PINK_GCC_UNLIKELY(!block))
+			return NULL;
+		block->size = size;
+		if (arena->current) {
+			block->next = arena->current->next;
+			arena->current->next = block;
+		}
+		else {
+			block->next = NULL;
+			arena->head = block;
+		}
+	}
+
+	block->used = 0;
+	arena->current = block;
+	if (keep)
+		memcpy(block->data, old, keep);
+	return block->data;
+}
+
+void
+_pink_arena_commit(pink_arena_t *arena, size_t len)
+{
+	arena->current->used = ARENA_ALIGN_UP(arena->current->used) + len;
+}
+
+void *
+pink_arena_alloc(pink_arena_t *arena, size_t len)
+{
+	char *p;
+
+	p = _pink_arena_reserve(arena, len, 0);
+	if (PINK_GCC_LIKELY(p))
+		_pink_arena_commit(arena, len);
+	return p;
+}
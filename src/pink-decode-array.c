@@ -38,6 +38,8 @@
 #include <assert.h>
 #include <errno.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
 #include <pinktrace/internal.h>
 #include <pinktrace/pink.h>
@@ -96,3 +98,196 @@ pink_decode_string_array_member_persistent(pid_t pid, pink_bitness_t bitness, lo
 	}
 	return pink_util_movestr_persistent(pid, cp.p64);
 }
+
+char *
+pink_decode_string_array_member_arena(pid_t pid, pink_bitness_t bitness, long arg, unsigned ind, pink_arena_t *arena)
+{
+	int save_errno;
+	unsigned short wordsize;
+	union {
+		unsigned int p32;
+		unsigned long p64;
+		char data[sizeof(long)];
+	} cp;
+
+	save_errno = errno;
+	wordsize = pink_bitness_wordsize(bitness);
+	arg += ind * wordsize;
+
+	if (PINK_GCC_UNLIKELY(!pink_util_moven(pid, arg, cp.data, wordsize)))
+		return NULL;
+	if (bitness == PINK_BITNESS_32)
+		cp.p64 = cp.p32;
+	if (cp.p64 == 0) {
+		/* hit NULL, end of the array */
+		errno = save_errno;
+		return NULL;
+	}
+	return pink_util_movestr_arena(pid, cp.p64, arena);
+}
+
+#if PINK_OS_LINUX
+/* Number of members handled with one pointer table read */
+#define STRING_ARRAY_BATCH	64
+
+#define MIN(a,b)	(((a) < (b)) ? (a) : (b))
+
+/* Finish the record at dest + *used whose first have bytes are in place,
+ * reading the rest of the string at addr with pink_util_readstr(). Returns 1
+ * if the record was stored, 0 if it does not fit and -1 on failure. */
+static int
+string_array_store(pid_t pid, long addr, char *dest, size_t len, size_t *used, size_t have)
+{
+	bool truncated;
+	unsigned length;
+	ssize_t r;
+	size_t room;
+	char *rec;
+
+	rec = dest + *used;
+	room = len - *used - sizeof(unsigned);
+
+	r = pink_util_readstr(pid, addr + have, rec + sizeof(unsigned) + have, room - have, &truncated);
+	if (r < 0) {
+		if (have == 0)
+			return -1;
+		/* Ran into end of memory at the page boundary */
+		rec[sizeof(unsigned) + have] = '\0';
+		r = 0;
+		truncated = false;
+	}
+	if (truncated && have + r == room - 1)
+		return 0;
+
+	length = have + r;
+	memcpy(rec, &length, sizeof(unsigned));
+	*used = MIN(len, *used + PINK_STRING_ARRAY_RECORD_SIZE(length));
+	return 1;
+}
+
+/* Store the strings at addrs as records. Every string gets a slot up to the
+ * end of its page and all slots are read with one process_vm_readv(2) call,
+ * the records are then packed in place. Strings which span a page boundary
+ * are finished with string_array_store(). Returns the number of strings
+ * stored or -1 on failure. */
+static ssize_t
+string_array_read(pid_t pid, const unsigned long *addrs, unsigned n,
+		char *dest, size_t len, size_t *used, bool *truncated)
+{
+	size_t page_size;
+	int ret;
+	unsigned i, j, k;
+	ssize_t r;
+	size_t pos, chunk, got;
+	char *rec, *nul;
+	struct iovec local[STRING_ARRAY_BATCH], remote[STRING_ARRAY_BATCH];
+
+	page_size = _pink_util_pagesize();
+
+	i = 0;
+	while (i < n) {
+		/* Lay out the slots */
+		pos = *used;
+		for (k = 0, j = i; j < n; j++, k++) {
+			if (pos >= len || len - pos < sizeof(unsigned) + 2)
+				break;
+			chunk = page_size - (addrs[j] & (page_size - 1));
+			chunk = MIN(chunk, len - pos - sizeof(unsigned) - 1);
+			local[k].iov_base = dest + pos + sizeof(unsigned);
+			remote[k].iov_base = (void *)addrs[j];
+			local[k].iov_len = remote[k].iov_len = chunk;
+			pos += PINK_STRING_ARRAY_RECORD_SIZE(chunk);
+		}
+		if (k == 0) {
+			*truncated = true;
+			return i;
+		}
+
+		r = _pink_util_vm_readv(pid, local, k, remote, k);
+		if (r < 0) {
+			/* Read the strings one by one */
+			r = 0;
+		}
+
+		/* Pack the records */
+		for (j = 0; j < k; j++, i++) {
+			got = MIN((size_t)r, local[j].iov_len);
+			r -= got;
+
+			rec = dest + *used;
+			nul = memchr(local[j].iov_base, '\0', got);
+			if (nul) {
+				unsigned length = nul - (char *)local[j].iov_base;
+				memmove(rec + sizeof(unsigned), local[j].iov_base, length + 1);
+				memcpy(rec, &length, sizeof(unsigned));
+				*used = MIN(len, *used + PINK_STRING_ARRAY_RECORD_SIZE(length));
+				continue;
+			}
+
+			memmove(rec + sizeof(unsigned), local[j].iov_base, got);
+			ret = string_array_store(pid, addrs[i], dest, len, used, got);
+			if (ret < 0)
+				return -1;
+			if (ret == 0) {
+				*truncated = true;
+				return i;
+			}
+			/* The record may have grown over the next slots,
+			 * lay them out again. */
+			i++;
+			break;
+		}
+	}
+
+	return i;
+}
+
+ssize_t
+pink_decode_string_array(pid_t pid, pink_bitness_t bitness, long arg, char *dest, size_t len, bool *truncated)
+{
+	bool end;
+	unsigned i, n;
+	unsigned short wordsize;
+	ssize_t r, count;
+	size_t used;
+	unsigned long addrs[STRING_ARRAY_BATCH];
+	union {
+		unsigned int p32[STRING_ARRAY_BATCH];
+		unsigned long p64[STRING_ARRAY_BATCH];
+		char data[STRING_ARRAY_BATCH * sizeof(long)];
+	} table;
+
+	wordsize = pink_bitness_wordsize(bitness);
+	*truncated = false;
+	count = 0;
+	used = 0;
+
+	for (;;) {
+		r = pink_util_readn(pid, arg + count * wordsize, table.data, STRING_ARRAY_BATCH * wordsize);
+		if (PINK_GCC_UNLIKELY(r < 0))
+			return -1;
+		if (PINK_GCC_UNLIKELY((size_t)r < wordsize)) {
+			/* The table runs into an unmapped page */
+			errno = EFAULT;
+			return -1;
+		}
+
+		end = false;
+		for (i = 0, n = r / wordsize; i < n; i++) {
+			addrs[i] = (bitness == PINK_BITNESS_32) ? table.p32[i] : table.p64[i];
+			if (addrs[i] == 0) {
+				/* hit NULL, end of the array */
+				end = true;
+				break;
+			}
+		}
+
+		r = string_array_read(pid, addrs, i, dest, len, &used, truncated);
+		if (PINK_GCC_UNLIKELY(r < 0))
+			return -1;
+		count += r;
+		if (end || *truncated)
+			return count;
+	}
+}
+#endif /* PINK_OS_LINUX */
@@ -207,6 +207,19 @@ pink_decode_string_persistent(pid_t pid, pink_bitness_t bitness, unsigned ind)
 	return pink_util_movestr_persistent(pid, addr);
 }
 
+char *
+pink_decode_string_arena(pid_t pid, pink_bitness_t bitness, unsigned ind, pink_arena_t *arena)
+{
+	long addr;
+
+	assert(ind < PINK_MAX_ARGS);
+
+	if (!pink_util_get_arg(pid, bitness, ind, &addr))
+		return NULL;
+
+	return pink_util_movestr_arena(pid, addr, arena);
+}
+
 bool
 pink_decode_socket_address(pid_t pid, pink_bitness_t bitness, unsigned ind, long *fd, pink_socket_address_t *paddr)
 {
@@ -27,6 +27,7 @@
 
 #include <errno.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <pinktrace/internal.h>
 #include <pinktrace/pink.h>
@@ -157,6 +158,39 @@ pink_util_movestr_persistent(pid_t pid, long addr)
 	}
 }
 
+char *
+pink_util_movestr_arena(pid_t pid, long addr, pink_arena_t *arena)
+{
+	int save_errno;
+	size_t diff, totalsize;
+	char *buf, *nul;
+
+	save_errno = errno;
+	for (totalsize = BLOCKSIZE;; totalsize += BLOCKSIZE) {
+		diff = totalsize - BLOCKSIZE;
+		buf = _pink_arena_reserve(arena, totalsize, diff);
+		if (PINK_GCC_UNLIKELY(!buf))
+			return NULL;
+		if (PINK_GCC_UNLIKELY(!pink_util_moven(pid, addr + diff, buf + diff, BLOCKSIZE))) {
+			if (diff == 0 && (errno == EFAULT || errno == EIO)) {
+				/* NULL */
+				errno = save_errno;
+			}
+			return NULL;
+		}
+		nul = memchr(buf + diff, '\0', BLOCKSIZE);
+		if (nul) {
+			_pink_arena_commit(arena, nul - buf + 1);
+			return buf;
+		}
+		if (totalsize >= MAXSIZE - BLOCKSIZE) {
+			buf[totalsize - 1] = '\0';
+			_pink_arena_commit(arena, totalsize);
+			return buf;
+		}
+	}
+}
+
 bool
 pink_util_putn(pid_t pid, long addr, const char *src, size_t len)
 {
@@ -37,6 +37,18 @@ pink_event_decide(int status)
 	unsigned int event;
 
 	if (WIFSTOPPED(status)) {
+		/* Stops of children attached with PTRACE_SEIZE */
+		if (((status >> 16) & 0xffff) == PTRACE_EVENT_STOP) {
+			switch (WSTOPSIG(status)) {
+			case SIGSTOP:
+			case SIGTSTP:
+			case SIGTTIN:
+			case SIGTTOU:
+				return PINK_EVENT_GROUP_STOP;
+			default:
+				return PINK_EVENT_INTERRUPT;
+			}
+		}
 		switch (WSTOPSIG(status)) {
 		case SIGSTOP:
 			return PINK_EVENT_STOP;
@@ -57,6 +69,8 @@ pink_event_decide(int status)
 				return PINK_EVENT_EXEC;
 			case PTRACE_EVENT_EXIT:
 				return PINK_EVENT_EXIT;
+			case PTRACE_EVENT_SECCOMP:
+				return PINK_EVENT_SECCOMP;
 			default:
 				return PINK_EVENT_TRAP;
 			}
@@ -100,6 +114,12 @@ pink_event_name(pink_event_t event)
 		return "exit_genuine";
 	case PINK_EVENT_EXIT_SIGNAL:
 		return "exit_signal";
+	case PINK_EVENT_SECCOMP:
+		return "seccomp";
+	case PINK_EVENT_GROUP_STOP:
+		return "group_stop";
+	case PINK_EVENT_INTERRUPT:
+		return "interrupt";
 	case PINK_EVENT_UNKNOWN:
 	default:
 		return "unknown";
@@ -0,0 +1,292 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+
+#include <pinktrace/internal.h>
+#include <pinktrace/pink.h>
+
+/**
+ * Memory map index.
+ *
+ * The mappings of an address space are parsed from /proc/$pid/maps the first
+ * time they are queried and kept by the read cache, sorted by address, until
+ * pink_util_cache_invalidate_maps() is called. Mappings do not overlap so
+ * a binary search finds the one containing an address.
+ *
+ * The contents of read-only, private, file-backed mappings, e.g. the text
+ * and read-only data of the executable and its libraries, seldom change as
+ * long as the mapping stays, so strings read from them are kept by the read
+ * cache across stops if the caller asks for it. Writes to the file and to
+ * /proc/$pid/mem do change them, see pink_util_cache_strings().
+ **/
+
+#define STRING_HASH(addr)	(((addr) ^ ((addr) >> 12)) % PINK_CACHE_STRING_BUCKETS)
+
+static void
+parse_maps(pid_t pid, struct pink_cache *cache)
+{
+	char path[32], perms[5];
+	int flags;
+	unsigned long start, end, inode;
+	size_t size;
+	FILE *f;
+	struct pink_cache_map *maps;
+
+	/* Failing to parse leaves nothing mapped */
+	cache->maps_valid = true;
+	cache->nmaps = 0;
+
+	snprintf(path, sizeof(path), "/proc/%ld/maps", (long)pid);
+	f = fopen(path, "r");
+	if (!f)
+		return;
+
+	size = 0;
+	while (fscanf(f, "%lx-%lx %4s %*x %*x:%*x %lu%*[^\n]", &start, &end, perms, &inode) == 4) {
+		flags = 0;
+		if (perms[0] == 'r')
+			flags |= PROT_READ;
+		if (perms[1] == 'w')
+			flags |= PROT_WRITE;
+		if (perms[2] == 'x')
+			flags |= PROT_EXEC;
+		if (!flags) /* Guard pages */
+			continue;
+		if (flags & PROT_READ && !(flags & PROT_WRITE) && perms[3] == 'p' && inode != 0)
+			flags |= PINK_CACHE_MAP_IMMUTABLE;
+
+		if (cache->nmaps > 0
+				&& cache->maps[cache->nmaps - 1].end == start
+				&& cache->maps[cache->nmaps - 1].flags == flags) {
+			/* Merge adjacent mappings */
+			cache->maps[cache->nmaps - 1].end = end;
+			continue;
+		}
+		if (cache->nmaps == size) {
+			size = size ? size << 1 : 32;
+			maps = realloc(cache->maps, size * sizeof(struct pink_cache_map));
+			if (!maps)
+				break;
+			cache->maps = maps;
+		}
+		cache->maps[cache->nmaps].start = start;
+		cache->maps[cache->nmaps].end = end;
+		cache->maps[cache->nmaps].flags = flags;
+		cache->nmaps++;
+	}
+
+	fclose(f);
+}
+
+/* Return the index of the first mapping which ends after addr */
+static size_t
+find_map(const struct pink_cache *cache, unsigned long addr)
+{
+	size_t lo, hi, mid;
+
+	lo = 0;
+	hi = cache->nmaps;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (cache->maps[mid].end <= addr)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+size_t
+_pink_cache_maps_extent(pid_t pid, struct pink_cache *cache, long addr, size_t len,
+		int flags)
+{
+	size_t i;
+	unsigned long cur;
+
+	if (!cache->maps_valid)
+		parse_maps(pid, cache);
+
+	cur = addr;
+	for (i = find_map(cache, cur); i < cache->nmaps; i++) {
+		if (cache->maps[i].start > cur || (cache->maps[i].flags & flags) != flags)
+			break;
+		cur = cache->maps[i].end;
+		if (cur - addr >= len)
+			return len;
+	}
+	return cur - addr;
+}
+
+const struct pink_cache_string *
+_pink_cache_string_lookup(struct pink_cache *cache, long addr)
+{
+	const struct pink_cache_string *s;
+
+	if (!cache->strings)
+		return NULL;
+
+	for (s = cache->strings[STRING_HASH((unsigned long)addr)]; s; s = s->next) {
+		if (s->addr == (unsigned long)addr)
+			return s;
+	}
+	return NULL;
+}
+
+void
+_pink_cache_string_insert(pid_t pid, struct pink_cache *cache, long addr,
+		const char *str, size_t len)
+{
+	unsigned long start;
+	struct pink_cache_string *s, **bucket;
+
+	if (!cache->keep_strings || cache->nstrings >= PINK_CACHE_STRINGS_MAX)
+		return;
+
+	/* The string including the zero-byte must be immutable */
+	if (_pink_cache_maps_extent(pid, cache, addr, len + 1, PINK_CACHE_MAP_IMMUTABLE) < len + 1)
+		return;
+	start = addr;
+
+	if (!cache->strings) {
+		cache->strings = calloc(PINK_CACHE_STRING_BUCKETS, sizeof(struct pink_cache_string *));
+		if (!cache->strings)
+			return;
+	}
+
+	s = malloc(sizeof(struct pink_cache_string) + len + 1);
+	if (!s)
+		return;
+	s->addr = start;
+	s->len = len;
+	memcpy(s->str, str, len);
+	s->str[len] = '\0';
+
+	bucket = &cache->strings[STRING_HASH(start)];
+	s->next = *bucket;
+	*bucket = s;
+	cache->nstrings++;
+}
+
+static void
+forget_strings(struct pink_cache *cache)
+{
+	unsigned i;
+	struct pink_cache_string *s, *next;
+
+	if (!cache->nstrings)
+		return;
+
+	for (i = 0; i < PINK_CACHE_STRING_BUCKETS; i++) {
+		for (s = cache->strings[i]; s; s = next) {
+			next = s->next;
+			free(s);
+		}
+		cache->strings[i] = NULL;
+	}
+	cache->nstrings = 0;
+}
+
+void
+_pink_cache_written(struct pink_cache *cache, long addr, size_t len)
+{
+	size_t i;
+
+	if (!cache->nstrings || len == 0)
+		return;
+
+	/* Only ptrace(2) may write to read-only mappings */
+	for (i = find_map(cache, addr); i < cache->nmaps; i++) {
+		if (cache->maps[i].start >= (unsigned long)addr + len)
+			break;
+		if (cache->maps[i].flags & PINK_CACHE_MAP_IMMUTABLE) {
+			forget_strings(cache);
+			break;
+		}
+	}
+}
+
+void
+_pink_cache_forget_maps(struct pink_cache *cache)
+{
+	forget_strings(cache);
+	free(cache->maps);
+	cache->maps = NULL;
+	cache->nmaps = 0;
+	cache->maps_valid = false;
+}
+
+void
+pink_util_cache_invalidate_maps(pid_t pid)
+{
+	struct pink_tracee *tracee;
+
+	tracee = _pink_tracee_lookup(pid);
+	if (tracee && tracee->cache)
+		_pink_cache_forget_maps(tracee->cache);
+}
+
+bool
+pink_util_cache_strings(pid_t pid, bool enable)
+{
+	struct pink_tracee *tracee;
+
+	tracee = _pink_tracee_lookup(pid);
+	if (!tracee || !tracee->cache) {
+		errno = ENOENT;
+		return false;
+	}
+
+	if (!enable)
+		forget_strings(tracee->cache);
+	tracee->cache->keep_strings = enable;
+	return true;
+}
+
+bool
+pink_util_cache_mapped(pid_t pid, long addr, size_t len, int prot)
+{
+	struct pink_tracee *tracee;
+
+	tracee = _pink_tracee_lookup(pid);
+	if (!tracee || !tracee->cache) {
+		errno = ENOENT;
+		return false;
+	}
+
+	if (_pink_cache_maps_extent(pid, tracee->cache, addr, len, prot & (PROT_READ | PROT_WRITE | PROT_EXEC)) < len) {
+		errno = EFAULT;
+		return false;
+	}
+	return true;
+}
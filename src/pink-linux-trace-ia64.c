@@ -169,6 +169,19 @@ pink_decode_string_persistent(pid_t pid, pink_bitness_t bitness, unsigned ind)
 	return pink_util_movestr_persistent(pid, addr);
 }
 
+char *
+pink_decode_string_arena(pid_t pid, pink_bitness_t bitness, unsigned ind, pink_arena_t *arena)
+{
+	long addr;
+
+	assert(ind < PINK_MAX_ARGS);
+
+	if (PINK_GCC_UNLIKELY(!pink_util_get_arg(pid, bitness, ind, &addr)))
+		return NULL;
+
+	return pink_util_movestr_arena(pid, addr, arena);
+}
+
 bool
 pink_encode_simple(pid_t pid, pink_bitness_t bitness, unsigned ind, const void *src, size_t len)
 {
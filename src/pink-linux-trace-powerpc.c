@@ -175,6 +175,19 @@ pink_decode_string_persistent(pid_t pid, pink_bitness_t bitness, unsigned ind)
 	return pink_util_movestr_persistent(pid, addr);
 }
 
+char *
+pink_decode_string_arena(pid_t pid, pink_bitness_t bitness, unsigned ind, pink_arena_t *arena)
+{
+	long addr;
+
+	assert(ind < PINK_MAX_ARGS);
+
+	if (PINK_GCC_UNLIKELY(!pink_util_get_arg(pid, bitness, ind, &addr)))
+		return NULL;
+
+	return pink_util_movestr_arena(pid, addr, arena);
+}
+
 bool
 pink_encode_simple(pid_t pid, pink_bitness_t bitness, unsigned ind, const void *src, size_t len)
 {
@@ -213,69 +226,27 @@ pink_decode_socket_call(pid_t pid, pink_bitness_t bitness, long *subcall)
 bool
 pink_decode_socket_fd(pid_t pid, pink_bitness_t bitness, unsigned ind, long *fd)
 {
-	unsigned short size;
-	long args;
-
 	assert(ind < PINK_MAX_ARGS);
 
 	/* Decode socketcall(2) */
-	if (PINK_GCC_UNLIKELY(!pink_util_get_arg(pid, bitness, 1, &args)))
+	if (PINK_GCC_UNLIKELY(!_pink_decode_socketcall_args(pid, bitness, NULL, ind, fd, 1)))
 		return false;
-
-	size = pink_bitness_wordsize(bitness);
-	if (size == sizeof(int))
-		args += ind * sizeof(unsigned int);
-	else if (size == sizeof(long))
-		args += ind * sizeof(unsigned long);
-	else
-		return false;
-
-	return pink_util_move(pid, args, fd);
-
+	if (pink_bitness_wordsize(bitness) == sizeof(int))
+		*fd = (int)*fd;
+	return true;
 }
 
 bool
 pink_decode_socket_address(pid_t pid, pink_bitness_t bitness, unsigned ind, long *fd, pink_socket_address_t *paddr)
 {
-	unsigned short size;
-	long addr, addrlen, args;
+	long args[2];
 
 	assert(ind < PINK_MAX_ARGS);
 	assert(paddr != NULL);
 
 	/* Decode socketcall(2) */
-	if (PINK_GCC_UNLIKELY(!pink_util_get_arg(pid, bitness, 1, &args)))
+	if (PINK_GCC_UNLIKELY(!_pink_decode_socketcall_args(pid, bitness, fd, ind, args, 2)))
 		return false;
-	if (fd && PINK_GCC_UNLIKELY(!pink_util_move(pid, args, fd)))
-		return false;
-
-	size = pink_bitness_wordsize(bitness);
-	if (size == sizeof(int)) {
-		unsigned int iaddr, iaddrlen;
-		args += ind * size;
-		if (PINK_GCC_UNLIKELY(!pink_util_move(pid, args, &iaddr)))
-			return false;
-		args += size;
-		if (PINK_GCC_UNLIKELY(!pink_util_move(pid, args, &iaddrlen)))
-			return false;
-
-		addr = iaddr;
-		addrlen = iaddrlen;
-	}
-	else if (size == sizeof(long)) {
-		unsigned long laddr, laddrlen;
-		args += ind * size;
-		if (PINK_GCC_UNLIKELY(!pink_util_move(pid, args, &laddr)))
-			return false;
-		args += size;
-		if (PINK_GCC_UNLIKELY(!pink_util_move(pid, args, &laddrlen)))
-			return false;
-
-		addr = laddr;
-		addrlen = laddrlen;
-	}
-	else
-		abort();
 
-	return _pink_decode_socket_address(pid, addr, addrlen, paddr);
+	return _pink_decode_socket_address(pid, args[0], args[1], paddr);
 }
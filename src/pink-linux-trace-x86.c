@@ -52,6 +52,15 @@ pink_bitness_wordsize(PINK_GCC_ATTR((unused)) pink_bitness_t bitness)
 bool
 pink_util_get_syscall(pid_t pid, PINK_GCC_ATTR((unused)) pink_bitness_t bitness, long *res)
 {
+	const pink_syscall_info_t *info;
+
+	info = _pink_tracee_info(pid);
+	if (info && info->op != PINK_SYSCALL_INFO_NONE) {
+		if (res)
+			*res = info->scno;
+		return true;
+	}
+
 	return pink_util_peek(pid, ORIG_ACCUM, res);
 }
 
@@ -64,8 +73,16 @@ pink_util_set_syscall(pid_t pid, PINK_GCC_ATTR((unused)) pink_bitness_t bitness,
 bool
 pink_util_get_return(pid_t pid, long *res)
 {
+	const pink_syscall_info_t *info;
+
 	assert(res != NULL);
 
+	info = _pink_tracee_info(pid);
+	if (info && info->op == PINK_SYSCALL_INFO_EXIT) {
+		*res = info->ret;
+		return true;
+	}
+
 	return pink_util_peek(pid, ACCUM, res);
 }
 
@@ -78,9 +95,18 @@ pink_util_set_return(pid_t pid, long ret)
 bool
 pink_util_get_arg(pid_t pid, pink_bitness_t bitness, unsigned ind, long *res)
 {
+	const pink_syscall_info_t *info;
+
 	assert(bitness == PINK_BITNESS_32);
 	assert(ind < PINK_MAX_ARGS);
 
+	info = _pink_tracee_info(pid);
+	if (info && info->bitness == bitness
+			&& (info->op == PINK_SYSCALL_INFO_ENTRY || info->op == PINK_SYSCALL_INFO_SECCOMP)) {
+		*res = info->args[ind];
+		return true;
+	}
+
 	return pink_util_peek(pid, syscall_args[bitness][ind], res);
 }
 
@@ -131,6 +157,20 @@ pink_decode_string_persistent(pid_t pid, pink_bitness_t bitness, unsigned ind)
 	return pink_util_movestr_persistent(pid, addr);
 }
 
+char *
+pink_decode_string_arena(pid_t pid, pink_bitness_t bitness, unsigned ind, pink_arena_t *arena)
+{
+	long addr;
+
+	assert(bitness == PINK_BITNESS_32);
+	assert(ind < PINK_MAX_ARGS);
+
+	if (PINK_GCC_UNLIKELY(!pink_util_get_arg(pid, bitness, ind, &addr)))
+		return NULL;
+
+	return pink_util_movestr_arena(pid, addr, arena);
+}
+
 bool
 pink_encode_simple(pid_t pid, pink_bitness_t bitness, unsigned ind, const void *src, size_t len)
 {
@@ -172,43 +212,26 @@ pink_decode_socket_call(pid_t pid, pink_bitness_t bitness, long *subcall)
 bool
 pink_decode_socket_fd(pid_t pid, pink_bitness_t bitness, unsigned ind, long *fd)
 {
-	long args;
-
 	assert(bitness == PINK_BITNESS_32);
 	assert(ind < PINK_MAX_ARGS);
 	assert(fd != NULL);
 
 	/* Decode socketcall(2) */
-	if (PINK_GCC_UNLIKELY(!pink_util_get_arg(pid, bitness, 1, &args)))
-		return false;
-	args += ind * sizeof(unsigned int);
-
-	return pink_util_move(pid, args, fd);
+	return _pink_decode_socketcall_args(pid, bitness, NULL, ind, fd, 1);
 }
 
 bool
 pink_decode_socket_address(pid_t pid, pink_bitness_t bitness, unsigned ind, long *fd, pink_socket_address_t *paddr)
 {
-	unsigned int iaddr, iaddrlen;
-	long addr, addrlen, args;
+	long args[2];
 
 	assert(bitness == PINK_BITNESS_32);
 	assert(ind < PINK_MAX_ARGS);
 	assert(paddr != NULL);
 
 	/* Decode socketcall(2) */
-	if (PINK_GCC_UNLIKELY(!pink_util_get_arg(pid, bitness, 1, &args)))
-		return false;
-	if (PINK_GCC_UNLIKELY(fd && !pink_util_move(pid, args, fd)))
-		return false;
-	args += ind * sizeof(unsigned int);
-	if (PINK_GCC_UNLIKELY(!pink_util_move(pid, args, &iaddr)))
-		return false;
-	args += sizeof(unsigned int);
-	if (PINK_GCC_UNLIKELY(!pink_util_move(pid, args, &iaddrlen)))
+	if (PINK_GCC_UNLIKELY(!_pink_decode_socketcall_args(pid, bitness, fd, ind, args, 2)))
 		return false;
-	addr = iaddr;
-	addrlen = iaddrlen;
 
-	return _pink_decode_socket_address(pid, addr, addrlen, paddr);
+	return _pink_decode_socket_address(pid, args[0], args[1], paddr);
 }
@@ -29,10 +29,49 @@
 #include <stdbool.h>
 #include <sys/types.h>
 #include <stdio.h> /* NULL */
+#include <string.h>
+#include <linux/audit.h>
 
 #include <pinktrace/internal.h>
 #include <pinktrace/pink.h>
 
+#ifndef PTRACE_GET_SYSCALL_INFO
+#define PTRACE_GET_SYSCALL_INFO		0x420e
+#define PTRACE_SYSCALL_INFO_NONE	0
+#define PTRACE_SYSCALL_INFO_ENTRY	1
+#define PTRACE_SYSCALL_INFO_EXIT	2
+#define PTRACE_SYSCALL_INFO_SECCOMP	3
+#endif /* !PTRACE_GET_SYSCALL_INFO */
+
+/* Layout of struct ptrace_syscall_info, defined here so that building does
+ * not depend on the kernel headers being recent enough. */
+struct syscall_info {
+	uint8_t op;
+	uint8_t pad[3];
+	uint32_t arch;
+	uint64_t instruction_pointer;
+	uint64_t stack_pointer;
+	union {
+		struct {
+			uint64_t nr;
+			uint64_t args[6];
+		} entry;
+		struct {
+			int64_t rval;
+			uint8_t is_error;
+		} exit;
+		struct {
+			uint64_t nr;
+			uint64_t args[6];
+			uint32_t ret_data;
+		} seccomp;
+	};
+};
+
+/* Set when the running kernel doesn't implement PTRACE_GET_SYSCALL_INFO, by
+ * whichever tracing thread notices first */
+static bool syscall_info_nosys;
+
 bool
 pink_trace_me(void)
 {
@@ -42,24 +81,31 @@ pink_trace_me(void)
 bool
 pink_trace_cont(pid_t pid, int sig, PINK_GCC_ATTR((unused)) char *addr)
 {
+	if (PINK_GCC_UNLIKELY(!_pink_tracee_resume(pid, false)))
+		return false;
 	return !(0 > ptrace(PTRACE_CONT, pid, NULL, sig));
 }
 
 bool
 pink_trace_kill(pid_t pid)
 {
+	_pink_tracee_release(pid, false);
 	return !(0 > ptrace(PTRACE_KILL, pid, NULL, NULL));
 }
 
 bool
 pink_trace_singlestep(pid_t pid, int sig)
 {
+	if (PINK_GCC_UNLIKELY(!_pink_tracee_resume(pid, false)))
+		return false;
 	return !(0 > ptrace(PTRACE_SINGLESTEP, pid, NULL, sig));
 }
 
 bool
 pink_trace_syscall(pid_t pid, int sig)
 {
+	if (PINK_GCC_UNLIKELY(!_pink_tracee_resume(pid, true)))
+		return false;
 	return !(0 > ptrace(PTRACE_SYSCALL, pid, NULL, sig));
 }
 
@@ -67,6 +113,8 @@ pink_trace_syscall(pid_t pid, int sig)
 bool
 pink_trace_sysemu(pid_t pid, int sig)
 {
+	if (PINK_GCC_UNLIKELY(!_pink_tracee_resume(pid, false)))
+		return false;
 	return !(0 > ptrace(PTRACE_SYSEMU, pid, NULL, sig));
 }
 #else
@@ -82,6 +130,8 @@ pink_trace_sysemu(PINK_GCC_ATTR((unused)) pid_t pid, PINK_GCC_ATTR((unused)) int
 bool
 pink_trace_sysemu_singlestep(pid_t pid, int sig)
 {
+	if (PINK_GCC_UNLIKELY(!_pink_tracee_resume(pid, false)))
+		return false;
 	return !(0 > ptrace(PTRACE_SYSEMU_SINGLESTEP, pid, NULL, sig));
 }
 #else
@@ -99,8 +149,8 @@ pink_trace_geteventmsg(pid_t pid, unsigned long *data)
 	return !(0 > ptrace(PTRACE_GETEVENTMSG, pid, NULL, data));
 }
 
-bool
-pink_trace_setup(pid_t pid, int options)
+static int
+trace_options(int options)
 {
 	int ptrace_options;
 
@@ -119,8 +169,154 @@ pink_trace_setup(pid_t pid, int options)
 		ptrace_options |= PTRACE_O_TRACEVFORKDONE;
 	if (options & PINK_TRACE_OPTION_EXIT)
 		ptrace_options |= PTRACE_O_TRACEEXIT;
+	if (options & PINK_TRACE_OPTION_SECCOMP)
+		ptrace_options |= PTRACE_O_TRACESECCOMP;
+
+	return ptrace_options;
+}
+
+bool
+pink_trace_setup(pid_t pid, int options)
+{
+	return !(0 > ptrace(PTRACE_SETOPTIONS, pid, NULL, trace_options(options)));
+}
+
+bool
+pink_trace_seize(pid_t pid, int options)
+{
+	return !(0 > ptrace(PTRACE_SEIZE, pid, NULL, trace_options(options)));
+}
+
+bool
+pink_trace_interrupt(pid_t pid)
+{
+	return !(0 > ptrace(PTRACE_INTERRUPT, pid, NULL, NULL));
+}
+
+bool
+pink_trace_listen(pid_t pid)
+{
+	if (PINK_GCC_UNLIKELY(!_pink_tracee_resume(pid, false)))
+		return false;
+	return !(0 > ptrace(PTRACE_LISTEN, pid, NULL, NULL));
+}
+
+static pink_bitness_t
+syscall_info_bitness(uint32_t arch)
+{
+	switch (arch) {
+#if defined(X86_64)
+	case AUDIT_ARCH_X86_64:
+		return PINK_BITNESS_64;
+	case AUDIT_ARCH_I386:
+		return PINK_BITNESS_32;
+#elif defined(I386)
+	case AUDIT_ARCH_I386:
+		return PINK_BITNESS_32;
+#endif
+	default:
+		return PINK_BITNESS_UNKNOWN;
+	}
+}
+
+bool
+pink_trace_get_syscall_info(pid_t pid, pink_syscall_info_t *info)
+{
+	unsigned i;
+	struct syscall_info si;
+	struct pink_tracee *tracee;
+
+	if (PINK_GCC_UNLIKELY(__atomic_load_n(&syscall_info_nosys, __ATOMIC_RELAXED))) {
+		errno = ENOSYS;
+		return false;
+	}
+
+	memset(&si, 0, sizeof(si));
+	if (PINK_GCC_UNLIKELY(0 > ptrace(PTRACE_GET_SYSCALL_INFO, pid, (void *)sizeof(si), &si))) {
+		/* Kernels older than 5.3 reject the unknown request with EIO */
+		if (errno == EIO) {
+			__atomic_store_n(&syscall_info_nosys, true, __ATOMIC_RELAXED);
+			errno = ENOSYS;
+		}
+		return false;
+	}
+
+	tracee = _pink_tracee_get(pid);
+	if (PINK_GCC_UNLIKELY(!tracee))
+		return false;
+
+	memset(info, 0, sizeof(*info));
+	info->arch = si.arch;
+	info->bitness = syscall_info_bitness(si.arch);
+	info->ip = (long)si.instruction_pointer;
+	info->sp = (long)si.stack_pointer;
+
+	switch (si.op) {
+	case PTRACE_SYSCALL_INFO_ENTRY:
+		info->op = PINK_SYSCALL_INFO_ENTRY;
+		info->scno = (long)si.entry.nr;
+		for (i = 0; i < PINK_MAX_ARGS; i++)
+			info->args[i] = (long)si.entry.args[i];
+		break;
+	case PTRACE_SYSCALL_INFO_SECCOMP:
+		info->op = PINK_SYSCALL_INFO_SECCOMP;
+		info->scno = (long)si.seccomp.nr;
+		for (i = 0; i < PINK_MAX_ARGS; i++)
+			info->args[i] = (long)si.seccomp.args[i];
+		info->ret_data = si.seccomp.ret_data;
+		break;
+	case PTRACE_SYSCALL_INFO_EXIT:
+		info->op = PINK_SYSCALL_INFO_EXIT;
+		info->ret = (long)si.exit.rval;
+		info->is_error = !!si.exit.is_error;
+		break;
+	default:
+		info->op = PINK_SYSCALL_INFO_NONE;
+		break;
+	}
+
+	switch (info->op) {
+	case PINK_SYSCALL_INFO_ENTRY:
+	case PINK_SYSCALL_INFO_SECCOMP:
+		tracee->entry_scno = info->scno;
+		tracee->flags |= PINK_TRACEE_ENTRY_SCNO;
+		break;
+	case PINK_SYSCALL_INFO_EXIT:
+		/* The kernel does not report the system call number on exit */
+		if (tracee->flags & PINK_TRACEE_ENTRY_SCNO)
+			info->scno = tracee->entry_scno;
+		else if (!pink_util_get_syscall(pid, info->bitness == PINK_BITNESS_UNKNOWN
+					? PINKTRACE_BITNESS_DEFAULT
+					: info->bitness, &info->scno))
+			return false;
+		tracee->flags &= ~PINK_TRACEE_ENTRY_SCNO;
+		break;
+	default:
+		break;
+	}
+
+	tracee->info = *info;
+	tracee->flags |= PINK_TRACEE_INFO;
+	return true;
+}
+
+bool
+pink_util_set_syscall_info(pid_t pid, const pink_syscall_info_t *info)
+{
+	struct pink_tracee *tracee;
+
+	tracee = _pink_tracee_get(pid);
+	if (PINK_GCC_UNLIKELY(!tracee))
+		return false;
 
-	return !(0 > ptrace(PTRACE_SETOPTIONS, pid, NULL, ptrace_options));
+	tracee->info = *info;
+	tracee->info.bitness = syscall_info_bitness(info->arch);
+	if (info->op == PINK_SYSCALL_INFO_ENTRY || info->op == PINK_SYSCALL_INFO_SECCOMP) {
+		tracee->entry_scno = info->scno;
+		tracee->flags |= PINK_TRACEE_ENTRY_SCNO;
+	}
+	tracee->flags |= PINK_TRACEE_INFO;
+	return true;
 }
 
 bool
@@ -132,5 +328,7 @@ pink_trace_attach(pid_t pid)
 bool
 pink_trace_detach(pid_t pid, int sig)
 {
+	if (PINK_GCC_UNLIKELY(!_pink_tracee_release(pid, true)))
+		return false;
 	return !(0 > ptrace(PTRACE_DETACH, pid, NULL, sig));
 }
@@ -0,0 +1,345 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <sys/types.h>
+#include <sys/ptrace.h>
+
+#include <pinktrace/internal.h>
+#include <pinktrace/pink.h>
+
+/**
+ * Per-tracee state kept by the core library.
+ *
+ * Only the thread which attached to a tracee may issue ptrace requests for
+ * it, so the table is kept per thread and needs no locking.
+ **/
+
+struct pink_tracee_table {
+	size_t size;
+	size_t count;
+	struct pink_tracee **buckets;
+};
+
+static __thread struct pink_tracee_table table;
+
+#define PINK_TRACEE_TABLE_MIN	64
+#define TRACEE_HASH(pid, size)	((size_t)(pid) & ((size) - 1))
+
+static bool
+tracee_table_grow(void)
+{
+	size_t i, size;
+	struct pink_tracee **buckets, *node, *next;
+
+	size = table.size ? table.size << 1 : PINK_TRACEE_TABLE_MIN;
+	buckets = calloc(size, sizeof(struct pink_tracee *));
+	if (!buckets)
+		return false;
+
+	for (i = 0; i < table.size; i++) {
+		for (node = table.buckets[i]; node; node = next) {
+			next = node->next;
+			node->next = buckets[TRACEE_HASH(node->pid, size)];
+			buckets[TRACEE_HASH(node->pid, size)] = node;
+		}
+	}
+
+	free(table.buckets);
+	table.buckets = buckets;
+	table.size = size;
+	return true;
+}
+
+struct pink_tracee *
+_pink_tracee_lookup(pid_t pid)
+{
+	struct pink_tracee *node;
+
+	if (PINK_GCC_UNLIKELY(table.size == 0))
+		return NULL;
+
+	for (node = table.buckets[TRACEE_HASH(pid, table.size)]; node; node = node->next) {
+		if (node->pid == pid)
+			return node;
+	}
+
+	return NULL;
+}
+
+struct pink_tracee *
+_pink_tracee_get(pid_t pid)
+{
+	size_t h;
+	struct pink_tracee *node;
+
+	node = _pink_tracee_lookup(pid);
+	if (node)
+		return node;
+
+	if (table.count >= table.size && !tracee_table_grow())
+		return NULL;
+
+	node = calloc(1, sizeof(struct pink_tracee));
+	if (!node)
+		return NULL;
+	node->pid = pid;
+
+	h = TRACEE_HASH(pid, table.size);
+	node->next = table.buckets[h];
+	table.buckets[h] = node;
+	table.count++;
+	return node;
+}
+
+static void
+cache_put(struct pink_cache *cache)
+{
+	if (cache && --cache->refs == 0) {
+		_pink_cache_forget_maps(cache);
+		free(cache->strings);
+		free(cache->data);
+		free(cache);
+	}
+}
+
+void
+_pink_tracee_remove(pid_t pid)
+{
+	struct pink_tracee **prev, *node;
+
+	if (table.size == 0)
+		return;
+
+	for (prev = &table.buckets[TRACEE_HASH(pid, table.size)]; (node = *prev); prev = &node->next) {
+		if (node->pid == pid) {
+			*prev = node->next;
+			cache_put(node->cache);
+			free(node);
+			table.count--;
+			return;
+		}
+	}
+}
+
+bool
+_pink_tracee_flush(struct pink_tracee *tracee)
+{
+#ifdef PINK_TRACEE_HAVE_REGS
+	if (tracee->regs_dirty) {
+		/* Write back all modifications at once */
+		tracee->regs_dirty = 0;
+		if (PINK_GCC_UNLIKELY(0 > ptrace(PTRACE_SETREGS, tracee->pid, NULL, &tracee->regs)))
+			return false;
+	}
+#endif
+	return true;
+}
+
+bool
+_pink_tracee_resume(pid_t pid, bool syscall)
+{
+	bool r;
+	struct pink_tracee *tracee;
+
+	tracee = _pink_tracee_lookup(pid);
+	if (!tracee)
+		return true;
+
+	r = _pink_tracee_flush(tracee);
+	tracee->flags &= ~PINK_TRACEE_STOP_MASK;
+	/* Unless the tracee stops at the exit of the current system call,
+	 * the next system call stop is an entry */
+	if (!syscall)
+		tracee->flags &= ~PINK_TRACEE_ENTRY_SCNO;
+	if (tracee->cache)
+		tracee->cache->valid = 0;
+	return r;
+}
+
+void
+_pink_tracee_invalidate(pid_t pid, long addr, size_t len)
+{
+	struct pink_tracee *tracee;
+
+	tracee = _pink_tracee_lookup(pid);
+	if (tracee && tracee->cache) {
+		tracee->cache->valid = 0;
+		_pink_cache_written(tracee->cache, addr, len);
+	}
+}
+
+bool
+_pink_tracee_release(pid_t pid, bool flush)
+{
+	bool r;
+	struct pink_tracee *tracee;
+
+	tracee = _pink_tracee_lookup(pid);
+	if (!tracee)
+		return true;
+
+	r = flush ? _pink_tracee_flush(tracee) : true;
+	_pink_tracee_remove(pid);
+	return r;
+}
+
+const pink_syscall_info_t *
+_pink_tracee_info(pid_t pid)
+{
+	struct pink_tracee *tracee;
+
+	tracee = _pink_tracee_lookup(pid);
+	return (tracee && tracee->flags & PINK_TRACEE_INFO) ? &tracee->info : NULL;
+}
+
+void
+pink_util_forget(pid_t pid)
+{
+	_pink_tracee_remove(pid);
+}
+
+bool
+pink_util_cache_enable(pid_t pid, bool enable)
+{
+	struct pink_tracee *tracee;
+
+	if (!enable) {
+		tracee = _pink_tracee_lookup(pid);
+		if (tracee) {
+			cache_put(tracee->cache);
+			tracee->cache = NULL;
+		}
+		return true;
+	}
+
+	tracee = _pink_tracee_get(pid);
+	if (!tracee)
+		return false;
+	if (tracee->cache)
+		return true;
+
+	tracee->cache = calloc(1, sizeof(struct pink_cache));
+	if (!tracee->cache)
+		return false;
+	tracee->cache->refs = 1;
+	return true;
+}
+
+bool
+pink_util_cache_share(pid_t pid, pid_t owner)
+{
+	struct pink_cache *cache;
+	struct pink_tracee *tracee;
+
+	if (!pink_util_cache_enable(owner, true))
+		return false;
+	cache = _pink_tracee_lookup(owner)->cache;
+
+	tracee = _pink_tracee_get(pid);
+	if (!tracee)
+		return false;
+	if (tracee->cache != cache) {
+		cache_put(tracee->cache);
+		tracee->cache = cache;
+		cache->refs++;
+	}
+	return true;
+}
+
+void
+pink_util_cache_invalidate(pid_t pid)
+{
+	struct pink_tracee *tracee;
+
+	tracee = _pink_tracee_lookup(pid);
+	if (tracee && tracee->cache)
+		tracee->cache->valid = 0;
+}
+
+bool
+pink_util_cache_stats(pid_t pid, unsigned long *hits, unsigned long *misses)
+{
+	struct pink_tracee *tracee;
+
+	tracee = _pink_tracee_lookup(pid);
+	if (!tracee || !tracee->cache) {
+		errno = ENOENT;
+		return false;
+	}
+
+	if (hits)
+		*hits = tracee->cache->hits;
+	if (misses)
+		*misses = tracee->cache->misses;
+	return true;
+}
+
+bool
+pink_util_regs_snapshot(pid_t pid)
+{
+#ifdef PINK_TRACEE_HAVE_REGS
+	struct pink_tracee *tracee;
+
+	tracee = _pink_tracee_get(pid);
+	if (PINK_GCC_UNLIKELY(!tracee))
+		return false;
+	if (PINK_GCC_UNLIKELY(!_pink_tracee_flush(tracee)))
+		return false;
+	if (PINK_GCC_UNLIKELY(0 > ptrace(PTRACE_GETREGS, pid, NULL, &tracee->regs))) {
+		tracee->flags &= ~PINK_TRACEE_REGS;
+		return false;
+	}
+	tracee->flags |= PINK_TRACEE_REGS;
+#endif
+	return true;
+}
+
+bool
+pink_util_regs_flush(pid_t pid)
+{
+	struct pink_tracee *tracee;
+
+	tracee = _pink_tracee_lookup(pid);
+	return tracee ? _pink_tracee_flush(tracee) : true;
+}
+
+void
+pink_util_regs_invalidate(pid_t pid)
+{
+	struct pink_tracee *tracee;
+
+	tracee = _pink_tracee_lookup(pid);
+	if (tracee) {
+#ifdef PINK_TRACEE_HAVE_REGS
+		tracee->regs_dirty = 0;
+#endif
+		tracee->flags &= ~PINK_TRACEE_STOP_MASK;
+	}
+}
@@ -33,19 +33,61 @@
  * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <pinktrace/internal.h>
+#include <pinktrace/pink.h>
+
 #include <assert.h>
 #include <errno.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include <asm/unistd.h>
+#include <sys/mman.h>
+#ifdef HAVE_SYS_UIO_H
+#include <sys/uio.h>
+#endif
+
+#ifdef PINK_TRACEE_HAVE_REGS
+static struct pink_tracee *
+regs_snapshot(pid_t pid)
+{
+	struct pink_tracee *tracee;
 
-#include <pinktrace/internal.h>
-#include <pinktrace/pink.h>
+	tracee = _pink_tracee_lookup(pid);
+	return (tracee && tracee->flags & PINK_TRACEE_REGS) ? tracee : NULL;
+}
+
+static long *
+regs_word(pid_t pid, long off, unsigned long **mask)
+{
+	struct pink_tracee *tracee;
+
+	if (off < 0 || (size_t)off > sizeof(tracee->regs) - sizeof(long) || off % sizeof(long))
+		return NULL;
+	tracee = regs_snapshot(pid);
+	if (!tracee)
+		return NULL;
+	if (mask)
+		*mask = &tracee->regs_dirty;
+	return (long *)((char *)&tracee->regs + off);
+}
+#endif
 
 bool
 pink_util_peek(pid_t pid, long off, long *res)
 {
 	long val;
+#ifdef PINK_TRACEE_HAVE_REGS
+	long *word;
+
+	word = regs_word(pid, off, NULL);
+	if (word) {
+		if (res)
+			*res = *word;
+		return true;
+	}
+#endif
 
 	errno = 0;
 	val = ptrace(PTRACE_PEEKUSER, pid, off, NULL);
@@ -74,100 +116,155 @@ pink_util_peekdata(pid_t pid, long off, long *res)
 	return true;
 }
 
+static void
+drop_syscall_info(pid_t pid)
+{
+	struct pink_tracee *tracee;
+
+	tracee = _pink_tracee_lookup(pid);
+	if (!tracee || !(tracee->flags & PINK_TRACEE_INFO))
+		return;
+
+	/* The cached system call information goes stale, take a register
+	 * snapshot in its place so the modifications can still be coalesced. */
+	tracee->flags &= ~(PINK_TRACEE_INFO | PINK_TRACEE_ENTRY_SCNO);
+	pink_util_regs_snapshot(pid);
+}
+
 bool
 pink_util_poke(pid_t pid, long off, long val)
 {
+#ifdef PINK_TRACEE_HAVE_REGS
+	long *word;
+	unsigned long *dirty;
+
+	drop_syscall_info(pid);
+
+	/* Defer the write until the tracee is resumed */
+	word = regs_word(pid, off, &dirty);
+	if (word) {
+		*word = val;
+		*dirty |= 1UL << (off / sizeof(long));
+		return true;
+	}
+#else
+	drop_syscall_info(pid);
+#endif
 	return (0 == ptrace(PTRACE_POKEUSER, pid, off, val));
 }
 
 bool
 pink_util_pokedata(pid_t pid, long off, long val)
 {
+	_pink_tracee_invalidate(pid, off, sizeof(long));
 	return (0 == ptrace(PTRACE_POKEDATA, pid, off, val));
 }
 
 bool
 pink_util_get_regs(pid_t pid, void *regs)
 {
+#ifdef PINK_TRACEE_HAVE_REGS
+	struct pink_tracee *tracee;
+
+	tracee = regs_snapshot(pid);
+	if (tracee) {
+		memcpy(regs, &tracee->regs, sizeof(tracee->regs));
+		return true;
+	}
+#endif
 	return !(ptrace(PTRACE_GETREGS, pid, NULL, regs) < 0);
 }
 
 bool
 pink_util_set_regs(pid_t pid, const void *regs)
 {
-	return !(ptrace(PTRACE_SETREGS, pid, NULL, regs) < 0);
-}
-
-bool
-pink_util_putn(pid_t pid, long addr, const char *src, size_t len)
-{
-	int n, m;
-	union {
-		long val;
-		char x[sizeof(long)];
-	} u;
-
-	n = 0;
-	m = len / sizeof(long);
-
-	while (n < m) {
-		memcpy(u.x, src, sizeof(long));
-		if (PINK_GCC_UNLIKELY(!pink_util_pokedata(pid, addr + n * ADDR_MUL, u.val)))
-			return false;
-		++n;
-		src += sizeof(long);
-	}
+#ifdef PINK_TRACEE_HAVE_REGS
+	struct pink_tracee *tracee;
 
-	m = len % sizeof(long);
-	if (m) {
-		memcpy(u.x, src, m);
-		if (PINK_GCC_UNLIKELY(!pink_util_pokedata(pid, addr + n * ADDR_MUL, u.val)))
-			return false;
+	if (ptrace(PTRACE_SETREGS, pid, NULL, regs) < 0)
+		return false;
+	tracee = _pink_tracee_lookup(pid);
+	if (tracee)
+		tracee->flags &= ~(PINK_TRACEE_INFO | PINK_TRACEE_ENTRY_SCNO);
+	tracee = regs_snapshot(pid);
+	if (tracee) {
+		memcpy(&tracee->regs, regs, sizeof(tracee->regs));
+		tracee->regs_dirty = 0;
 	}
-
 	return true;
+#else
+	if (ptrace(PTRACE_SETREGS, pid, NULL, regs) < 0)
+		return false;
+	drop_syscall_info(pid);
+	return true;
+#endif
 }
 
-bool
-pink_util_putn_safe(pid_t pid, long addr, const char *src, size_t len)
+#define MIN(a,b)	(((a) < (b)) ? (a) : (b))
+
+size_t
+_pink_util_pagesize(void)
 {
-	int n, m;
-	union {
-		long val;
-		char x[sizeof(long)];
-	} u;
+	static size_t size;
+	size_t r;
 
-	n = 0;
-	m = len / sizeof(long);
-
-	while (n < m) {
-		memcpy(u.x, src, sizeof(long));
-		if (PINK_GCC_UNLIKELY(!pink_util_peekdata(pid, addr + n * ADDR_MUL, NULL)))
-			return false;
-		if (PINK_GCC_UNLIKELY(!pink_util_pokedata(pid, addr + n * ADDR_MUL, u.val)))
-			return false;
-		++n;
-		src += sizeof(long);
+	r = __atomic_load_n(&size, __ATOMIC_RELAXED);
+	if (PINK_GCC_UNLIKELY(!r)) {
+		r = sysconf(_SC_PAGESIZE);
+		__atomic_store_n(&size, r, __ATOMIC_RELAXED);
 	}
+	return r;
+}
+
+#if defined(HAVE_PROCESS_VM_READV) || defined(__NR_process_vm_readv)
+/* Set when the running kernel doesn't implement process_vm_readv(2), by
+ * whichever tracing thread notices first */
+static bool vm_readv_nosys;
 
-	m = len % sizeof(long);
-	if (m) {
-		memcpy(u.x, src, m);
-		if (PINK_GCC_UNLIKELY(!pink_util_peekdata(pid, addr + n * ADDR_MUL, NULL)))
-			return false;
-		if (PINK_GCC_UNLIKELY(!pink_util_pokedata(pid, addr + n * ADDR_MUL, u.val)))
-			return false;
+static ssize_t
+vm_readv(pid_t pid, long addr, char *dest, size_t len)
+{
+	ssize_t r;
+	size_t count;
+	struct iovec local[1], remote[1];
+
+	count = 0;
+	while (count < len) {
+		local[0].iov_base = dest + count;
+		remote[0].iov_base = (void *)(addr + count);
+		local[0].iov_len = remote[0].iov_len = len - count;
+#ifdef HAVE_PROCESS_VM_READV
+		r = process_vm_readv(pid, local, 1, remote, 1, /*flags:*/ 0);
+#else
+		r = syscall(__NR_process_vm_readv, (long)pid, local, 1, remote, 1, 0);
+#endif
+		if (r < 0) {
+			if (count > 0 && errno == EFAULT) {
+				/* Ran into an unmapped page */
+				break;
+			}
+			return -1;
+		}
+		if (r == 0) {
+			if (count > 0)
+				break;
+			errno = EFAULT;
+			return -1;
+		}
+		/* A short read means the next page is not accessible,
+		 * the next round will tell us for sure. */
+		count += r;
 	}
 
-	return true;
+	return count;
 }
+#endif
 
-#define MIN(a,b)	(((a) < (b)) ? (a) : (b))
-bool
-pink_util_moven(pid_t pid, long addr, char *dest, size_t len)
+static ssize_t
+peekdata_readn(pid_t pid, long addr, char *dest, size_t len)
 {
 	int n, m;
-	int started = 0;
+	size_t count = 0;
 	union {
 		long val;
 		char x[sizeof(long)];
@@ -178,163 +275,685 @@ pink_util_moven(pid_t pid, long addr, char *dest, size_t len)
 		n = addr - (addr & -sizeof(long)); /* residue */
 		addr &= -sizeof(long); /* residue */
 
-		if (PINK_GCC_UNLIKELY(!pink_util_peekdata(pid, addr, &u.val))) {
-			if (PINK_GCC_LIKELY(started && (errno == EPERM || errno == EIO))) {
-				/* Ran into end of memory */
-				return true;
-			}
-			/* But if not started, we had a bogus address */
-			return false;
-		}
-		started = 1;
+		if (PINK_GCC_UNLIKELY(!pink_util_peekdata(pid, addr, &u.val)))
+			return -1;
 		memcpy(dest, &u.x[n], m = MIN(sizeof(long) - n, len));
-		addr += sizeof(long), dest += m, len -= m;
+		addr += sizeof(long), dest += m, len -= m, count += m;
 	}
 	while (len > 0) {
 		if (PINK_GCC_UNLIKELY(!pink_util_peekdata(pid, addr, &u.val))) {
-			if (PINK_GCC_LIKELY(started && (errno == EPERM || errno == EIO))) {
+			if (PINK_GCC_LIKELY(count > 0 && (errno == EPERM || errno == EIO || errno == EFAULT))) {
 				/* Ran into end of memory */
-				return true;
+				break;
 			}
 			/* But if not started, we had a bogus address */
-			return false;
+			return -1;
 		}
-		started = 1;
 		memcpy(dest, u.x, m = MIN(sizeof(long), len));
-		addr += sizeof(long), dest += m, len -= m;
+		addr += sizeof(long), dest += m, len -= m, count += m;
 	}
-	return true;
+	return count;
 }
 
-bool
-pink_util_movestr(pid_t pid, long addr, char *dest, size_t len)
+/* Whether pink_util_readn() is going to try process_vm_readv(2) */
+static bool
+vm_readv_usable(pid_t pid)
 {
-	int n, m;
-	int started = 0;
-	union {
-		long val;
-		char x[sizeof(long)];
-	} u;
+#if defined(HAVE_PROCESS_VM_READV) || defined(__NR_process_vm_readv)
+	struct pink_tracee *tracee;
 
-	if (addr & (sizeof(long) -1)) {
-		/* addr not a multiple of sizeof(long) */
-		n = addr - (addr & -sizeof(long)); /* residue */
-		addr &= -sizeof(long); /* residue */
+	if (PINK_GCC_UNLIKELY(__atomic_load_n(&vm_readv_nosys, __ATOMIC_RELAXED)))
+		return false;
+	tracee = _pink_tracee_lookup(pid);
+	return !(tracee && tracee->flags & PINK_TRACEE_VM_NOREADV);
+#else
+	return false;
+#endif
+}
 
-		if (PINK_GCC_UNLIKELY(!pink_util_peekdata(pid, addr, &u.val))) {
-			if (PINK_GCC_LIKELY(started && (errno == EPERM || errno == EIO || errno == EFAULT))) {
-				/* Ran into end of memory */
-				return true;
+#if defined(HAVE_PROCESS_VM_READV) || defined(__NR_process_vm_readv)
+/* Remember why process_vm_readv(2) failed, returns true if it is not going
+ * to be used for this tracee any more. */
+static bool
+vm_readv_failed(pid_t pid)
+{
+	struct pink_tracee *tracee;
+
+	switch (errno) {
+	case ENOSYS:
+		__atomic_store_n(&vm_readv_nosys, true, __ATOMIC_RELAXED);
+		return true;
+	case EPERM:
+		/* e.g. the tracee changed credentials,
+		 * ptrace(2) still works so remember to peek. */
+		tracee = _pink_tracee_get(pid);
+		if (tracee)
+			tracee->flags |= PINK_TRACEE_VM_NOREADV;
+		return true;
+	default:
+		return false;
+	}
+}
+#endif
+
+static ssize_t
+readn(pid_t pid, long addr, char *dest, size_t len)
+{
+#if defined(HAVE_PROCESS_VM_READV) || defined(__NR_process_vm_readv)
+	ssize_t r;
+
+	if (PINK_GCC_UNLIKELY(!vm_readv_usable(pid)))
+		goto peek;
+
+	r = vm_readv(pid, addr, dest, len);
+	if (PINK_GCC_LIKELY(r >= 0))
+		return r;
+	if (!vm_readv_failed(pid))
+		return -1;
+peek:
+#endif
+	return peekdata_readn(pid, addr, dest, len);
+}
+
+/* Return the cached page at the page aligned address page, reading it on a
+ * miss, or NULL if the page is not readable. */
+static const char *
+cache_page(pid_t pid, struct pink_cache *cache, unsigned long page, size_t page_size)
+{
+	unsigned i;
+	ssize_t r;
+
+	for (i = 0; i < PINK_CACHE_PAGES; i++) {
+		if (cache->valid & (1U << i) && cache->addr[i] == page) {
+			cache->hits++;
+			return cache->data + i * page_size;
+		}
+	}
+
+	cache->misses++;
+	if (PINK_GCC_UNLIKELY(!cache->data)) {
+		cache->data = malloc(PINK_CACHE_PAGES * page_size);
+		if (!cache->data)
+			return NULL;
+	}
+
+	i = cache->next;
+	cache->next = (i + 1) % PINK_CACHE_PAGES;
+	cache->valid &= ~(1U << i);
+
+	r = readn(pid, page, cache->data + i * page_size, page_size);
+	if (PINK_GCC_UNLIKELY(r != (ssize_t)page_size)) {
+		if (r >= 0)
+			errno = EFAULT;
+		return NULL;
+	}
+	cache->addr[i] = page;
+	cache->valid |= 1U << i;
+	return cache->data + i * page_size;
+}
+
+static ssize_t
+cache_readn(pid_t pid, struct pink_cache *cache, long addr, char *dest, size_t len)
+{
+	size_t page_size;
+	ssize_t r;
+	unsigned long page;
+	size_t count, off, m;
+	const char *data;
+
+	page_size = _pink_util_pagesize();
+
+	/* Large reads would only thrash the cache */
+	if (len > page_size)
+		return readn(pid, addr, dest, len);
+
+	for (count = 0; count < len; count += m) {
+		page = (addr + count) & ~(page_size - 1);
+		off = (addr + count) - page;
+		m = MIN(page_size - off, len - count);
+
+		data = cache_page(pid, cache, page, page_size);
+		if (PINK_GCC_UNLIKELY(!data)) {
+			if (errno == ENOMEM) {
+				/* Read the rest without the cache */
+				r = readn(pid, addr + count, dest + count, len - count);
+				if (r >= 0)
+					return count + r;
 			}
-			/* But if not started, we had a bogus address */
-			return false;
+			/* Ran into an unreadable page */
+			return count > 0 ? (ssize_t)count : -1;
 		}
-		started = 1;
-		memcpy(dest, &u.x[n], m = MIN(sizeof(long) - n, len));
-		while (n & (sizeof(long) - 1))
-			if (u.x[n++] == '\0')
-				return true;
-		addr += sizeof(long), dest += m, len -= m;
+		memcpy(dest + count, data + off, m);
 	}
-	while (len > 0) {
-		if (PINK_GCC_UNLIKELY(!pink_util_peekdata(pid, addr, &u.val))) {
-			if (PINK_GCC_LIKELY(started && (errno == EPERM || errno == EIO || errno == EFAULT))) {
-				/* Ran into end of memory */
+
+	return count;
+}
+
+ssize_t
+pink_util_readn(pid_t pid, long addr, char *dest, size_t len)
+{
+	struct pink_tracee *tracee;
+
+	if (PINK_GCC_UNLIKELY(len == 0))
+		return 0;
+
+	/* Filling whole pages word by word with PTRACE_PEEKDATA costs more
+	 * than the cache saves */
+	tracee = _pink_tracee_lookup(pid);
+	if (tracee && tracee->cache && vm_readv_usable(pid))
+		return cache_readn(pid, tracee->cache, addr, dest, len);
+	return readn(pid, addr, dest, len);
+}
+
+ssize_t
+_pink_util_vm_readv(pid_t pid, const struct iovec *local, unsigned long liovcnt,
+		const struct iovec *remote, unsigned long riovcnt)
+{
+#if defined(HAVE_PROCESS_VM_READV) || defined(__NR_process_vm_readv)
+	ssize_t r;
+
+	if (PINK_GCC_UNLIKELY(!vm_readv_usable(pid))) {
+		errno = ENOSYS;
+		return -1;
+	}
+
+#ifdef HAVE_PROCESS_VM_READV
+	r = process_vm_readv(pid, local, liovcnt, remote, riovcnt, /*flags:*/ 0);
+#else
+	r = syscall(__NR_process_vm_readv, (long)pid, local, liovcnt, remote, riovcnt, 0);
+#endif
+	if (r < 0 && vm_readv_failed(pid))
+		errno = ENOSYS;
+	return r;
+#else
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
+/* Number of requests per process_vm_readv(2) call */
+#define READV_BATCH	64
+
+bool
+pink_util_readv(pid_t pid, pink_util_iovec_t *iov, unsigned iovcnt)
+{
+	unsigned i, j, k;
+	ssize_t r;
+	size_t got, want;
+	struct iovec local[READV_BATCH], remote[READV_BATCH];
+	struct pink_tracee *tracee;
+	struct pink_cache *cache;
+
+	tracee = _pink_tracee_lookup(pid);
+	cache = tracee ? tracee->cache : NULL;
+
+	i = 0;
+	while (i < iovcnt) {
+		want = 0;
+		for (k = 0; k < READV_BATCH && i + k < iovcnt; k++) {
+			local[k].iov_base = iov[i + k].dest;
+			remote[k].iov_base = (void *)iov[i + k].addr;
+			local[k].iov_len = remote[k].iov_len = iov[i + k].len;
+			/* The memory map index, if any, tells where the
+			 * request runs into an inaccessible page */
+			if (cache)
+				local[k].iov_len = remote[k].iov_len = _pink_cache_maps_extent(pid,
+						cache, iov[i + k].addr, iov[i + k].len, PROT_READ);
+			want += local[k].iov_len;
+		}
+
+		r = want ? _pink_util_vm_readv(pid, local, k, remote, k) : 0;
+		if (PINK_GCC_UNLIKELY(r < 0)) {
+			switch (errno) {
+			case ENOSYS:
+				/* Read the requests one by one */
+				for (; i < iovcnt; i++) {
+					iov[i].count = pink_util_readn(pid, iov[i].addr, iov[i].dest, iov[i].len);
+					if (iov[i].count < 0 && errno != EFAULT && errno != EIO)
+						return false;
+				}
 				return true;
+			case EFAULT:
+				/* The first request starts in unmapped memory */
+				iov[i++].count = -1;
+				continue;
+			default:
+				return false;
 			}
-			/* But if not started, we had a bogus address */
-			return false;
 		}
-		started = 1;
-		memcpy(dest, u.x, m = MIN(sizeof(long), len));
-		for (unsigned int i = 0; i < sizeof(long); i++)
-			if (u.x[i] == '\0')
-				return true;
-		addr += sizeof(long), dest += m, len -= m;
+
+		for (j = 0; j < k; j++) {
+			got = MIN((size_t)r, local[j].iov_len);
+			r -= got;
+			if (got < local[j].iov_len) {
+				/* The transfer stopped at an inaccessible page. If
+				 * nothing of this request was read, the next call
+				 * tells whether it is inaccessible itself. */
+				if (got > 0 || j == 0)
+					iov[i++].count = got > 0 ? (ssize_t)got : -1;
+				break;
+			}
+			iov[i].count = got > 0 || iov[i].len == 0 ? (ssize_t)got : -1;
+			i++;
+		}
+	}
+
+	return true;
+}
+
+bool
+pink_util_moven(pid_t pid, long addr, char *dest, size_t len)
+{
+	return len == 0 || pink_util_readn(pid, addr, dest, len) > 0;
+}
+
+/* Read the string at addr, up to len bytes. Each read stops at the next page
+ * boundary, or word boundary when reading with PTRACE_PEEKDATA, so that
+ * nothing is read past the terminating zero-byte needlessly and an unmapped
+ * page after the string does not fail the read. Returns the number of bytes
+ * stored including the zero-byte, if found, and sets more if neither the
+ * zero-byte nor inaccessible memory was hit. */
+static ssize_t
+readstr(pid_t pid, long addr, char *dest, size_t len, bool *more)
+{
+	size_t page_size;
+	ssize_t r;
+	size_t chunk, count;
+	const char *nul;
+
+	page_size = _pink_util_pagesize();
+
+	count = 0;
+	*more = false;
+	while (count < len) {
+		if (PINK_GCC_LIKELY(vm_readv_usable(pid)))
+			chunk = page_size - ((addr + count) & (page_size - 1));
+		else
+			chunk = sizeof(long) - ((addr + count) & (sizeof(long) - 1));
+		chunk = MIN(chunk, len - count);
+
+		r = pink_util_readn(pid, addr + count, dest + count, chunk);
+		if (PINK_GCC_UNLIKELY(r <= 0)) {
+			/* If not started, we had a bogus address */
+			return count > 0 ? (ssize_t)count : -1;
+		}
+		nul = memchr(dest + count, '\0', r);
+		if (nul)
+			return nul - dest + 1;
+		count += r;
+		if (PINK_GCC_UNLIKELY((size_t)r < chunk)) {
+			/* Ran into end of memory */
+			return count;
+		}
+	}
+
+	*more = true;
+	return count;
+}
+
+/* Return the string at addr kept by the read cache, if any, and the cache to
+ * insert the string into once it is read otherwise. */
+static const struct pink_cache_string *
+cached_string(pid_t pid, long addr, struct pink_cache **cache)
+{
+	struct pink_tracee *tracee;
+
+	tracee = _pink_tracee_lookup(pid);
+	*cache = tracee ? tracee->cache : NULL;
+	return *cache ? _pink_cache_string_lookup(*cache, addr) : NULL;
+}
+
+ssize_t
+pink_util_readstr(pid_t pid, long addr, char *dest, size_t len, bool *truncated)
+{
+	bool more;
+	ssize_t r;
+	struct pink_cache *cache;
+	const struct pink_cache_string *s;
+
+	if (PINK_GCC_UNLIKELY(len == 0)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	s = cached_string(pid, addr, &cache);
+	if (s) {
+		r = MIN(s->len, len - 1);
+		memcpy(dest, s->str, r);
+		dest[r] = '\0';
+		*truncated = (size_t)r < s->len;
+		return r;
 	}
+
+	r = readstr(pid, addr, dest, len - 1, &more);
+	if (PINK_GCC_UNLIKELY(r < 0))
+		return -1;
+	if (r > 0 && dest[r - 1] == '\0') {
+		if (cache)
+			_pink_cache_string_insert(pid, cache, addr, dest, r - 1);
+		*truncated = false;
+		return r - 1;
+	}
+
+	dest[r] = '\0';
+	*truncated = true;
+	return r;
+}
+
+bool
+pink_util_movestr(pid_t pid, long addr, char *dest, size_t len)
+{
+	bool more;
+	ssize_t r;
+	struct pink_cache *cache;
+	const struct pink_cache_string *s;
+
+	if (PINK_GCC_UNLIKELY(len == 0))
+		return true;
+
+	s = cached_string(pid, addr, &cache);
+	if (s) {
+		memcpy(dest, s->str, MIN(s->len + 1, len));
+		return true;
+	}
+
+	r = readstr(pid, addr, dest, len, &more);
+	if (PINK_GCC_UNLIKELY(r < 0))
+		return false;
+	if (cache && r > 0 && dest[r - 1] == '\0')
+		_pink_cache_string_insert(pid, cache, addr, dest, r - 1);
 	return true;
 }
 
 char *
 pink_util_movestr_persistent(pid_t pid, long addr)
 {
-	int n, m, sum, save_errno;
-	bool started;
-	union {
-		long val;
-		char x[sizeof(long)];
-	} u;
-	char *res, *res_ptr;
-
-#define XFREE(x)			\
-	do {				\
-		if ((x)) {		\
-			free((x));	\
-		}			\
-	} while (0)
+	int save_errno;
+	bool more;
+	ssize_t r;
+	size_t count, size;
+	char *res, *p;
+	struct pink_cache *cache;
+	const struct pink_cache_string *s;
+
+	s = cached_string(pid, addr, &cache);
+	if (s) {
+		res = malloc(s->len + 1);
+		if (PINK_GCC_LIKELY(res != NULL))
+			memcpy(res, s->str, s->len + 1);
+		return res;
+	}
 
 	save_errno = errno;
-	started = false;
-	res = res_ptr = NULL;
-	sum = 0;
-
-	if (addr & (sizeof(long) -1)) {
-		/* addr not a multiple of sizeof(long) */
-		n = addr - (addr & -sizeof(long)); /* residue */
-		addr &= -sizeof(long); /* residue */
+	res = NULL;
+	count = size = 0;
+	do {
+		size = size ? size << 1 : 128;
+		/* Leave room for the zero-byte if memory ends first */
+		p = realloc(res, size + 1);
+		if (PINK_GCC_UNLIKELY(!p)) {
+			free(res);
+			return NULL;
+		}
+		res = p;
 
-		if (PINK_GCC_UNLIKELY(!pink_util_peekdata(pid, addr, &u.val))) {
-			if (PINK_GCC_LIKELY(started && (errno == EPERM || errno == EIO || errno == EFAULT))) {
-				/* Ran into end of memory */
-				return res;
-			}
-			/* But if not started, we had a bogus address */
-			XFREE(res);
-			if (PINK_GCC_UNLIKELY(!started)) {
-				/* NULL */
+		r = readstr(pid, addr + count, res + count, size - count, &more);
+		if (PINK_GCC_UNLIKELY(r < 0)) {
+			if (count == 0) {
+				/* Bogus address, NULL */
+				free(res);
 				errno = save_errno;
+				return NULL;
 			}
-			return NULL;
+			/* Ran into end of memory */
+			break;
 		}
-		m = sizeof(long) - n;
-		sum += m;
-		if ((res = realloc(res, sum)) == NULL)
+		count += r;
+	} while (more);
+
+	if (count == 0 || res[count - 1] != '\0')
+		res[count] = '\0';
+	else if (cache)
+		_pink_cache_string_insert(pid, cache, addr, res, count - 1);
+	return res;
+}
+
+char *
+pink_util_movestr_arena(pid_t pid, long addr, pink_arena_t *arena)
+{
+	int save_errno;
+	bool more;
+	ssize_t r;
+	size_t count, size;
+	char *res;
+	struct pink_cache *cache;
+	const struct pink_cache_string *s;
+
+	s = cached_string(pid, addr, &cache);
+	if (s) {
+		res = pink_arena_alloc(arena, s->len + 1);
+		if (PINK_GCC_LIKELY(res != NULL))
+			memcpy(res, s->str, s->len + 1);
+		return res;
+	}
+
+	save_errno = errno;
+	count = size = 0;
+	do {
+		size = size ? size << 1 : 128;
+		/* Leave room for the zero-byte if memory ends first */
+		res = _pink_arena_reserve(arena, size + 1, count);
+		if (PINK_GCC_UNLIKELY(!res))
 			return NULL;
-		res_ptr = started ? res + (sum - m) : res;
-		started = true;
-		memcpy(res_ptr, &u.x[n], m);
-		while (n & (sizeof(long) - 1))
-			if (u.x[n++] == '\0')
-				return res;
-		addr += sizeof(long);
+
+		r = readstr(pid, addr + count, res + count, size - count, &more);
+		if (PINK_GCC_UNLIKELY(r < 0)) {
+			if (count == 0) {
+				/* Bogus address, NULL */
+				errno = save_errno;
+				return NULL;
+			}
+			/* Ran into end of memory */
+			break;
+		}
+		count += r;
+	} while (more);
+
+	if (count == 0 || res[count - 1] != '\0')
+		res[count++] = '\0';
+	else if (cache)
+		_pink_cache_string_insert(pid, cache, addr, res, count - 1);
+	_pink_arena_commit(arena, count);
+	return res;
+}
+
+#if defined(HAVE_PROCESS_VM_WRITEV) || defined(__NR_process_vm_writev)
+/* Set when the running kernel doesn't implement process_vm_writev(2), by
+ * whichever tracing thread notices first */
+static bool vm_writev_nosys;
+
+static ssize_t
+vm_writev(pid_t pid, long addr, const char *src, size_t len)
+{
+	ssize_t r;
+	size_t count;
+	struct iovec local[1], remote[1];
+
+	count = 0;
+	while (count < len) {
+		local[0].iov_base = (void *)(src + count);
+		remote[0].iov_base = (void *)(addr + count);
+		local[0].iov_len = remote[0].iov_len = len - count;
+#ifdef HAVE_PROCESS_VM_WRITEV
+		r = process_vm_writev(pid, local, 1, remote, 1, /*flags:*/ 0);
+#else
+		r = syscall(__NR_process_vm_writev, (long)pid, local, 1, remote, 1, 0);
+#endif
+		if (r < 0) {
+			if (count > 0 && errno == EFAULT) {
+				/* Ran into a page we may not write */
+				break;
+			}
+			return -1;
+		}
+		if (r == 0) {
+			if (count > 0)
+				break;
+			errno = EFAULT;
+			return -1;
+		}
+		count += r;
 	}
 
-	for (;;) {
-		if (PINK_GCC_UNLIKELY(!pink_util_peekdata(pid, addr, &u.val))) {
-			if (PINK_GCC_LIKELY(started && (errno == EPERM || errno == EIO || errno == EFAULT))) {
-				/* Ran into end of memory */
-				return res;
+	return count;
+}
+#endif
+
+/* Write with PTRACE_POKEDATA, which unlike process_vm_writev(2) may write
+ * read-only mappings. The trailing partial word is merged with the data in
+ * the tracee. If safe is true, every page is checked to be readable once
+ * before it is written to. */
+static ssize_t
+pokedata_writen(pid_t pid, long addr, const char *src, size_t len, bool safe)
+{
+	unsigned long page_size;
+	bool checked;
+	unsigned long page, checked_page;
+	size_t count, m;
+	union {
+		long val;
+		char x[sizeof(long)];
+	} u;
+
+	page_size = _pink_util_pagesize();
+
+	checked = false;
+	checked_page = 0;
+	for (count = 0; count < len; count += m) {
+		m = MIN(sizeof(long), len - count);
+		/* The peeked word covers every page the poked word touches */
+		page = (addr + count + sizeof(long) - 1) & ~(page_size - 1);
+		if (safe && (!checked || page != checked_page)) {
+			if (PINK_GCC_UNLIKELY(!pink_util_peekdata(pid, addr + count, NULL)))
+				goto fail;
+			checked = true;
+			checked_page = page;
+		}
+		if (m < sizeof(long)) {
+			if (PINK_GCC_UNLIKELY(!pink_util_peekdata(pid, addr + count, &u.val)))
+				goto fail;
+		}
+		memcpy(u.x, src + count, m);
+		if (PINK_GCC_UNLIKELY(!pink_util_pokedata(pid, addr + count, u.val)))
+			goto fail;
+	}
+	return count;
+
+fail:
+	if (count > 0 && (errno == EPERM || errno == EIO || errno == EFAULT)) {
+		/* Ran into end of memory */
+		return count;
+	}
+	return -1;
+}
+
+static ssize_t
+writen(pid_t pid, long addr, const char *src, size_t len, bool safe)
+{
+	ssize_t r, p;
+
+	if (PINK_GCC_UNLIKELY(len == 0))
+		return 0;
+
+	_pink_tracee_invalidate(pid, addr, len);
+
+	r = 0;
+#if defined(HAVE_PROCESS_VM_WRITEV) || defined(__NR_process_vm_writev)
+	if (PINK_GCC_LIKELY(!__atomic_load_n(&vm_writev_nosys, __ATOMIC_RELAXED))) {
+		struct pink_tracee *tracee;
+
+		tracee = _pink_tracee_lookup(pid);
+		if (PINK_GCC_LIKELY(!(tracee && tracee->flags & PINK_TRACEE_VM_NOWRITEV))) {
+			r = vm_writev(pid, addr, src, len);
+			if (PINK_GCC_LIKELY(r == (ssize_t)len))
+				return r;
+			if (r < 0) {
+				switch (errno) {
+				case ENOSYS:
+					__atomic_store_n(&vm_writev_nosys, true, __ATOMIC_RELAXED);
+					break;
+				case EPERM:
+					tracee = _pink_tracee_get(pid);
+					if (tracee)
+						tracee->flags |= PINK_TRACEE_VM_NOWRITEV;
+					break;
+				case EFAULT:
+					/* Read-only or unmapped, poke tells */
+					break;
+				default:
+					return -1;
+				}
+				r = 0;
 			}
-			/* But if not started, we had a bogus address */
-			XFREE(res);
-			if (PINK_GCC_UNLIKELY(!started)) {
-				/* NULL */
-				errno = save_errno;
+		}
+	}
+#endif
+
+	/* Whatever process_vm_writev(2) refused, the memory map index, if
+	 * any, tells how much of it is readable without peeking */
+	if (safe) {
+		struct pink_tracee *tracee;
+		size_t m;
+
+		tracee = _pink_tracee_lookup(pid);
+		if (tracee && tracee->cache) {
+			m = _pink_cache_maps_extent(pid, tracee->cache, addr + r, len - r, PROT_READ);
+			if (m == 0) {
+				errno = EFAULT;
+				return r > 0 ? r : -1;
 			}
-			return NULL;
+			len = r + m;
+			safe = false;
 		}
-		sum += sizeof(long);
-		if ((res = realloc(res, sum)) == NULL)
-			return NULL;
-		res_ptr = started ? res + (sum - sizeof(long)) : res;
-		started = true;
-		memcpy(res_ptr, u.x, sizeof(long));
-		for (unsigned int i = 0; i < sizeof(long); i++)
-			if (u.x[i] == '\0')
-				return res;
-		addr += sizeof(long);
 	}
-	/* never reached */
-	assert(false);
-#undef XFREE
+	p = pokedata_writen(pid, addr + r, src + r, len - r, safe);
+	if (p < 0)
+		return r > 0 ? r : -1;
+	return r + p;
+}
+
+ssize_t
+pink_util_writen(pid_t pid, long addr, const char *src, size_t len)
+{
+	return writen(pid, addr, src, len, true);
+}
+
+bool
+pink_util_putn(pid_t pid, long addr, const char *src, size_t len)
+{
+	ssize_t r;
+
+	r = writen(pid, addr, src, len, false);
+	if (PINK_GCC_UNLIKELY(r < 0))
+		return false;
+	if (PINK_GCC_UNLIKELY((size_t)r < len)) {
+		errno = EFAULT;
+		return false;
+	}
+	return true;
+}
+
+bool
+pink_util_putn_safe(pid_t pid, long addr, const char *src, size_t len)
+{
+	ssize_t r;
+
+	r = writen(pid, addr, src, len, true);
+	if (PINK_GCC_UNLIKELY(r < 0))
+		return false;
+	if (PINK_GCC_UNLIKELY((size_t)r < len)) {
+		errno = EFAULT;
+		return false;
+	}
+	return true;
 }
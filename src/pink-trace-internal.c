@@ -25,6 +25,7 @@
  * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <errno.h>
 #include <string.h>
 
 #include <pinktrace/internal.h>
@@ -55,3 +56,61 @@ _pink_decode_socket_address(pid_t pid, long addr, long addrlen, pink_socket_addr
 	paddr->length = addrlen;
 	return true;
 }
+
+#if PINK_OS_LINUX
+bool
+_pink_decode_socketcall_args(pid_t pid, pink_bitness_t bitness, long *fd, unsigned ind, long *args, unsigned nargs)
+{
+	unsigned i, n;
+	unsigned short wordsize;
+	long addr;
+	union {
+		unsigned int p32;
+		unsigned long p64;
+		char data[sizeof(long)];
+	} ufd;
+	union {
+		unsigned int p32[PINK_MAX_ARGS];
+		unsigned long p64[PINK_MAX_ARGS];
+		char data[PINK_MAX_ARGS * sizeof(long)];
+	} uargs;
+	pink_util_iovec_t iov[2];
+
+	if (PINK_GCC_UNLIKELY(ind + nargs > PINK_MAX_ARGS)) {
+		errno = EINVAL;
+		return false;
+	}
+	if (PINK_GCC_UNLIKELY(!pink_util_get_arg(pid, bitness, 1, &addr)))
+		return false;
+
+	wordsize = pink_bitness_wordsize(bitness);
+	n = 0;
+	if (fd) {
+		iov[n].addr = addr;
+		iov[n].dest = ufd.data;
+		iov[n].len = wordsize;
+		n++;
+	}
+	if (nargs) {
+		iov[n].addr = addr + ind * wordsize;
+		iov[n].dest = uargs.data;
+		iov[n].len = nargs * wordsize;
+		n++;
+	}
+
+	if (PINK_GCC_UNLIKELY(!pink_util_readv(pid, iov, n)))
+		return false;
+	for (i = 0; i < n; i++) {
+		if (PINK_GCC_UNLIKELY(iov[i].count != (ssize_t)iov[i].len)) {
+			errno = EFAULT;
+			return false;
+		}
+	}
+
+	if (fd)
+		*fd = (wordsize == sizeof(int)) ? (long)(int)ufd.p32 : (long)ufd.p64;
+	for (i = 0; i < nargs; i++)
+		args[i] = (wordsize == sizeof(int)) ? (long)uargs.p32[i] : (long)uargs.p64[i];
+	return true;
+}
+#endif /* PINK_OS_LINUX */
@@ -732,6 +732,161 @@ START_TEST(t_decode_string_array_member_persistent)
 }
 END_TEST
 
+START_TEST(t_decode_string_array_member_arena)
+{
+	int status;
+	long arg;
+	char *buf, *first, *second;
+	char *const myargv[] = { "/dev/null", "/dev/zero", NULL };
+	pid_t pid;
+	pink_event_t event;
+	pink_arena_t *arena;
+
+	if ((pid = fork()) < 0)
+		fail("fork: %d(%s)", errno, strerror(errno));
+	else if (!pid) { /* child */
+		if (!pink_trace_me()) {
+			perror("pink_trace_me");
+			_exit(-1);
+		}
+		kill(getpid(), SIGSTOP);
+		execvp("true", myargv);
+	}
+	else { /* parent */
+		fail_if(waitpid(pid, &status, 0) < 0, "%d(%s)", errno, strerror(errno));
+		fail_unless(WIFSTOPPED(status), "%#x", status);
+		fail_unless(WSTOPSIG(status) == SIGSTOP, "%#x", status);
+		fail_unless(pink_trace_setup(pid, PINK_TRACE_OPTION_SYSGOOD), "%d(%s)", errno, strerror(errno));
+
+		/* Resume the child and it will stop at the next system call */
+		fail_unless(pink_trace_syscall(pid, 0), "%d(%s)", errno, strerror(errno));
+
+		/* Make sure we got the right event */
+		fail_if(waitpid(pid, &status, 0) < 0, "%d(%s)", errno, strerror(errno));
+		event = pink_event_decide(status);
+		fail_unless(event == PINK_EVENT_SYSCALL, "%d != %d", PINK_EVENT_SYSCALL, event);
+
+		fail_unless(pink_util_get_arg(pid, PINKTRACE_BITNESS_DEFAULT, 1, &arg),
+			"%d(%s)", errno, strerror(errno));
+
+		/* Tiny blocks so that strings have to move between blocks */
+		arena = pink_arena_new(16);
+		fail_if(arena == NULL, "%d(%s)", errno, strerror(errno));
+
+		for (unsigned int i = 0; i < 2; i++) {
+			buf = pink_decode_string_arena(pid, PINKTRACE_BITNESS_DEFAULT, 0, arena);
+			fail_if(buf == NULL, "%d(%s)", errno, strerror(errno));
+			fail_if(strstr(buf, "true") == NULL, "`%s'", buf);
+
+			first = pink_decode_string_array_member_arena(pid, PINKTRACE_BITNESS_DEFAULT, arg, 0, arena);
+			fail_if(first == NULL, "%d(%s)", errno, strerror(errno));
+			second = pink_decode_string_array_member_arena(pid, PINKTRACE_BITNESS_DEFAULT, arg, 1, arena);
+			fail_if(second == NULL, "%d(%s)", errno, strerror(errno));
+			fail_unless(0 == strcmp(first, "/dev/null"), "/dev/null != `%s'", first);
+			fail_unless(0 == strcmp(second, "/dev/zero"), "/dev/zero != `%s'", second);
+
+			errno = 0;
+			buf = pink_decode_string_array_member_arena(pid, PINKTRACE_BITNESS_DEFAULT, arg, 2, arena);
+			if (errno)
+				fail("%d(%s)", errno, strerror(errno));
+			fail_unless(buf == NULL, "`%s'", buf);
+
+			/* The blocks are reused after reset */
+			pink_arena_reset(arena);
+		}
+
+		pink_arena_free(arena);
+		pink_trace_kill(pid);
+	}
+}
+END_TEST
+
+START_TEST(t_decode_string_array)
+{
+	int status;
+	long arg;
+	ssize_t count;
+	bool truncated;
+	char *myargv[130];
+	char name[16];
+	const char *rec;
+	pid_t pid;
+	pink_event_t event;
+	static unsigned buf[16384];
+
+	/* Plenty of short strings and a few which span page boundaries */
+	for (unsigned int i = 0; i < 128; i++) {
+		if (i % 32 == 31) {
+			myargv[i] = malloc(5000);
+			fail_if(myargv[i] == NULL, "%d(%s)", errno, strerror(errno));
+			memset(myargv[i], 'x', 4999);
+			myargv[i][4999] = '\0';
+		}
+		else {
+			snprintf(name, sizeof(name), "arg%u", i);
+			myargv[i] = strdup(name);
+			fail_if(myargv[i] == NULL, "%d(%s)", errno, strerror(errno));
+		}
+	}
+	myargv[128] = NULL;
+
+	if ((pid = fork()) < 0)
+		fail("fork: %d(%s)", errno, strerror(errno));
+	else if (!pid) { /* child */
+		if (!pink_trace_me()) {
+			perror("pink_trace_me");
+			_exit(-1);
+		}
+		kill(getpid(), SIGSTOP);
+		execvp("true", myargv);
+	}
+	else { /* parent */
+		fail_if(waitpid(pid, &status, 0) < 0, "%d(%s)", errno, strerror(errno));
+		fail_unless(WIFSTOPPED(status), "%#x", status);
+		fail_unless(WSTOPSIG(status) == SIGSTOP, "%#x", status);
+		fail_unless(pink_trace_setup(pid, PINK_TRACE_OPTION_SYSGOOD), "%d(%s)", errno, strerror(errno));
+
+		/* Resume the child and it will stop at the next system call */
+		fail_unless(pink_trace_syscall(pid, 0), "%d(%s)", errno, strerror(errno));
+
+		/* Make sure we got the right event */
+		fail_if(waitpid(pid, &status, 0) < 0, "%d(%s)", errno, strerror(errno));
+		event = pink_event_decide(status);
+		fail_unless(event == PINK_EVENT_SYSCALL, "%d != %d", PINK_EVENT_SYSCALL, event);
+
+		fail_unless(pink_util_get_arg(pid, PINKTRACE_BITNESS_DEFAULT, 1, &arg),
+			"%d(%s)", errno, strerror(errno));
+
+		count = pink_decode_string_array(pid, PINKTRACE_BITNESS_DEFAULT, arg,
+				(char *)buf, sizeof(buf), &truncated);
+		fail_unless(count == 128, "%zd != 128 (%d %s)", count, errno, strerror(errno));
+		fail_unless(!truncated, "truncated");
+		rec = (const char *)buf;
+		for (unsigned int i = 0; i < 128; i++, rec = PINK_STRING_ARRAY_NEXT(rec)) {
+			fail_unless(PINK_STRING_ARRAY_LENGTH(rec) == strlen(myargv[i]), "%u: %u != %zu",
+					i, PINK_STRING_ARRAY_LENGTH(rec), strlen(myargv[i]));
+			fail_unless(0 == strcmp(PINK_STRING_ARRAY_STRING(rec), myargv[i]), "%u: `%s' != `%s'",
+					i, PINK_STRING_ARRAY_STRING(rec), myargv[i]);
+		}
+
+		/* Byte budget */
+		count = pink_decode_string_array(pid, PINKTRACE_BITNESS_DEFAULT, arg,
+				(char *)buf, 64, &truncated);
+		fail_unless(count > 0 && count < 128, "%zd (%d %s)", count, errno, strerror(errno));
+		fail_unless(truncated, "not truncated");
+		rec = (const char *)buf;
+		for (ssize_t i = 0; i < count; i++, rec = PINK_STRING_ARRAY_NEXT(rec))
+			fail_unless(0 == strcmp(PINK_STRING_ARRAY_STRING(rec), myargv[i]), "%zd: `%s' != `%s'",
+					i, PINK_STRING_ARRAY_STRING(rec), myargv[i]);
+
+		pink_trace_kill(pid);
+	}
+
+	for (unsigned int i = 0; i < 128; i++)
+		free(myargv[i]);
+}
+END_TEST
+
 START_TEST(t_decode_socket_call)
 {
 	int status;
@@ -1809,6 +1964,8 @@ decode_suite_create(void)
 	tcase_add_test(tc_pink_decode, t_decode_string_array_member);
 	tcase_add_test(tc_pink_decode, t_decode_string_array_member_persistent_null);
 	tcase_add_test(tc_pink_decode, t_decode_string_array_member_persistent);
+	tcase_add_test(tc_pink_decode, t_decode_string_array_member_arena);
+	tcase_add_test(tc_pink_decode, t_decode_string_array);
 
 	tcase_add_test(tc_pink_decode, t_decode_socket_call);
 	tcase_add_test(tc_pink_decode, t_decode_socket_fd);
@@ -387,6 +387,53 @@ START_TEST(t_event_unknown)
 }
 END_TEST
 
+START_TEST(t_event_seize)
+{
+	int status;
+	pid_t pid;
+	pink_event_t event;
+
+	if ((pid = fork()) < 0)
+		fail("fork: %s", strerror(errno));
+	else if (!pid) { /* child */
+		for (;;)
+			pause();
+	}
+	else { /* parent */
+		fail_unless(pink_trace_seize(pid, PINK_TRACE_OPTION_SYSGOOD),
+			"%d(%s)", errno, strerror(errno));
+
+		/* Stop the child, without a signal */
+		fail_unless(pink_trace_interrupt(pid), "%d(%s)", errno, strerror(errno));
+		fail_if(waitpid(pid, &status, __WALL) < 0, "%d(%s)", errno, strerror(errno));
+		event = pink_event_decide(status);
+		fail_unless(event == PINK_EVENT_INTERRUPT, "%d != %d", PINK_EVENT_INTERRUPT, event);
+
+		/* SIGSTOP is reported as a signal first, delivering it results
+		 * in a group-stop. */
+		kill(pid, SIGSTOP);
+		fail_unless(pink_trace_resume(pid, 0), "%d(%s)", errno, strerror(errno));
+		fail_if(waitpid(pid, &status, __WALL) < 0, "%d(%s)", errno, strerror(errno));
+		event = pink_event_decide(status);
+		fail_unless(event == PINK_EVENT_STOP, "%d != %d", PINK_EVENT_STOP, event);
+
+		fail_unless(pink_trace_resume(pid, SIGSTOP), "%d(%s)", errno, strerror(errno));
+		fail_if(waitpid(pid, &status, __WALL) < 0, "%d(%s)", errno, strerror(errno));
+		event = pink_event_decide(status);
+		fail_unless(event == PINK_EVENT_GROUP_STOP, "%d != %d", PINK_EVENT_GROUP_STOP, event);
+
+		/* The child stays stopped until SIGCONT */
+		fail_unless(pink_trace_listen(pid), "%d(%s)", errno, strerror(errno));
+		kill(pid, SIGCONT);
+		fail_if(waitpid(pid, &status, __WALL) < 0, "%d(%s)", errno, strerror(errno));
+		event = pink_event_decide(status);
+		fail_unless(event == PINK_EVENT_INTERRUPT, "%d != %d", PINK_EVENT_INTERRUPT, event);
+
+		pink_trace_kill(pid);
+	}
+}
+END_TEST
+
 Suite *
 event_suite_create(void)
 {
@@ -407,6 +454,7 @@ event_suite_create(void)
 	tcase_add_test(tc_pink_event, t_event_exit_genuine);
 	tcase_add_test(tc_pink_event, t_event_exit_signal);
 	tcase_add_test(tc_pink_event, t_event_unknown);
+	tcase_add_test(tc_pink_event, t_event_seize);
 
 	suite_add_tcase(s, tc_pink_event);
 
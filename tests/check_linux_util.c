@@ -824,6 +824,832 @@ START_TEST(t_util_set_arg_sixth)
 }
 END_TEST
 
+START_TEST(t_util_readn)
+{
+	int status;
+	long addr;
+	ssize_t r;
+	pid_t pid;
+	pink_event_t event;
+	char buf[64];
+
+	if ((pid = fork()) < 0)
+		fail("fork: %d(%s)", errno, strerror(errno));
+	else if (!pid) { /* child */
+		char data[64];
+
+		memset(data, 'p', sizeof(data));
+		if (!pink_trace_me()) {
+			perror("pink_trace_me");
+			_exit(-1);
+		}
+		kill(getpid(), SIGSTOP);
+		syscall(SYS_write, -1, data, sizeof(data));
+	}
+	else { /* parent */
+		fail_if(waitpid(pid, &status, 0) < 0, "%d(%s)", errno, strerror(errno));
+		fail_unless(WIFSTOPPED(status), "%#x", status);
+		fail_unless(WSTOPSIG(status) == SIGSTOP, "%#x", status);
+		fail_unless(pink_trace_setup(pid, PINK_TRACE_OPTION_SYSGOOD), "%d(%s)", errno, strerror(errno));
+
+		/* Resume the child and it will stop at the next system call */
+		fail_unless(pink_trace_syscall(pid, 0), "%d(%s)", errno, strerror(errno));
+
+		/* Make sure we got the right event */
+		fail_if(waitpid(pid, &status, 0) < 0, "%d(%s)", errno, strerror(errno));
+		event = pink_event_decide(status);
+		fail_unless(event == PINK_EVENT_SYSCALL, "%d != %d", PINK_EVENT_SYSCALL, event);
+
+		fail_unless(pink_util_get_arg(pid, PINKTRACE_BITNESS_DEFAULT, 1, &addr), "%d(%s)",
+			errno, strerror(errno));
+		memset(buf, 0, sizeof(buf));
+		r = pink_util_readn(pid, addr, buf, sizeof(buf));
+		fail_unless(r == sizeof(buf), "%zd != %zu (%d %s)", r, sizeof(buf), errno, strerror(errno));
+		for (unsigned int i = 0; i < sizeof(buf); i++)
+			fail_unless(buf[i] == 'p', "%u: %#x != 'p'", i, buf[i]);
+
+		pink_trace_kill(pid);
+	}
+}
+END_TEST
+
+START_TEST(t_util_readn_partial)
+{
+	int status;
+	long addr;
+	ssize_t r;
+	pid_t pid;
+	pink_event_t event;
+	char buf[64];
+
+	if ((pid = fork()) < 0)
+		fail("fork: %d(%s)", errno, strerror(errno));
+	else if (!pid) { /* child */
+		char *page;
+		long pagesize = sysconf(_SC_PAGESIZE);
+
+		/* Two pages, the second one being inaccessible */
+		page = mmap(NULL, 2 * pagesize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (page == MAP_FAILED || mprotect(page + pagesize, pagesize, PROT_NONE) < 0) {
+			perror("mmap");
+			_exit(-1);
+		}
+		memset(page, 'p', pagesize);
+		if (!pink_trace_me()) {
+			perror("pink_trace_me");
+			_exit(-1);
+		}
+		kill(getpid(), SIGSTOP);
+		syscall(SYS_write, -1, page + pagesize - 16, 64);
+	}
+	else { /* parent */
+		fail_if(waitpid(pid, &status, 0) < 0, "%d(%s)", errno, strerror(errno));
+		fail_unless(WIFSTOPPED(status), "%#x", status);
+		fail_unless(WSTOPSIG(status) == SIGSTOP, "%#x", status);
+		fail_unless(pink_trace_setup(pid, PINK_TRACE_OPTION_SYSGOOD), "%d(%s)", errno, strerror(errno));
+
+		/* Resume the child and it will stop at the next system call */
+		fail_unless(pink_trace_syscall(pid, 0), "%d(%s)", errno, strerror(errno));
+
+		/* Make sure we got the right event */
+		fail_if(waitpid(pid, &status, 0) < 0, "%d(%s)", errno, strerror(errno));
+		event = pink_event_decide(status);
+		fail_unless(event == PINK_EVENT_SYSCALL, "%d != %d", PINK_EVENT_SYSCALL, event);
+
+		fail_unless(pink_util_get_arg(pid, PINKTRACE_BITNESS_DEFAULT, 1, &addr), "%d(%s)",
+			errno, strerror(errno));
+
+		/* Stop at the page boundary */
+		memset(buf, 0, sizeof(buf));
+		r = pink_util_readn(pid, addr, buf, sizeof(buf));
+		fail_unless(r == 16, "%zd != 16 (%d %s)", r, errno, strerror(errno));
+		for (unsigned int i = 0; i < 16; i++)
+			fail_unless(buf[i] == 'p', "%u: %#x != 'p'", i, buf[i]);
+		fail_unless(pink_util_moven(pid, addr, buf, sizeof(buf)), "%d(%s)", errno, strerror(errno));
+
+		/* Nothing readable at all */
+		errno = 0;
+		r = pink_util_readn(pid, addr + 16, buf, sizeof(buf));
+		fail_unless(r == -1, "%zd != -1", r);
+		fail_unless(errno == EFAULT || errno == EIO, "%d(%s)", errno, strerror(errno));
+
+		pink_trace_kill(pid);
+	}
+}
+END_TEST
+
+START_TEST(t_util_readstr)
+{
+	int status;
+	long addr, end;
+	ssize_t r;
+	bool truncated;
+	pid_t pid;
+	pink_event_t event;
+	char buf[64], *str;
+
+	if ((pid = fork()) < 0)
+		fail("fork: %d(%s)", errno, strerror(errno));
+	else if (!pid) { /* child */
+		char *page;
+		long pagesize = sysconf(_SC_PAGESIZE);
+
+		/* Two pages, the second one being inaccessible */
+		page = mmap(NULL, 2 * pagesize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (page == MAP_FAILED || mprotect(page + pagesize, pagesize, PROT_NONE) < 0) {
+			perror("mmap");
+			_exit(-1);
+		}
+		memset(page, 'p', pagesize);
+		strcpy(page + 3, "pinktrace");
+		if (!pink_trace_me()) {
+			perror("pink_trace_me");
+			_exit(-1);
+		}
+		kill(getpid(), SIGSTOP);
+		syscall(SYS_write, -1, page + 3, page + pagesize - 16);
+	}
+	else { /* parent */
+		fail_if(waitpid(pid, &status, 0) < 0, "%d(%s)", errno, strerror(errno));
+		fail_unless(WIFSTOPPED(status), "%#x", status);
+		fail_unless(WSTOPSIG(status) == SIGSTOP, "%#x", status);
+		fail_unless(pink_trace_setup(pid, PINK_TRACE_OPTION_SYSGOOD), "%d(%s)", errno, strerror(errno));
+
+		/* Resume the child and it will stop at the next system call */
+		fail_unless(pink_trace_syscall(pid, 0), "%d(%s)", errno, strerror(errno));
+
+		/* Make sure we got the right event */
+		fail_if(waitpid(pid, &status, 0) < 0, "%d(%s)", errno, strerror(errno));
+		event = pink_event_decide(status);
+		fail_unless(event == PINK_EVENT_SYSCALL, "%d != %d", PINK_EVENT_SYSCALL, event);
+
+		fail_unless(pink_util_get_arg(pid, PINKTRACE_BITNESS_DEFAULT, 1, &addr), "%d(%s)",
+			errno, strerror(errno));
+		fail_unless(pink_util_get_arg(pid, PINKTRACE_BITNESS_DEFAULT, 2, &end), "%d(%s)",
+			errno, strerror(errno));
+
+		/* Unaligned, zero-terminated string */
+		r = pink_util_readstr(pid, addr, buf, sizeof(buf), &truncated);
+		fail_unless(r == 9, "%zd != 9 (%d %s)", r, errno, strerror(errno));
+		fail_unless(!truncated, "truncated");
+		fail_unless(!strcmp(buf, "pinktrace"), "`%s' != `pinktrace'", buf);
+
+		/* Does not fit into the buffer */
+		r = pink_util_readstr(pid, addr, buf, 5, &truncated);
+		fail_unless(r == 4, "%zd != 4 (%d %s)", r, errno, strerror(errno));
+		fail_unless(truncated, "not truncated");
+		fail_unless(!strcmp(buf, "pink"), "`%s' != `pink'", buf);
+
+		/* Runs into the inaccessible page */
+		r = pink_util_readstr(pid, end, buf, sizeof(buf), &truncated);
+		fail_unless(r == 16, "%zd != 16 (%d %s)", r, errno, strerror(errno));
+		fail_unless(truncated, "not truncated");
+		fail_unless(strlen(buf) == 16, "%zu != 16", strlen(buf));
+
+		/* Nothing readable at all */
+		errno = 0;
+		r = pink_util_readstr(pid, end + 16, buf, sizeof(buf), &truncated);
+		fail_unless(r == -1, "%zd != -1", r);
+		fail_unless(errno == EFAULT || errno == EIO, "%d(%s)", errno, strerror(errno));
+
+		memset(buf, 0, sizeof(buf));
+		fail_unless(pink_util_movestr(pid, addr, buf, sizeof(buf)), "%d(%s)", errno, strerror(errno));
+		fail_unless(!strcmp(buf, "pinktrace"), "`%s' != `pinktrace'", buf);
+
+		str = pink_util_movestr_persistent(pid, addr);
+		fail_if(str == NULL, "%d(%s)", errno, strerror(errno));
+		fail_unless(!strcmp(str, "pinktrace"), "`%s' != `pinktrace'", str);
+		free(str);
+
+		str = pink_util_movestr_persistent(pid, end);
+		fail_if(str == NULL, "%d(%s)", errno, strerror(errno));
+		fail_unless(strlen(str) == 16, "%zu != 16", strlen(str));
+		free(str);
+
+		pink_trace_kill(pid);
+	}
+}
+END_TEST
+
+START_TEST(t_util_readv)
+{
+	int status;
+	long addr, pagesize;
+	pid_t pid;
+	pink_event_t event;
+	char buf[4][64];
+	pink_util_iovec_t iov[4];
+
+	pagesize = sysconf(_SC_PAGESIZE);
+	if ((pid = fork()) < 0)
+		fail("fork: %d(%s)", errno, strerror(errno));
+	else if (!pid) { /* child */
+		char *page;
+
+		/* Two pages, the second one being inaccessible */
+		page = mmap(NULL, 2 * pagesize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (page == MAP_FAILED || mprotect(page + pagesize, pagesize, PROT_NONE) < 0) {
+			perror("mmap");
+			_exit(-1);
+		}
+		for (long i = 0; i < pagesize; i++)
+			page[i] = 'a' + i % 26;
+		if (!pink_trace_me()) {
+			perror("pink_trace_me");
+			_exit(-1);
+		}
+		kill(getpid(), SIGSTOP);
+		syscall(SYS_write, -1, page, 0);
+	}
+	else { /* parent */
+		fail_if(waitpid(pid, &status, 0) < 0, "%d(%s)", errno, strerror(errno));
+		fail_unless(WIFSTOPPED(status), "%#x", status);
+		fail_unless(WSTOPSIG(status) == SIGSTOP, "%#x", status);
+		fail_unless(pink_trace_setup(pid, PINK_TRACE_OPTION_SYSGOOD), "%d(%s)", errno, strerror(errno));
+
+		/* Resume the child and it will stop at the next system call */
+		fail_unless(pink_trace_syscall(pid, 0), "%d(%s)", errno, strerror(errno));
+
+		/* Make sure we got the right event */
+		fail_if(waitpid(pid, &status, 0) < 0, "%d(%s)", errno, strerror(errno));
+		event = pink_event_decide(status);
+		fail_unless(event == PINK_EVENT_SYSCALL, "%d != %d", PINK_EVENT_SYSCALL, event);
+
+		fail_unless(pink_util_get_arg(pid, PINKTRACE_BITNESS_DEFAULT, 1, &addr), "%d(%s)",
+			errno, strerror(errno));
+
+		/* Whole, partial, inaccessible and whole again */
+		iov[0].addr = addr + 1;
+		iov[0].len = 26;
+		iov[1].addr = addr + pagesize - 8;
+		iov[1].len = 64;
+		iov[2].addr = addr + pagesize;
+		iov[2].len = 8;
+		iov[3].addr = addr + 26;
+		iov[3].len = 64;
+		for (unsigned int i = 0; i < 4; i++) {
+			iov[i].dest = buf[i];
+			iov[i].count = 0;
+		}
+		memset(buf, 0, sizeof(buf));
+
+		fail_unless(pink_util_readv(pid, iov, 4), "%d(%s)", errno, strerror(errno));
+		fail_unless(iov[0].count == 26, "%zd != 26", iov[0].count);
+		fail_unless(iov[1].count == 8, "%zd != 8", iov[1].count);
+		fail_unless(iov[2].count == -1, "%zd != -1", iov[2].count);
+		fail_unless(iov[3].count == 64, "%zd != 64", iov[3].count);
+		for (unsigned int i = 0; i < 4; i++) {
+			for (ssize_t j = 0; j < iov[i].count; j++) {
+				char c = 'a' + (iov[i].addr - addr + j) % 26;
+				fail_unless(buf[i][j] == c, "%u: %zd: %#x != %#x", i, j, buf[i][j], c);
+			}
+		}
+
+		pink_trace_kill(pid);
+	}
+}
+END_TEST
+
+START_TEST(t_util_writen)
+{
+	int status;
+	long addr, pagesize;
+	ssize_t r;
+	pid_t pid;
+	pink_event_t event;
+	char buf[32];
+
+	pagesize = sysconf(_SC_PAGESIZE);
+	if ((pid = fork()) < 0)
+		fail("fork: %d(%s)", errno, strerror(errno));
+	else if (!pid) { /* child */
+		char *page;
+
+		/* A writable page, a read-only page and an unmapped page */
+		page = mmap(NULL, 3 * pagesize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (page == MAP_FAILED) {
+			perror("mmap");
+			_exit(-1);
+		}
+		memset(page, 'p', 2 * pagesize);
+		if (mprotect(page + pagesize, pagesize, PROT_READ) < 0
+				|| munmap(page + 2 * pagesize, pagesize) < 0) {
+			perror("mprotect");
+			_exit(-1);
+		}
+		if (!pink_trace_me()) {
+			perror("pink_trace_me");
+			_exit(-1);
+		}
+		kill(getpid(), SIGSTOP);
+		syscall(SYS_write, -1, page, 0);
+	}
+	else { /* parent */
+		fail_if(waitpid(pid, &status, 0) < 0, "%d(%s)", errno, strerror(errno));
+		fail_unless(WIFSTOPPED(status), "%#x", status);
+		fail_unless(WSTOPSIG(status) == SIGSTOP, "%#x", status);
+		fail_unless(pink_trace_setup(pid, PINK_TRACE_OPTION_SYSGOOD), "%d(%s)", errno, strerror(errno));
+
+		/* Resume the child and it will stop at the next system call */
+		fail_unless(pink_trace_syscall(pid, 0), "%d(%s)", errno, strerror(errno));
+
+		/* Make sure we got the right event */
+		fail_if(waitpid(pid, &status, 0) < 0, "%d(%s)", errno, strerror(errno));
+		event = pink_event_decide(status);
+		fail_unless(event == PINK_EVENT_SYSCALL, "%d != %d", PINK_EVENT_SYSCALL, event);
+
+		fail_unless(pink_util_get_arg(pid, PINKTRACE_BITNESS_DEFAULT, 1, &addr), "%d(%s)",
+			errno, strerror(errno));
+
+		/* Writable page only, odd length must not clobber the next byte */
+		r = pink_util_writen(pid, addr + 3, "pinktrace", 9);
+		fail_unless(r == 9, "%zd != 9 (%d %s)", r, errno, strerror(errno));
+		fail_unless(pink_util_moven(pid, addr, buf, 14), "%d(%s)", errno, strerror(errno));
+		fail_unless(!memcmp(buf, "ppppinktracepp", 14), "`%.14s'", buf);
+
+		/* Across into the read-only page */
+		r = pink_util_writen(pid, addr + pagesize - 5, "abcdefghijklm", 13);
+		fail_unless(r == 13, "%zd != 13 (%d %s)", r, errno, strerror(errno));
+		fail_unless(pink_util_moven(pid, addr + pagesize - 6, buf, 15), "%d(%s)", errno, strerror(errno));
+		fail_unless(!memcmp(buf, "pabcdefghijklmp", 15), "`%.15s'", buf);
+
+		/* Up to the unmapped page */
+		r = pink_util_writen(pid, addr + 2 * pagesize - sizeof(long), buf, 2 * sizeof(long));
+		fail_unless(r == sizeof(long), "%zd != %zu (%d %s)", r, sizeof(long), errno, strerror(errno));
+		fail_if(pink_util_putn(pid, addr + 2 * pagesize - sizeof(long), buf, 2 * sizeof(long)));
+
+		/* Nothing writable at all */
+		errno = 0;
+		r = pink_util_writen(pid, addr + 2 * pagesize, buf, sizeof(buf));
+		fail_unless(r == -1, "%zd != -1", r);
+		fail_unless(errno == EFAULT || errno == EIO, "%d(%s)", errno, strerror(errno));
+
+		pink_trace_kill(pid);
+	}
+}
+END_TEST
+
+START_TEST(t_util_cache)
+{
+	int status;
+	long addr;
+	unsigned long hits, misses;
+	ssize_t r;
+	pid_t pid;
+	pink_event_t event;
+	char buf[16];
+
+	if ((pid = fork()) < 0)
+		fail("fork: %d(%s)", errno, strerror(errno));
+	else if (!pid) { /* child */
+		char *page;
+
+		page = mmap(NULL, sysconf(_SC_PAGESIZE), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (page == MAP_FAILED) {
+			perror("mmap");
+			_exit(-1);
+		}
+		memset(page, 'c', 16);
+		if (!pink_trace_me()) {
+			perror("pink_trace_me");
+			_exit(-1);
+		}
+		kill(getpid(), SIGSTOP);
+		syscall(SYS_write, -1, page, 0);
+		page[0] = 'd';
+		syscall(SYS_write, -1, page, 0);
+	}
+	else { /* parent */
+		fail_if(waitpid(pid, &status, 0) < 0, "%d(%s)", errno, strerror(errno));
+		fail_unless(WIFSTOPPED(status), "%#x", status);
+		fail_unless(WSTOPSIG(status) == SIGSTOP, "%#x", status);
+		fail_unless(pink_trace_setup(pid, PINK_TRACE_OPTION_SYSGOOD), "%d(%s)", errno, strerror(errno));
+
+		/* No statistics without a cache */
+		errno = 0;
+		fail_if(pink_util_cache_stats(pid, &hits, &misses));
+		fail_unless(errno == ENOENT, "%d(%s)", errno, strerror(errno));
+		fail_unless(pink_util_cache_enable(pid, true), "%d(%s)", errno, strerror(errno));
+
+		/* Resume the child and it will stop at the next system call */
+		fail_unless(pink_trace_syscall(pid, 0), "%d(%s)", errno, strerror(errno));
+		fail_if(waitpid(pid, &status, 0) < 0, "%d(%s)", errno, strerror(errno));
+		event = pink_event_decide(status);
+		fail_unless(event == PINK_EVENT_SYSCALL, "%d != %d", PINK_EVENT_SYSCALL, event);
+
+		fail_unless(pink_util_get_arg(pid, PINKTRACE_BITNESS_DEFAULT, 1, &addr), "%d(%s)",
+			errno, strerror(errno));
+
+		/* The second read is served from the cache */
+		fail_unless(pink_util_moven(pid, addr, buf, 4), "%d(%s)", errno, strerror(errno));
+		fail_unless(pink_util_moven(pid, addr + 4, buf + 4, 4), "%d(%s)", errno, strerror(errno));
+		fail_unless(!memcmp(buf, "cccccccc", 8), "`%.8s'", buf);
+		fail_unless(pink_util_cache_stats(pid, &hits, &misses), "%d(%s)", errno, strerror(errno));
+		fail_unless(hits == 1, "%lu != 1", hits);
+		fail_unless(misses == 1, "%lu != 1", misses);
+
+		/* Writing invalidates the cache */
+		r = pink_util_writen(pid, addr, "x", 1);
+		fail_unless(r == 1, "%zd != 1 (%d %s)", r, errno, strerror(errno));
+		fail_unless(pink_util_moven(pid, addr, buf, 2), "%d(%s)", errno, strerror(errno));
+		fail_unless(!memcmp(buf, "xc", 2), "`%.2s'", buf);
+		fail_unless(pink_util_cache_stats(pid, &hits, &misses), "%d(%s)", errno, strerror(errno));
+		fail_unless(misses == 2, "%lu != 2", misses);
+
+		/* So does resuming the child, which changes the page */
+		fail_unless(pink_trace_syscall(pid, 0), "%d(%s)", errno, strerror(errno));
+		fail_if(waitpid(pid, &status, 0) < 0, "%d(%s)", errno, strerror(errno));
+		fail_unless(pink_trace_syscall(pid, 0), "%d(%s)", errno, strerror(errno));
+		fail_if(waitpid(pid, &status, 0) < 0, "%d(%s)", errno, strerror(errno));
+		event = pink_event_decide(status);
+		fail_unless(event == PINK_EVENT_SYSCALL, "%d != %d", PINK_EVENT_SYSCALL, event);
+		fail_unless(pink_util_moven(pid, addr, buf, 2), "%d(%s)", errno, strerror(errno));
+		fail_unless(!memcmp(buf, "dc", 2), "`%.2s'", buf);
+		fail_unless(pink_util_cache_stats(pid, &hits, &misses), "%d(%s)", errno, strerror(errno));
+		fail_unless(hits == 1, "%lu != 1", hits);
+		fail_unless(misses == 3, "%lu != 3", misses);
+
+		fail_unless(pink_util_cache_enable(pid, false), "%d(%s)", errno, strerror(errno));
+		errno = 0;
+		fail_if(pink_util_cache_stats(pid, NULL, NULL));
+		fail_unless(errno == ENOENT, "%d(%s)", errno, strerror(errno));
+
+		pink_trace_kill(pid);
+	}
+}
+END_TEST
+
+START_TEST(t_util_cache_strings)
+{
+	int status;
+	long addr, addr_stack;
+	unsigned long misses, m;
+	pid_t pid;
+	pink_event_t event;
+	char buf[32];
+	char *s;
+
+	if ((pid = fork()) < 0)
+		fail("fork: %d(%s)", errno, strerror(errno));
+	else if (!pid) { /* child */
+		static const char path[] = "/etc/pinktrace";
+		char stack[] = "/tmp/pinktrace";
+
+		if (!pink_trace_me()) {
+			perror("pink_trace_me");
+			_exit(-1);
+		}
+		kill(getpid(), SIGSTOP);
+		syscall(SYS_write, -1, path, stack);
+		stack[1] = 'v';
+		syscall(SYS_write, -1, path, stack);
+	}
+	else { /* parent */
+		fail_if(waitpid(pid, &status, 0) < 0, "%d(%s)", errno, strerror(errno));
+		fail_unless(WIFSTOPPED(status), "%#x", status);
+		fail_unless(WSTOPSIG(status) == SIGSTOP, "%#x", status);
+		fail_unless(pink_trace_setup(pid, PINK_TRACE_OPTION_SYSGOOD), "%d(%s)", errno, strerror(errno));
+		fail_unless(pink_util_cache_enable(pid, true), "%d(%s)", errno, strerror(errno));
+		fail_unless(pink_util_cache_strings(pid, true), "%d(%s)", errno, strerror(errno));
+
+		/* Resume the child and it will stop at the next system call */
+		fail_unless(pink_trace_syscall(pid, 0), "%d(%s)", errno, strerror(errno));
+		fail_if(waitpid(pid, &status, 0) < 0, "%d(%s)", errno, strerror(errno));
+		event = pink_event_decide(status);
+		fail_unless(event == PINK_EVENT_SYSCALL, "%d != %d", PINK_EVENT_SYSCALL, event);
+
+		fail_unless(pink_util_get_arg(pid, PINKTRACE_BITNESS_DEFAULT, 1, &addr), "%d(%s)",
+			errno, strerror(errno));
+		fail_unless(pink_util_get_arg(pid, PINKTRACE_BITNESS_DEFAULT, 2, &addr_stack), "%d(%s)",
+			errno, strerror(errno));
+		fail_unless(pink_util_movestr(pid, addr, buf, sizeof(buf)), "%d(%s)", errno, strerror(errno));
+		fail_unless(!strcmp(buf, "/etc/pinktrace"), "`%s'", buf);
+		fail_unless(pink_util_movestr(pid, addr_stack, buf, sizeof(buf)), "%d(%s)", errno, strerror(errno));
+		fail_unless(!strcmp(buf, "/tmp/pinktrace"), "`%s'", buf);
+		fail_unless(pink_util_cache_stats(pid, NULL, &misses), "%d(%s)", errno, strerror(errno));
+
+		/* Move on to the next system call */
+		fail_unless(pink_trace_syscall(pid, 0), "%d(%s)", errno, strerror(errno));
+		fail_if(waitpid(pid, &status, 0) < 0, "%d(%s)", errno, strerror(errno));
+		fail_unless(pink_trace_syscall(pid, 0), "%d(%s)", errno, strerror(errno));
+		fail_if(waitpid(pid, &status, 0) < 0, "%d(%s)", errno, strerror(errno));
+		event = pink_event_decide(status);
+		fail_unless(event == PINK_EVENT_SYSCALL, "%d != %d", PINK_EVENT_SYSCALL, event);
+
+		/* The read-only string is served from the cache */
+		s = pink_util_movestr_persistent(pid, addr);
+		fail_unless(s != NULL, "%d(%s)", errno, strerror(errno));
+		fail_unless(!strcmp(s, "/etc/pinktrace"), "`%s'", s);
+		free(s);
+		fail_unless(pink_util_cache_stats(pid, NULL, &m), "%d(%s)", errno, strerror(errno));
+		fail_unless(m == misses, "%lu != %lu", m, misses);
+
+		/* The one on the stack is not */
+		fail_unless(pink_util_movestr(pid, addr_stack, buf, sizeof(buf)), "%d(%s)", errno, strerror(errno));
+		fail_unless(!strcmp(buf, "/vmp/pinktrace"), "`%s'", buf);
+		fail_unless(pink_util_cache_stats(pid, NULL, &m), "%d(%s)", errno, strerror(errno));
+		fail_unless(m == misses + 1, "%lu != %lu", m, misses + 1);
+
+		/* Until the memory map is invalidated */
+		pink_util_cache_invalidate_maps(pid);
+		fail_unless(pink_util_movestr(pid, addr, buf, sizeof(buf)), "%d(%s)", errno, strerror(errno));
+		fail_unless(!strcmp(buf, "/etc/pinktrace"), "`%s'", buf);
+		fail_unless(pink_util_cache_stats(pid, NULL, &m), "%d(%s)", errno, strerror(errno));
+		fail_unless(m == misses + 2, "%lu != %lu", m, misses + 2);
+
+		pink_trace_kill(pid);
+	}
+}
+END_TEST
+
+START_TEST(t_util_cache_mapped)
+{
+	int status;
+	long addr, pagesize;
+	ssize_t r;
+	pid_t pid;
+	pink_event_t event;
+	pink_util_iovec_t iov[2];
+	char buf[32], page_buf[64];
+
+	pagesize = sysconf(_SC_PAGESIZE);
+	if ((pid = fork()) < 0)
+		fail("fork: %d(%s)", errno, strerror(errno));
+	else if (!pid) { /* child */
+		char *page;
+
+		/* A writable page, a read-only page and an unmapped page */
+		page = mmap(NULL, 3 * pagesize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (page == MAP_FAILED) {
+			perror("mmap");
+			_exit(-1);
+		}
+		memset(page, 'p', 2 * pagesize);
+		if (mprotect(page + pagesize, pagesize, PROT_READ) < 0
+				|| munmap(page + 2 * pagesize, pagesize) < 0) {
+			perror("mprotect");
+			_exit(-1);
+		}
+		if (!pink_trace_me()) {
+			perror("pink_trace_me");
+			_exit(-1);
+		}
+		kill(getpid(), SIGSTOP);
+		syscall(SYS_write, -1, page, 0);
+	}
+	else { /* parent */
+		fail_if(waitpid(pid, &status, 0) < 0, "%d(%s)", errno, strerror(errno));
+		fail_unless(WIFSTOPPED(status), "%#x", status);
+		fail_unless(WSTOPSIG(status) == SIGSTOP, "%#x", status);
+		fail_unless(pink_trace_setup(pid, PINK_TRACE_OPTION_SYSGOOD), "%d(%s)", errno, strerror(errno));
+
+		/* Resume the child and it will stop at the next system call */
+		fail_unless(pink_trace_syscall(pid, 0), "%d(%s)", errno, strerror(errno));
+		fail_if(waitpid(pid, &status, 0) < 0, "%d(%s)", errno, strerror(errno));
+		event = pink_event_decide(status);
+		fail_unless(event == PINK_EVENT_SYSCALL, "%d != %d", PINK_EVENT_SYSCALL, event);
+
+		fail_unless(pink_util_get_arg(pid, PINKTRACE_BITNESS_DEFAULT, 1, &addr), "%d(%s)",
+			errno, strerror(errno));
+
+		/* No memory map without a cache */
+		errno = 0;
+		fail_if(pink_util_cache_mapped(pid, addr, 1, PROT_READ));
+		fail_unless(errno == ENOENT, "%d(%s)", errno, strerror(errno));
+		fail_unless(pink_util_cache_enable(pid, true), "%d(%s)", errno, strerror(errno));
+
+		fail_unless(pink_util_cache_mapped(pid, addr, 2 * pagesize, PROT_READ), "%d(%s)",
+			errno, strerror(errno));
+		fail_unless(pink_util_cache_mapped(pid, addr, pagesize, PROT_READ | PROT_WRITE), "%d(%s)",
+			errno, strerror(errno));
+		errno = 0;
+		fail_if(pink_util_cache_mapped(pid, addr, pagesize + 1, PROT_WRITE));
+		fail_unless(errno == EFAULT, "%d(%s)", errno, strerror(errno));
+		errno = 0;
+		fail_if(pink_util_cache_mapped(pid, addr + pagesize, pagesize + 1, PROT_READ));
+		fail_unless(errno == EFAULT, "%d(%s)", errno, strerror(errno));
+
+		/* Reads end where the memory map says */
+		iov[0].addr = addr + 2 * pagesize - 16;
+		iov[0].dest = page_buf;
+		iov[0].len = sizeof(page_buf);
+		iov[1].addr = addr + 2 * pagesize;
+		iov[1].dest = buf;
+		iov[1].len = sizeof(buf);
+		fail_unless(pink_util_readv(pid, iov, 2), "%d(%s)", errno, strerror(errno));
+		fail_unless(iov[0].count == 16, "%zd != 16", iov[0].count);
+		fail_unless(iov[1].count == -1, "%zd != -1", iov[1].count);
+
+		/* Writes, across into the read-only page and up to the unmapped page */
+		r = pink_util_writen(pid, addr + pagesize - 5, "abcdefghijklm", 13);
+		fail_unless(r == 13, "%zd != 13 (%d %s)", r, errno, strerror(errno));
+		fail_unless(pink_util_moven(pid, addr + pagesize - 6, buf, 15), "%d(%s)", errno, strerror(errno));
+		fail_unless(!memcmp(buf, "pabcdefghijklmp", 15), "`%.15s'", buf);
+		r = pink_util_writen(pid, addr + 2 * pagesize - sizeof(long), buf, 2 * sizeof(long));
+		fail_unless(r == sizeof(long), "%zd != %zu (%d %s)", r, sizeof(long), errno, strerror(errno));
+
+		pink_trace_kill(pid);
+	}
+}
+END_TEST
+
+START_TEST(t_util_regs_snapshot)
+{
+	int status;
+	long arg, scno;
+	pid_t pid;
+	pink_event_t event;
+
+	if ((pid = fork()) < 0)
+		fail("fork: %d(%s)", errno, strerror(errno));
+	else if (!pid) { /* child */
+		if (!pink_trace_me()) {
+			perror("pink_trace_me");
+			_exit(-1);
+		}
+		kill(getpid(), SIGSTOP);
+		syscall(SYS_write, -1L, 0L, 13L);
+		syscall(SYS_getpid);
+	}
+	else { /* parent */
+		fail_if(waitpid(pid, &status, 0) < 0, "%d(%s)", errno, strerror(errno));
+		fail_unless(WIFSTOPPED(status), "%#x", status);
+		fail_unless(WSTOPSIG(status) == SIGSTOP, "%#x", status);
+		fail_unless(pink_trace_setup(pid, PINK_TRACE_OPTION_SYSGOOD), "%d(%s)", errno, strerror(errno));
+
+		/* Resume the child and it will stop at the next system call */
+		fail_unless(pink_trace_syscall(pid, 0), "%d(%s)", errno, strerror(errno));
+
+		/* Make sure we got the right event */
+		fail_if(waitpid(pid, &status, 0) < 0, "%d(%s)", errno, strerror(errno));
+		event = pink_event_decide(status);
+		fail_unless(event == PINK_EVENT_SYSCALL, "%d != %d", PINK_EVENT_SYSCALL, event);
+
+		fail_unless(pink_util_regs_snapshot(pid), "%d(%s)", errno, strerror(errno));
+		fail_unless(pink_bitness_get(pid) == PINKTRACE_BITNESS_DEFAULT, "%d(%s)", errno, strerror(errno));
+		fail_unless(pink_util_get_syscall(pid, PINKTRACE_BITNESS_DEFAULT, &scno), "%d(%s)",
+			errno, strerror(errno));
+		fail_unless(scno == SYS_write, "%ld != %ld", SYS_write, scno);
+		fail_unless(pink_util_get_arg(pid, PINKTRACE_BITNESS_DEFAULT, 2, &arg), "%d(%s)",
+			errno, strerror(errno));
+		fail_unless(arg == 13, "13 != %ld", arg);
+
+		/* Modifications are visible through the snapshot */
+		fail_unless(pink_util_set_arg(pid, PINKTRACE_BITNESS_DEFAULT, 2, 7), "%d(%s)",
+			errno, strerror(errno));
+		fail_unless(pink_util_get_arg(pid, PINKTRACE_BITNESS_DEFAULT, 2, &arg), "%d(%s)",
+			errno, strerror(errno));
+		fail_unless(arg == 7, "7 != %ld", arg);
+
+		/* Resuming the child invalidates the snapshot */
+		for (unsigned int i = 0; i < 2; i++) {
+			fail_unless(pink_trace_syscall(pid, 0), "%d(%s)", errno, strerror(errno));
+			fail_if(waitpid(pid, &status, 0) < 0, "%d(%s)", errno, strerror(errno));
+			event = pink_event_decide(status);
+			fail_unless(event == PINK_EVENT_SYSCALL, "%d != %d", PINK_EVENT_SYSCALL, event);
+		}
+		fail_unless(pink_util_get_syscall(pid, PINKTRACE_BITNESS_DEFAULT, &scno), "%d(%s)",
+			errno, strerror(errno));
+		fail_unless(scno == SYS_getpid, "%ld != %ld", SYS_getpid, scno);
+
+		pink_trace_kill(pid);
+	}
+}
+END_TEST
+
+START_TEST(t_util_regs_writeback)
+{
+	int status;
+	long scno;
+	pid_t pid;
+	pink_event_t event;
+
+	if ((pid = fork()) < 0)
+		fail("fork: %d(%s)", errno, strerror(errno));
+	else if (!pid) { /* child */
+		long ret;
+
+		if (!pink_trace_me()) {
+			perror("pink_trace_me");
+			_exit(-1);
+		}
+		kill(getpid(), SIGSTOP);
+		ret = syscall(SYS_write, -1L, 0L, 13L);
+		_exit(ret == 42 ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+	else { /* parent */
+		fail_if(waitpid(pid, &status, 0) < 0, "%d(%s)", errno, strerror(errno));
+		fail_unless(WIFSTOPPED(status), "%#x", status);
+		fail_unless(WSTOPSIG(status) == SIGSTOP, "%#x", status);
+		fail_unless(pink_trace_setup(pid, PINK_TRACE_OPTION_SYSGOOD), "%d(%s)", errno, strerror(errno));
+
+		/* Resume the child and it will stop at the next system call */
+		fail_unless(pink_trace_syscall(pid, 0), "%d(%s)", errno, strerror(errno));
+
+		/* Make sure we got the right event */
+		fail_if(waitpid(pid, &status, 0) < 0, "%d(%s)", errno, strerror(errno));
+		event = pink_event_decide(status);
+		fail_unless(event == PINK_EVENT_SYSCALL, "%d != %d", PINK_EVENT_SYSCALL, event);
+
+		/* Deny the system call, the modifications are written back on resume */
+		fail_unless(pink_util_regs_snapshot(pid), "%d(%s)", errno, strerror(errno));
+		fail_unless(pink_util_set_syscall(pid, PINKTRACE_BITNESS_DEFAULT, PINK_SYSCALL_INVALID),
+			"%d(%s)", errno, strerror(errno));
+		fail_unless(pink_util_set_arg(pid, PINKTRACE_BITNESS_DEFAULT, 0, 0), "%d(%s)",
+			errno, strerror(errno));
+		fail_unless(pink_trace_syscall(pid, 0), "%d(%s)", errno, strerror(errno));
+
+		fail_if(waitpid(pid, &status, 0) < 0, "%d(%s)", errno, strerror(errno));
+		event = pink_event_decide(status);
+		fail_unless(event == PINK_EVENT_SYSCALL, "%d != %d", PINK_EVENT_SYSCALL, event);
+
+		fail_unless(pink_util_regs_snapshot(pid), "%d(%s)", errno, strerror(errno));
+		fail_unless(pink_util_get_syscall(pid, PINKTRACE_BITNESS_DEFAULT, &scno), "%d(%s)",
+			errno, strerror(errno));
+		fail_unless(scno == PINK_SYSCALL_INVALID, "%ld != %ld", PINK_SYSCALL_INVALID, scno);
+		fail_unless(pink_util_set_return(pid, 42), "%d(%s)", errno, strerror(errno));
+		fail_unless(pink_util_regs_flush(pid), "%d(%s)", errno, strerror(errno));
+		fail_unless(pink_trace_cont(pid, 0, NULL), "%d(%s)", errno, strerror(errno));
+
+		fail_if(waitpid(pid, &status, 0) < 0, "%d(%s)", errno, strerror(errno));
+		fail_unless(WIFEXITED(status), "%#x", status);
+		fail_unless(WEXITSTATUS(status) == EXIT_SUCCESS, "%#x", status);
+	}
+}
+END_TEST
+
+START_TEST(t_util_syscall_info)
+{
+	int status;
+	long arg, scno, ret;
+	pid_t pid;
+	pink_event_t event;
+	pink_syscall_info_t info;
+
+	if ((pid = fork()) < 0)
+		fail("fork: %d(%s)", errno, strerror(errno));
+	else if (!pid) { /* child */
+		if (!pink_trace_me()) {
+			perror("pink_trace_me");
+			_exit(-1);
+		}
+		kill(getpid(), SIGSTOP);
+		syscall(SYS_write, -1L, 0L, 13L);
+		_exit(0);
+	}
+	else { /* parent */
+		fail_if(waitpid(pid, &status, 0) < 0, "%d(%s)", errno, strerror(errno));
+		fail_unless(WIFSTOPPED(status), "%#x", status);
+		fail_unless(WSTOPSIG(status) == SIGSTOP, "%#x", status);
+		fail_unless(pink_trace_setup(pid, PINK_TRACE_OPTION_SYSGOOD), "%d(%s)", errno, strerror(errno));
+
+		/* Resume the child and it will stop at the next system call */
+		fail_unless(pink_trace_syscall(pid, 0), "%d(%s)", errno, strerror(errno));
+
+		/* Make sure we got the right event */
+		fail_if(waitpid(pid, &status, 0) < 0, "%d(%s)", errno, strerror(errno));
+		event = pink_event_decide(status);
+		fail_unless(event == PINK_EVENT_SYSCALL, "%d != %d", PINK_EVENT_SYSCALL, event);
+
+		if (!pink_trace_get_syscall_info(pid, &info)) {
+			/* Kernel is too old */
+			fail_unless(errno == ENOSYS, "%d(%s)", errno, strerror(errno));
+			pink_trace_kill(pid);
+			return;
+		}
+		fail_unless(info.op == PINK_SYSCALL_INFO_ENTRY, "%d != %d", PINK_SYSCALL_INFO_ENTRY, info.op);
+		fail_unless(info.bitness == PINKTRACE_BITNESS_DEFAULT, "%d != %d", PINKTRACE_BITNESS_DEFAULT, info.bitness);
+		fail_unless(info.scno == SYS_write, "%ld != %ld", SYS_write, info.scno);
+		fail_unless(info.args[0] == -1, "-1 != %ld", info.args[0]);
+		fail_unless(info.args[2] == 13, "13 != %ld", info.args[2]);
+
+		/* Accessors use the information */
+		fail_unless(pink_util_get_arg(pid, PINKTRACE_BITNESS_DEFAULT, 2, &arg), "%d(%s)",
+			errno, strerror(errno));
+		fail_unless(arg == 13, "13 != %ld", arg);
+
+		fail_unless(pink_trace_syscall(pid, 0), "%d(%s)", errno, strerror(errno));
+		fail_if(waitpid(pid, &status, 0) < 0, "%d(%s)", errno, strerror(errno));
+		event = pink_event_decide(status);
+		fail_unless(event == PINK_EVENT_SYSCALL, "%d != %d", PINK_EVENT_SYSCALL, event);
+
+		fail_unless(pink_trace_get_syscall_info(pid, &info), "%d(%s)", errno, strerror(errno));
+		fail_unless(info.op == PINK_SYSCALL_INFO_EXIT, "%d != %d", PINK_SYSCALL_INFO_EXIT, info.op);
+		fail_unless(info.scno == SYS_write, "%ld != %ld", SYS_write, info.scno);
+		fail_unless(info.is_error, "%ld", info.ret);
+		fail_unless(info.ret == -EBADF, "%d != %ld", -EBADF, info.ret);
+
+		fail_unless(pink_util_get_syscall(pid, PINKTRACE_BITNESS_DEFAULT, &scno), "%d(%s)",
+			errno, strerror(errno));
+		fail_unless(scno == SYS_write, "%ld != %ld", SYS_write, scno);
+		fail_unless(pink_util_get_return(pid, &ret), "%d(%s)", errno, strerror(errno));
+		fail_unless(ret == -EBADF, "%d != %ld", -EBADF, ret);
+
+		pink_trace_kill(pid);
+	}
+}
+END_TEST
+
 Suite *
 util_suite_create(void)
 {
@@ -870,6 +1696,18 @@ util_suite_create(void)
 	tcase_add_test(tc_pink_util, t_util_set_arg_sixth);
 #endif /* __WORDSIZE == 64 */
 
+	tcase_add_test(tc_pink_util, t_util_readn);
+	tcase_add_test(tc_pink_util, t_util_readn_partial);
+	tcase_add_test(tc_pink_util, t_util_regs_snapshot);
+	tcase_add_test(tc_pink_util, t_util_regs_writeback);
+	tcase_add_test(tc_pink_util, t_util_syscall_info);
+	tcase_add_test(tc_pink_util, t_util_readstr);
+	tcase_add_test(tc_pink_util, t_util_readv);
+	tcase_add_test(tc_pink_util, t_util_writen);
+	tcase_add_test(tc_pink_util, t_util_cache);
+	tcase_add_test(tc_pink_util, t_util_cache_strings);
+	tcase_add_test(tc_pink_util, t_util_cache_mapped);
+
 	suite_add_tcase(s, tc_pink_util);
 
 	return s;
@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/syscall.h>
+#include <pinktrace/pink.h>
+#include <pinktrace/easy/pink.h>
+
+#define NCALLS 3
+
+static unsigned nsyscall;
+
+static int eb_child(pink_easy_child_error_t error)
+{
+	fprintf(stderr, "%s:%d: child[%i]: %s\n",
+			__func__, __LINE__,
+			getpid(), pink_easy_child_strerror(error));
+	return -1;
+}
+
+static int cb_syscall(const pink_easy_context_t *ctx, pink_easy_process_t *current, bool entering)
+{
+	long scno;
+	pid_t pid = pink_easy_process_get_pid(current);
+	pink_bitness_t bitness = pink_easy_process_get_bitness(current);
+
+	if (!entering) {
+		fprintf(stderr, "%s:%d: unexpected system call exit\n", __func__, __LINE__);
+		return PINK_EASY_CFLAG_ABORT;
+	}
+	if (!pink_util_get_syscall(pid, bitness, &scno)) {
+		fprintf(stderr, "%s:%d: pink_util_get_syscall failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		return PINK_EASY_CFLAG_ABORT;
+	}
+	if (scno != SYS_getppid) {
+		fprintf(stderr, "%s:%d: unexpected system call %ld (%s)\n",
+				__func__, __LINE__,
+				scno, pink_name_syscall(scno, bitness));
+		return PINK_EASY_CFLAG_ABORT;
+	}
+
+	++nsyscall;
+	return 0;
+}
+
+static int cb_exit(const pink_easy_context_t *ctx, pid_t pid, int status)
+{
+	if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
+		return 0;
+
+	fprintf(stderr, "%s:%d: pid:%i status:%#x", __func__, __LINE__, pid, (unsigned)status);
+	return PINK_EASY_CFLAG_ABORT;
+}
+
+static int getppid_func(void *data)
+{
+	unsigned i;
+
+	for (i = 0; i < NCALLS; i++) {
+		syscall(SYS_getppid);
+		syscall(SYS_getpid);
+	}
+
+	return 0;
+}
+
+int
+main(void)
+{
+	pink_easy_error_t error;
+	pink_easy_callback_table_t tbl;
+	pink_easy_context_t *ctx;
+
+	memset(&tbl, 0, sizeof(pink_easy_callback_table_t));
+	tbl.cerror = eb_child;
+	tbl.syscall = cb_syscall;
+	tbl.exit = cb_exit;
+
+	ctx = pink_easy_context_new(PINK_TRACE_OPTION_SYSGOOD, &tbl, NULL, NULL);
+	if (!ctx) {
+		perror("pink_easy_context_new");
+		abort();
+	}
+	if (!pink_easy_context_seccomp_add_name(ctx, PINKTRACE_BITNESS_DEFAULT, "getppid")) {
+		if (errno == ENOTSUP) /* Skip */
+			return 77;
+		perror("pink_easy_context_seccomp_add_name");
+		abort();
+	}
+
+	if (!pink_easy_call(ctx, getppid_func, NULL)) {
+		fprintf(stderr, "%s:%d: pink_easy_call failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+	pink_easy_loop(ctx);
+	error = pink_easy_context_get_error(ctx);
+	if (error != PINK_EASY_ERROR_SUCCESS) {
+		fprintf(stderr, "%s:%d: %i (%s) != %i (%s) -> %d (%s)\n",
+				__func__, __LINE__,
+				error, pink_easy_strerror(error),
+				PINK_EASY_ERROR_SUCCESS,
+				pink_easy_strerror(PINK_EASY_ERROR_SUCCESS),
+				errno, strerror(errno));
+		abort();
+	}
+
+	if (nsyscall != NCALLS) {
+		fprintf(stderr, "%s:%d: nsyscall:%u != %u\n",
+				__func__, __LINE__,
+				nsyscall, NCALLS);
+		abort();
+	}
+
+	pink_easy_context_destroy(ctx);
+	return 0;
+}
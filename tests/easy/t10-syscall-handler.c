@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/syscall.h>
+#include <pinktrace/pink.h>
+#include <pinktrace/easy/pink.h>
+
+#define NCALLS 3
+
+static unsigned ngetppid_entry, ngetppid_exit, ngetpid_exit;
+
+static int eb_child(pink_easy_child_error_t error)
+{
+	fprintf(stderr, "%s:%d: child[%i]: %s\n",
+			__func__, __LINE__,
+			getpid(), pink_easy_child_strerror(error));
+	return -1;
+}
+
+static int cb_getppid(const pink_easy_context_t *ctx, pink_easy_process_t *current, bool entering)
+{
+	if (entering)
+		++ngetppid_entry;
+	else
+		++ngetppid_exit;
+	return 0;
+}
+
+static int cb_getpid(const pink_easy_context_t *ctx, pink_easy_process_t *current, bool entering)
+{
+	long ret;
+	pid_t pid = pink_easy_process_get_pid(current);
+
+	if (entering) {
+		fprintf(stderr, "%s:%d: unexpected system call entry\n", __func__, __LINE__);
+		return PINK_EASY_CFLAG_ABORT;
+	}
+	if (!pink_util_get_return(pid, &ret)) {
+		fprintf(stderr, "%s:%d: pink_util_get_return failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		return PINK_EASY_CFLAG_ABORT;
+	}
+	if (ret != pid) {
+		fprintf(stderr, "%s:%d: ret:%ld != pid:%i\n", __func__, __LINE__, ret, pid);
+		return PINK_EASY_CFLAG_ABORT;
+	}
+
+	++ngetpid_exit;
+	return 0;
+}
+
+static int cb_exit(const pink_easy_context_t *ctx, pid_t pid, int status)
+{
+	if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
+		return 0;
+
+	fprintf(stderr, "%s:%d: pid:%i status:%#x", __func__, __LINE__, pid, (unsigned)status);
+	return PINK_EASY_CFLAG_ABORT;
+}
+
+static int getppid_func(void *data)
+{
+	unsigned i;
+
+	for (i = 0; i < NCALLS; i++) {
+		syscall(SYS_getppid);
+		syscall(SYS_getpid);
+	}
+
+	return 0;
+}
+
+static void check(unsigned line, const char *name, unsigned n, unsigned expected)
+{
+	if (n != expected) {
+		fprintf(stderr, "%s:%u: %s:%u != %u\n",
+				__func__, line,
+				name, n, expected);
+		abort();
+	}
+}
+
+static void run(bool seccomp, int getppid_when)
+{
+	pink_easy_error_t error;
+	pink_easy_callback_table_t tbl;
+	pink_easy_context_t *ctx;
+
+	memset(&tbl, 0, sizeof(pink_easy_callback_table_t));
+	tbl.cerror = eb_child;
+	tbl.exit = cb_exit;
+
+	ctx = pink_easy_context_new(PINK_TRACE_OPTION_SYSGOOD, &tbl, NULL, NULL);
+	if (!ctx) {
+		perror("pink_easy_context_new");
+		abort();
+	}
+	if (!pink_easy_context_syscall_add_name(ctx, PINKTRACE_BITNESS_DEFAULT, "getppid",
+				getppid_when, cb_getppid)
+			|| !pink_easy_context_syscall_add_name(ctx, PINKTRACE_BITNESS_DEFAULT, "getpid",
+				PINK_EASY_SYSCALL_EXIT, cb_getpid)) {
+		perror("pink_easy_context_syscall_add_name");
+		abort();
+	}
+	if (seccomp && !pink_easy_context_seccomp_add_name(ctx, PINKTRACE_BITNESS_DEFAULT, "getppid")) {
+		perror("pink_easy_context_seccomp_add_name");
+		abort();
+	}
+
+	if (!pink_easy_call(ctx, getppid_func, NULL)) {
+		fprintf(stderr, "%s:%d: pink_easy_call failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+	pink_easy_loop(ctx);
+	error = pink_easy_context_get_error(ctx);
+	if (error != PINK_EASY_ERROR_SUCCESS) {
+		fprintf(stderr, "%s:%d: %i (%s) != %i (%s) -> %d (%s)\n",
+				__func__, __LINE__,
+				error, pink_easy_strerror(error),
+				PINK_EASY_ERROR_SUCCESS,
+				pink_easy_strerror(PINK_EASY_ERROR_SUCCESS),
+				errno, strerror(errno));
+		abort();
+	}
+
+	pink_easy_context_destroy(ctx);
+}
+
+int
+main(void)
+{
+	pink_easy_context_t *ctx;
+	pink_easy_callback_table_t tbl;
+
+	/* Both entry and exit */
+	run(false, PINK_EASY_SYSCALL_ENTRY | PINK_EASY_SYSCALL_EXIT);
+	check(__LINE__, "ngetppid_entry", ngetppid_entry, NCALLS);
+	check(__LINE__, "ngetppid_exit", ngetppid_exit, NCALLS);
+	check(__LINE__, "ngetpid_exit", ngetpid_exit, NCALLS);
+
+	/* Seccomp: getppid stops on entry only, getpid on exit only */
+	memset(&tbl, 0, sizeof(pink_easy_callback_table_t));
+	ctx = pink_easy_context_new(0, &tbl, NULL, NULL);
+	if (!ctx) {
+		perror("pink_easy_context_new");
+		abort();
+	}
+	if (!pink_easy_context_seccomp_add_name(ctx, PINKTRACE_BITNESS_DEFAULT, "getppid")) {
+		if (errno == ENOTSUP) /* Skip the seccomp part */
+			return 0;
+		perror("pink_easy_context_seccomp_add_name");
+		abort();
+	}
+	pink_easy_context_destroy(ctx);
+
+	ngetppid_entry = ngetppid_exit = ngetpid_exit = 0;
+	run(true, PINK_EASY_SYSCALL_ENTRY);
+	check(__LINE__, "ngetppid_entry", ngetppid_entry, NCALLS);
+	check(__LINE__, "ngetppid_exit", ngetppid_exit, 0);
+	check(__LINE__, "ngetpid_exit", ngetpid_exit, NCALLS);
+
+	return 0;
+}
@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/syscall.h>
+#include <pinktrace/pink.h>
+#include <pinktrace/easy/pink.h>
+
+#define NTHREADS 4
+#define NCHILDREN 8
+#define NCALLS 20
+
+struct worker {
+	pthread_t thread;
+	unsigned ngetppid;
+	unsigned nexit;
+	int error;
+};
+
+static int eb_child(pink_easy_child_error_t error)
+{
+	fprintf(stderr, "%s:%d: child[%i]: %s\n",
+			__func__, __LINE__,
+			getpid(), pink_easy_child_strerror(error));
+	return -1;
+}
+
+static int cb_getppid(const pink_easy_context_t *ctx, pink_easy_process_t *current, bool entering)
+{
+	struct worker *w = pink_easy_context_get_userdata(ctx);
+
+	++w->ngetppid;
+	return 0;
+}
+
+static int cb_exit(const pink_easy_context_t *ctx, pid_t pid, int status)
+{
+	struct worker *w = pink_easy_context_get_userdata(ctx);
+
+	++w->nexit;
+	if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
+		return 0;
+
+	fprintf(stderr, "%s:%d: pid:%i status:%#x", __func__, __LINE__, pid, (unsigned)status);
+	return PINK_EASY_CFLAG_ABORT;
+}
+
+static int children_func(void *data)
+{
+	unsigned i, j;
+	pid_t pid;
+
+	for (i = 0; i < NCHILDREN; i++) {
+		pid = fork();
+		if (pid < 0)
+			return 1;
+		else if (!pid) {
+			for (j = 0; j < NCALLS; j++)
+				syscall(SYS_getppid);
+			_exit(0);
+		}
+	}
+	while (wait(NULL) > 0)
+		/* void */;
+
+	return 0;
+}
+
+static void *worker_func(void *data)
+{
+	struct worker *w = data;
+	pink_easy_callback_table_t tbl;
+	pink_easy_context_t *ctx;
+
+	memset(&tbl, 0, sizeof(pink_easy_callback_table_t));
+	tbl.cerror = eb_child;
+	tbl.exit = cb_exit;
+
+	ctx = pink_easy_context_new(PINK_TRACE_OPTION_SYSGOOD | PINK_TRACE_OPTION_FORK, &tbl, w, NULL);
+	if (!ctx) {
+		perror("pink_easy_context_new");
+		abort();
+	}
+	if (!pink_easy_context_syscall_add_name(ctx, PINKTRACE_BITNESS_DEFAULT, "getppid",
+				PINK_EASY_SYSCALL_ENTRY, cb_getppid)) {
+		perror("pink_easy_context_syscall_add_name");
+		abort();
+	}
+
+	if (!pink_easy_call(ctx, children_func, NULL)) {
+		fprintf(stderr, "%s:%d: pink_easy_call failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+	pink_easy_loop(ctx);
+	w->error = pink_easy_context_get_error(ctx);
+
+	pink_easy_context_destroy(ctx);
+	return NULL;
+}
+
+int
+main(void)
+{
+	unsigned i;
+	struct worker w[NTHREADS];
+
+	memset(w, 0, sizeof(w));
+	for (i = 0; i < NTHREADS; i++) {
+		errno = pthread_create(&w[i].thread, NULL, worker_func, &w[i]);
+		if (errno) {
+			perror("pthread_create");
+			abort();
+		}
+	}
+
+	/* Every worker sees its own processes only */
+	for (i = 0; i < NTHREADS; i++) {
+		pthread_join(w[i].thread, NULL);
+		if (w[i].error != PINK_EASY_ERROR_SUCCESS) {
+			fprintf(stderr, "%s:%d: worker:%u %i (%s) != %i (%s)\n",
+					__func__, __LINE__, i,
+					w[i].error, pink_easy_strerror(w[i].error),
+					PINK_EASY_ERROR_SUCCESS,
+					pink_easy_strerror(PINK_EASY_ERROR_SUCCESS));
+			abort();
+		}
+		if (w[i].ngetppid != NCHILDREN * NCALLS || w[i].nexit != NCHILDREN + 1) {
+			fprintf(stderr, "%s:%d: worker:%u getppid:%u exit:%u != %u, %u\n",
+					__func__, __LINE__, i,
+					w[i].ngetppid, w[i].nexit,
+					NCHILDREN * NCALLS, NCHILDREN + 1);
+			abort();
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,257 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/syscall.h>
+#include <pinktrace/pink.h>
+#include <pinktrace/easy/pink.h>
+
+#define NCHILDREN 8
+#define NCALLS 10
+
+/* Request to the policy thread */
+struct request {
+	pink_easy_token_t token;
+	bool deny;
+};
+
+static int policy_fds[2];
+static pink_easy_token_t last_tokens[NCHILDREN];
+static pink_easy_context_t *policy_ctx;
+static unsigned nrequests;
+static unsigned nexit;
+
+static int eb_child(pink_easy_child_error_t error)
+{
+	fprintf(stderr, "%s:%d: child[%i]: %s\n",
+			__func__, __LINE__,
+			getpid(), pink_easy_child_strerror(error));
+	return -1;
+}
+
+static int request(pink_easy_process_t *current, bool deny)
+{
+	struct request req;
+
+	req.token = pink_easy_process_get_token(current);
+	req.deny = deny;
+	if (write(policy_fds[1], &req, sizeof(req)) != sizeof(req)) {
+		perror("write");
+		abort();
+	}
+	++nrequests;
+	return PINK_EASY_CFLAG_PENDING;
+}
+
+static int cb_getppid(const pink_easy_context_t *ctx, pink_easy_process_t *current, bool entering)
+{
+	return request(current, true);
+}
+
+static int cb_dup(const pink_easy_context_t *ctx, pink_easy_process_t *current, bool entering)
+{
+	return request(current, false);
+}
+
+static int cb_exit(const pink_easy_context_t *ctx, pid_t pid, int status)
+{
+	++nexit;
+	if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
+		return 0;
+
+	fprintf(stderr, "%s:%d: pid:%i status:%#x", __func__, __LINE__, pid, (unsigned)status);
+	return PINK_EASY_CFLAG_ABORT;
+}
+
+/* Posts a bogus verdict for the previous stop of the tracee, which is over,
+ * the tracee waits for its next verdict with the same process ID */
+static void post_stale(const pink_easy_token_t *token)
+{
+	unsigned i;
+	pink_easy_verdict_t verdict;
+
+	for (i = 0; i < NCHILDREN; i++) {
+		if (last_tokens[i].pid == token->pid || last_tokens[i].pid == 0)
+			break;
+	}
+	if (i == NCHILDREN)
+		abort();
+
+	if (last_tokens[i].pid != 0) {
+		memset(&verdict, 0, sizeof(verdict));
+		verdict.error = ESRCH;
+		if (!pink_easy_process_complete(policy_ctx, last_tokens[i], &verdict)) {
+			perror("pink_easy_process_complete");
+			abort();
+		}
+	}
+	last_tokens[i] = *token;
+}
+
+/* Decides slowly, the other tracees go on meanwhile */
+static void *policy_func(void *data)
+{
+	struct request req;
+	pink_easy_verdict_t verdict;
+
+	while (read(policy_fds[0], &req, sizeof(req)) == sizeof(req)) {
+		usleep(1000);
+		post_stale(&req.token);
+		memset(&verdict, 0, sizeof(verdict));
+		if (req.deny) {
+			verdict.error = EPERM;
+		} else {
+			verdict.args_mask = 1;
+			verdict.args[0] = STDERR_FILENO;
+		}
+		if (!pink_easy_process_complete(policy_ctx, req.token, &verdict)) {
+			perror("pink_easy_process_complete");
+			abort();
+		}
+	}
+
+	return NULL;
+}
+
+static int children_func(void *data)
+{
+	unsigned i, j;
+	long r;
+	pid_t pid;
+
+	for (i = 0; i < NCHILDREN; i++) {
+		pid = fork();
+		if (pid < 0)
+			return 1;
+		else if (!pid) {
+			for (j = 0; j < NCALLS; j++) {
+				r = syscall(SYS_getppid);
+				if (r != -1 || errno != EPERM)
+					_exit(1);
+				r = syscall(SYS_dup, -1);
+				if (r < 0)
+					_exit(2);
+				close(r);
+			}
+			_exit(0);
+		}
+	}
+	while (wait(NULL) > 0)
+		/* void */;
+
+	return 0;
+}
+
+int
+main(void)
+{
+	int r;
+	pthread_t thread;
+	sigset_t mask, oldmask;
+	pink_easy_error_t error;
+	pink_easy_callback_table_t tbl;
+
+	memset(&tbl, 0, sizeof(pink_easy_callback_table_t));
+	tbl.cerror = eb_child;
+	tbl.exit = cb_exit;
+
+	policy_ctx = pink_easy_context_new(PINK_TRACE_OPTION_SYSGOOD | PINK_TRACE_OPTION_FORK, &tbl, NULL, NULL);
+	if (!policy_ctx) {
+		perror("pink_easy_context_new");
+		abort();
+	}
+	if (!pink_easy_context_syscall_add_name(policy_ctx, PINKTRACE_BITNESS_DEFAULT, "getppid",
+				PINK_EASY_SYSCALL_ENTRY, cb_getppid)
+			|| !pink_easy_context_syscall_add_name(policy_ctx, PINKTRACE_BITNESS_DEFAULT, "dup",
+				PINK_EASY_SYSCALL_ENTRY, cb_dup)) {
+		perror("pink_easy_context_syscall_add_name");
+		abort();
+	}
+
+	/* The posting thread must not take the SIGCHLD of the tracer */
+	if (pipe(policy_fds) < 0) {
+		perror("pipe");
+		abort();
+	}
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGCHLD);
+	pthread_sigmask(SIG_BLOCK, &mask, &oldmask);
+	errno = pthread_create(&thread, NULL, policy_func, NULL);
+	if (errno) {
+		perror("pthread_create");
+		abort();
+	}
+	pthread_sigmask(SIG_SETMASK, &oldmask, NULL);
+
+	if (!pink_easy_call(policy_ctx, children_func, NULL)) {
+		fprintf(stderr, "%s:%d: pink_easy_call failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+	r = pink_easy_loop(policy_ctx);
+
+	close(policy_fds[1]);
+	pthread_join(thread, NULL);
+
+	error = pink_easy_context_get_error(policy_ctx);
+	if (error != PINK_EASY_ERROR_SUCCESS || r != EXIT_SUCCESS) {
+		fprintf(stderr, "%s:%d: %i (%s) != %i (%s), r:%d\n",
+				__func__, __LINE__,
+				error, pink_easy_strerror(error),
+				PINK_EASY_ERROR_SUCCESS,
+				pink_easy_strerror(PINK_EASY_ERROR_SUCCESS),
+				r);
+		abort();
+	}
+
+	if (nrequests != 2 * NCHILDREN * NCALLS || nexit != NCHILDREN + 1) {
+		fprintf(stderr, "%s:%d: requests:%u exit:%u != %u, %u\n",
+				__func__, __LINE__,
+				nrequests, nexit, 2 * NCHILDREN * NCALLS, NCHILDREN + 1);
+		abort();
+	}
+
+	/* The loop leaves the signal mask alone */
+	pthread_sigmask(SIG_BLOCK, NULL, &mask);
+	if (sigismember(&mask, SIGCHLD)) {
+		fprintf(stderr, "%s:%d: SIGCHLD blocked by the loop\n",
+				__func__, __LINE__);
+		abort();
+	}
+
+	pink_easy_context_destroy(policy_ctx);
+	return 0;
+}
@@ -0,0 +1,294 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/syscall.h>
+#include <pinktrace/pink.h>
+#include <pinktrace/easy/pink.h>
+
+#define NCHILDREN 4
+#define NCALLS 10
+
+static pink_easy_trace_level_t default_level;
+static bool startup_none;
+static unsigned ngetppid;
+static unsigned nstartup;
+static unsigned nexit;
+static unsigned nsyscall;
+static long first_scno;
+static bool first_entering;
+
+static int eb_child(pink_easy_child_error_t error)
+{
+	fprintf(stderr, "%s:%d: child[%i]: %s\n",
+			__func__, __LINE__,
+			getpid(), pink_easy_child_strerror(error));
+	return -1;
+}
+
+static void cb_startup(const pink_easy_context_t *ctx, pink_easy_process_t *current, pink_easy_process_t *parent)
+{
+	++nstartup;
+	if (parent)
+		return;
+
+	if (pink_easy_process_get_trace_level(current) != default_level) {
+		fprintf(stderr, "%s:%d: level:%d != %d\n",
+				__func__, __LINE__,
+				pink_easy_process_get_trace_level(current),
+				default_level);
+		abort();
+	}
+	if (startup_none)
+		pink_easy_process_set_trace_level(current, PINK_EASY_TRACE_NONE);
+}
+
+/* Once is enough, children inherit the level */
+static int cb_getppid(const pink_easy_context_t *ctx, pink_easy_process_t *current, bool entering)
+{
+	++ngetppid;
+	pink_easy_process_set_trace_level(current, PINK_EASY_TRACE_EVENTS);
+	return 0;
+}
+
+static void cb_startup_events(const pink_easy_context_t *ctx, pink_easy_process_t *current, pink_easy_process_t *parent)
+{
+	pink_easy_process_set_trace_level(current, PINK_EASY_TRACE_EVENTS);
+}
+
+/* The exec event stop is inside execve(), the next system call stop is its
+ * exit */
+static int cb_exec(const pink_easy_context_t *ctx, pink_easy_process_t *current, pink_bitness_t old_bitness)
+{
+	pink_easy_process_set_trace_level(current, PINK_EASY_TRACE_SYSCALL);
+	return 0;
+}
+
+static int cb_syscall(const pink_easy_context_t *ctx, pink_easy_process_t *current, bool entering)
+{
+	if (nsyscall++ == 0) {
+		first_entering = entering;
+		if (!pink_util_get_syscall(pink_easy_process_get_pid(current),
+					pink_easy_process_get_bitness(current), &first_scno)) {
+			perror("pink_util_get_syscall");
+			abort();
+		}
+	}
+	return 0;
+}
+
+static int cb_exit(const pink_easy_context_t *ctx, pid_t pid, int status)
+{
+	++nexit;
+	if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
+		return 0;
+
+	fprintf(stderr, "%s:%d: pid:%i status:%#x", __func__, __LINE__, pid, (unsigned)status);
+	return PINK_EASY_CFLAG_ABORT;
+}
+
+static int children_func(void *data)
+{
+	int r, status;
+	unsigned i, j;
+	pid_t pid;
+
+	for (j = 0; j < NCALLS; j++)
+		syscall(SYS_getppid);
+	for (i = 0; i < NCHILDREN; i++) {
+		pid = fork();
+		if (pid < 0)
+			return 1;
+		else if (!pid) {
+			/* Fails with ENOSYS under the seccomp filter if the
+			 * child is not traced */
+			for (j = 0; j < NCALLS; j++)
+				if (syscall(SYS_getppid) < 0)
+					_exit(1);
+			_exit(0);
+		}
+	}
+	r = 0;
+	while (wait(&status) > 0)
+		if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+			r = 1;
+
+	return r;
+}
+
+static void test(bool handler, bool none, bool seccomp,
+		unsigned want_getppid, unsigned want_procs)
+{
+	pink_easy_error_t error;
+	pink_easy_callback_table_t tbl;
+	pink_easy_context_t *ctx;
+
+	memset(&tbl, 0, sizeof(pink_easy_callback_table_t));
+	tbl.cerror = eb_child;
+	tbl.startup = cb_startup;
+	tbl.exit = cb_exit;
+
+	ctx = pink_easy_context_new(PINK_TRACE_OPTION_SYSGOOD | PINK_TRACE_OPTION_FORK, &tbl, NULL, NULL);
+	if (!ctx) {
+		perror("pink_easy_context_new");
+		abort();
+	}
+	if (handler && !pink_easy_context_syscall_add_name(ctx, PINKTRACE_BITNESS_DEFAULT, "getppid",
+				PINK_EASY_SYSCALL_ENTRY, cb_getppid)) {
+		perror("pink_easy_context_syscall_add_name");
+		abort();
+	}
+	if (seccomp && !pink_easy_context_seccomp_add_name(ctx, PINKTRACE_BITNESS_DEFAULT, "getppid")) {
+		if (errno == ENOTSUP) { /* Skip */
+			pink_easy_context_destroy(ctx);
+			return;
+		}
+		perror("pink_easy_context_seccomp_add_name");
+		abort();
+	}
+
+	default_level = handler ? PINK_EASY_TRACE_SYSCALL : PINK_EASY_TRACE_EVENTS;
+	startup_none = none;
+	ngetppid = nstartup = nexit = 0;
+
+	if (!pink_easy_call(ctx, children_func, NULL)) {
+		fprintf(stderr, "%s:%d: pink_easy_call failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+	pink_easy_loop(ctx);
+
+	error = pink_easy_context_get_error(ctx);
+	if (error != PINK_EASY_ERROR_SUCCESS) {
+		fprintf(stderr, "%s:%d: %i (%s) != %i (%s)\n",
+				__func__, __LINE__,
+				error, pink_easy_strerror(error),
+				PINK_EASY_ERROR_SUCCESS,
+				pink_easy_strerror(PINK_EASY_ERROR_SUCCESS));
+		abort();
+	}
+
+	if (ngetppid != want_getppid || nstartup != want_procs || nexit != want_procs) {
+		fprintf(stderr, "%s:%d: getppid:%u startup:%u exit:%u != %u, %u, %u\n",
+				__func__, __LINE__,
+				ngetppid, nstartup, nexit,
+				want_getppid, want_procs, want_procs);
+		abort();
+	}
+
+	pink_easy_context_destroy(ctx);
+}
+
+static int exec_func(void *data)
+{
+	execl("/proc/self/exe", "t16-level", "child", (char *)NULL);
+	return 1;
+}
+
+/* Raising the level at an exec event stop */
+static void test_exec(void)
+{
+	pink_easy_error_t error;
+	pink_easy_callback_table_t tbl;
+	pink_easy_context_t *ctx;
+
+	memset(&tbl, 0, sizeof(pink_easy_callback_table_t));
+	tbl.cerror = eb_child;
+	tbl.startup = cb_startup_events;
+	tbl.exec = cb_exec;
+	tbl.syscall = cb_syscall;
+	tbl.exit = cb_exit;
+
+	ctx = pink_easy_context_new(PINK_TRACE_OPTION_SYSGOOD | PINK_TRACE_OPTION_EXEC, &tbl, NULL, NULL);
+	if (!ctx) {
+		perror("pink_easy_context_new");
+		abort();
+	}
+
+	nsyscall = nexit = 0;
+	first_scno = -1;
+	first_entering = true;
+
+	if (!pink_easy_call(ctx, exec_func, NULL)) {
+		fprintf(stderr, "%s:%d: pink_easy_call failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+	pink_easy_loop(ctx);
+
+	error = pink_easy_context_get_error(ctx);
+	if (error != PINK_EASY_ERROR_SUCCESS) {
+		fprintf(stderr, "%s:%d: %i (%s) != %i (%s)\n",
+				__func__, __LINE__,
+				error, pink_easy_strerror(error),
+				PINK_EASY_ERROR_SUCCESS,
+				pink_easy_strerror(PINK_EASY_ERROR_SUCCESS));
+		abort();
+	}
+
+	if (nexit != 1 || first_entering || first_scno != SYS_execve) {
+		fprintf(stderr, "%s:%d: exit:%u first:%ld entering:%d != 1, %d, 0\n",
+				__func__, __LINE__,
+				nexit, first_scno, first_entering, SYS_execve);
+		abort();
+	}
+
+	pink_easy_context_destroy(ctx);
+}
+
+int
+main(int argc, char **argv)
+{
+	unsigned j;
+
+	if (argc > 1 && !strcmp(argv[1], "child")) {
+		for (j = 0; j < NCALLS; j++)
+			syscall(SYS_getppid);
+		return 0;
+	}
+
+	/* Without system call handlers, events only */
+	test(false, false, false, 0, NCHILDREN + 1);
+	/* The first system call lowers the level of the whole tree */
+	test(true, false, false, 1, NCHILDREN + 1);
+	/* Children are not traced at all */
+	test(true, true, false, 0, 1);
+	/* Children inherit the seccomp filter and stay traced */
+	test(true, false, true, 1, NCHILDREN + 1);
+	test(true, true, true, 0, NCHILDREN + 1);
+	test_exec();
+
+	return 0;
+}
@@ -0,0 +1,255 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/syscall.h>
+#include <pinktrace/pink.h>
+#include <pinktrace/easy/pink.h>
+
+#define NCALLS 10
+
+static bool group;
+static bool seccomp;
+static pid_t child;
+static int child_status;
+static unsigned ngetppid;
+static unsigned nteardown;
+
+static int eb_child(pink_easy_child_error_t error)
+{
+	fprintf(stderr, "%s:%d: child[%i]: %s\n",
+			__func__, __LINE__,
+			getpid(), pink_easy_child_strerror(error));
+	return -1;
+}
+
+static void cb_startup(const pink_easy_context_t *ctx, pink_easy_process_t *current, pink_easy_process_t *parent)
+{
+	if (!parent)
+		child = pink_easy_process_get_pid(current);
+}
+
+static void cb_teardown(const pink_easy_context_t *ctx, const pink_easy_process_t *current)
+{
+	++nteardown;
+}
+
+static int cb_getppid(const pink_easy_context_t *ctx, pink_easy_process_t *current, bool entering)
+{
+	++ngetppid;
+	if (!group)
+		return PINK_EASY_CFLAG_DETACH;
+	if (seccomp) {
+		/* The filter would outlive the tracer */
+		if (pink_easy_process_detach(ctx, current, true) || errno != EBUSY) {
+			fprintf(stderr, "%s:%d: detached from a seccomp-filtered process (errno:%d %s)\n",
+					__func__, __LINE__,
+					errno, strerror(errno));
+			abort();
+		}
+		return 0;
+	}
+	if (!pink_easy_process_detach(ctx, current, true)) {
+		perror("pink_easy_process_detach");
+		abort();
+	}
+	return 0;
+}
+
+static int cb_exit(const pink_easy_context_t *ctx, pid_t pid, int status)
+{
+	/* Seccomp-filtered processes are traced until they exit */
+	if (seccomp) {
+		if (pid == child)
+			child_status = status;
+		return 0;
+	}
+	fprintf(stderr, "%s:%d: pid:%i status:%#x", __func__, __LINE__, pid, (unsigned)status);
+	return PINK_EASY_CFLAG_ABORT;
+}
+
+/* Is any thread of this process traced? */
+static bool traced(void)
+{
+	bool r;
+	char path[PATH_MAX], line[128];
+	DIR *dir;
+	FILE *f;
+	struct dirent *ent;
+
+	r = false;
+	dir = opendir("/proc/self/task");
+	if (!dir)
+		return true;
+	while ((ent = readdir(dir)) != NULL) {
+		if (ent->d_name[0] == '.')
+			continue;
+		snprintf(path, sizeof(path), "/proc/self/task/%s/status", ent->d_name);
+		f = fopen(path, "r");
+		if (!f)
+			continue;
+		while (fgets(line, sizeof(line), f)) {
+			if (!strncmp(line, "TracerPid:", 10) && atoi(line + 10) != 0)
+				r = true;
+		}
+		fclose(f);
+	}
+	closedir(dir);
+	return r;
+}
+
+static void *thread_func(void *data)
+{
+	syscall(SYS_getppid);
+	return NULL;
+}
+
+static int child_func(void *data)
+{
+	unsigned i;
+	pthread_t thread;
+
+	if (group) {
+		/* The other thread detaches the whole group */
+		if (pthread_create(&thread, NULL, thread_func, NULL))
+			return 1;
+		pthread_join(thread, NULL);
+	}
+	for (i = 0; i < NCALLS; i++)
+		syscall(SYS_getppid);
+	return traced() ? 2 : 0;
+}
+
+static void test(bool detach_group, bool seccomp_mode)
+{
+	int status;
+	unsigned nprocs, ncalls;
+	pink_easy_error_t error;
+	pink_easy_callback_table_t tbl;
+	pink_easy_context_t *ctx;
+
+	memset(&tbl, 0, sizeof(pink_easy_callback_table_t));
+	tbl.cerror = eb_child;
+	tbl.startup = cb_startup;
+	tbl.teardown = cb_teardown;
+	tbl.exit = cb_exit;
+
+	ctx = pink_easy_context_new(PINK_TRACE_OPTION_SYSGOOD | PINK_TRACE_OPTION_CLONE, &tbl, NULL, NULL);
+	if (!ctx) {
+		perror("pink_easy_context_new");
+		abort();
+	}
+	if (!pink_easy_context_syscall_add_name(ctx, PINKTRACE_BITNESS_DEFAULT, "getppid",
+				PINK_EASY_SYSCALL_ENTRY, cb_getppid)) {
+		perror("pink_easy_context_syscall_add_name");
+		abort();
+	}
+	if (seccomp_mode && !pink_easy_context_seccomp_add_name(ctx, PINKTRACE_BITNESS_DEFAULT, "getppid")) {
+		if (errno == ENOTSUP) { /* Skip */
+			pink_easy_context_destroy(ctx);
+			return;
+		}
+		perror("pink_easy_context_seccomp_add_name");
+		abort();
+	}
+
+	group = detach_group;
+	seccomp = seccomp_mode;
+	child = 0;
+	child_status = -1;
+	ngetppid = nteardown = 0;
+
+	if (!pink_easy_call(ctx, child_func, NULL)) {
+		fprintf(stderr, "%s:%d: pink_easy_call failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+	/* The loop is over once all processes are detached, or have exited
+	 * in seccomp mode */
+	pink_easy_loop(ctx);
+
+	error = pink_easy_context_get_error(ctx);
+	if (error != PINK_EASY_ERROR_SUCCESS) {
+		fprintf(stderr, "%s:%d: %i (%s) != %i (%s)\n",
+				__func__, __LINE__,
+				error, pink_easy_strerror(error),
+				PINK_EASY_ERROR_SUCCESS,
+				pink_easy_strerror(PINK_EASY_ERROR_SUCCESS));
+		abort();
+	}
+
+	if (seccomp) {
+		/* The child stays traced, each getppid() stops */
+		ncalls = NCALLS + (group ? 1 : 0);
+		if (!WIFEXITED(child_status) || WEXITSTATUS(child_status) != 2
+				|| ngetppid != ncalls || nteardown != 0) {
+			fprintf(stderr, "%s:%d: status:%#x getppid:%u teardown:%u != %u, 0\n",
+					__func__, __LINE__,
+					(unsigned)child_status, ngetppid, nteardown, ncalls);
+			abort();
+		}
+		pink_easy_context_destroy(ctx);
+		return;
+	}
+
+	/* The child runs on untraced */
+	if (waitpid(child, &status, 0) < 0) {
+		perror("waitpid");
+		abort();
+	}
+	nprocs = group ? 2 : 1;
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0
+			|| ngetppid != 1 || nteardown != nprocs) {
+		fprintf(stderr, "%s:%d: status:%#x getppid:%u teardown:%u != 1, %u\n",
+				__func__, __LINE__,
+				(unsigned)status, ngetppid, nteardown, nprocs);
+		abort();
+	}
+
+	pink_easy_context_destroy(ctx);
+}
+
+int
+main(void)
+{
+	test(false, false);
+	test(true, false);
+	test(false, true);
+	test(true, true);
+
+	return 0;
+}
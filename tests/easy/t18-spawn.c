@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/syscall.h>
+#include <pinktrace/pink.h>
+#include <pinktrace/easy/pink.h>
+
+#define NCALLS 10
+#define EXIT_CERROR 42
+
+static unsigned nstartup;
+static unsigned nexec;
+static unsigned ngetppid;
+static int exit_status;
+
+static int eb_child(pink_easy_child_error_t error)
+{
+	return EXIT_CERROR;
+}
+
+static void cb_startup(const pink_easy_context_t *ctx, pink_easy_process_t *current, pink_easy_process_t *parent)
+{
+	++nstartup;
+}
+
+static int cb_exec(const pink_easy_context_t *ctx, pink_easy_process_t *current, pink_bitness_t old_bitness)
+{
+	++nexec;
+	return 0;
+}
+
+static int cb_getppid(const pink_easy_context_t *ctx, pink_easy_process_t *current, bool entering)
+{
+	++ngetppid;
+	return 0;
+}
+
+static int cb_exit(const pink_easy_context_t *ctx, pid_t pid, int status)
+{
+	exit_status = status;
+	return 0;
+}
+
+static void test(const char *path, int want_status, unsigned want_startup, unsigned want_getppid)
+{
+	pink_easy_error_t error;
+	pink_easy_callback_table_t tbl;
+	pink_easy_context_t *ctx;
+
+	memset(&tbl, 0, sizeof(pink_easy_callback_table_t));
+	tbl.cerror = eb_child;
+	tbl.startup = cb_startup;
+	tbl.exec = cb_exec;
+	tbl.exit = cb_exit;
+
+	ctx = pink_easy_context_new(PINK_TRACE_OPTION_SYSGOOD | PINK_TRACE_OPTION_EXEC, &tbl, NULL, NULL);
+	if (!ctx) {
+		perror("pink_easy_context_new");
+		abort();
+	}
+	if (!pink_easy_context_syscall_add_name(ctx, PINKTRACE_BITNESS_DEFAULT, "getppid",
+				PINK_EASY_SYSCALL_ENTRY, cb_getppid)) {
+		perror("pink_easy_context_syscall_add_name");
+		abort();
+	}
+	pink_easy_context_set_options(ctx, PINK_EASY_OPTION_SPAWN);
+
+	nstartup = nexec = ngetppid = 0;
+	exit_status = -1;
+
+	if (!pink_easy_execl(ctx, path, path, "child", NULL)) {
+		fprintf(stderr, "%s:%d: pink_easy_execl failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+	pink_easy_loop(ctx);
+
+	error = pink_easy_context_get_error(ctx);
+	if (error != PINK_EASY_ERROR_SUCCESS) {
+		fprintf(stderr, "%s:%d: %i (%s) != %i (%s)\n",
+				__func__, __LINE__,
+				error, pink_easy_strerror(error),
+				PINK_EASY_ERROR_SUCCESS,
+				pink_easy_strerror(PINK_EASY_ERROR_SUCCESS));
+		abort();
+	}
+
+	/* The child calls execve() before its first stop */
+	if (!WIFEXITED(exit_status) || WEXITSTATUS(exit_status) != want_status
+			|| nstartup != want_startup || nexec != 0 || ngetppid != want_getppid) {
+		fprintf(stderr, "%s:%d: %s status:%#x startup:%u exec:%u getppid:%u\n",
+				__func__, __LINE__, path,
+				(unsigned)exit_status, nstartup, nexec, ngetppid);
+		abort();
+	}
+
+	pink_easy_context_destroy(ctx);
+}
+
+int
+main(int argc, char **argv)
+{
+	unsigned i;
+
+	if (argc > 1 && !strcmp(argv[1], "child")) {
+		for (i = 0; i < NCALLS; i++)
+			syscall(SYS_getppid);
+		return 0;
+	}
+
+	test("/proc/self/exe", 0, 1, NCALLS);
+	/* Errors in the child are reported with the "cerror" callback, the
+	 * child exits without stopping */
+	test("/nonexistent", EXIT_CERROR, 0, 0);
+
+	return 0;
+}
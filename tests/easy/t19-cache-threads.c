@@ -0,0 +1,223 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/syscall.h>
+#include <pinktrace/pink.h>
+#include <pinktrace/easy/pink.h>
+
+#define FIRST "first"
+#define SECOND "second"
+
+static volatile int *stopped;
+static char buf[64];
+static pid_t child;
+static pink_easy_token_t child_token;
+static bool store;
+static volatile int ready;
+static unsigned ngetppid;
+
+static int eb_child(pink_easy_child_error_t error)
+{
+	fprintf(stderr, "%s:%d: child[%i]: %s\n",
+			__func__, __LINE__,
+			getpid(), pink_easy_child_strerror(error));
+	return -1;
+}
+
+static void cb_startup(const pink_easy_context_t *ctx, pink_easy_process_t *current, pink_easy_process_t *parent)
+{
+	if (!parent)
+		child = pink_easy_process_get_pid(current);
+}
+
+static void check_string(pid_t pid, long addr, const char *want)
+{
+	char s[sizeof(SECOND)];
+
+	memset(s, 0, sizeof(s));
+	if (pink_util_readn(pid, addr, s, sizeof(s) - 1) < 0) {
+		perror("pink_util_readn");
+		abort();
+	}
+	if (strcmp(s, want)) {
+		fprintf(stderr, "%s:%d: pid:%i \"%s\" != \"%s\"\n",
+				__func__, __LINE__,
+				pid, s, want);
+		abort();
+	}
+}
+
+/* The main thread stops first and waits, the string is changed by the
+ * tracer or by the second thread before it stops, both threads must see the
+ * change at once */
+static int cb_getppid(const pink_easy_context_t *ctx, pink_easy_process_t *current, bool entering)
+{
+	long addr;
+	pid_t pid = pink_easy_process_get_pid(current);
+	pink_easy_verdict_t verdict;
+
+	++ngetppid;
+	if (!pink_util_get_arg(pid, pink_easy_process_get_bitness(current), 0, &addr)) {
+		perror("pink_util_get_arg");
+		abort();
+	}
+
+	if (pid == child) {
+		check_string(pid, addr, FIRST);
+		child_token = pink_easy_process_get_token(current);
+		*stopped = 1;
+		return PINK_EASY_CFLAG_PENDING;
+	}
+
+	if (!store && !pink_util_putn(pid, addr, SECOND, sizeof(SECOND))) {
+		perror("pink_util_putn");
+		abort();
+	}
+	check_string(pid, addr, SECOND);
+	check_string(child, addr, SECOND);
+
+	memset(&verdict, 0, sizeof(verdict));
+	if (!pink_easy_process_complete((pink_easy_context_t *)ctx, child_token, &verdict)) {
+		perror("pink_easy_process_complete");
+		abort();
+	}
+	return 0;
+}
+
+static int cb_exit(const pink_easy_context_t *ctx, pid_t pid, int status)
+{
+	if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
+		return 0;
+
+	fprintf(stderr, "%s:%d: pid:%i status:%#x", __func__, __LINE__, pid, (unsigned)status);
+	return PINK_EASY_CFLAG_ABORT;
+}
+
+static void *thread_func(void *data)
+{
+	/* Wait until the main thread is stopped without a system call, the
+	 * stop would invalidate the read cache */
+	ready = 1;
+	while (!*stopped)
+		;
+	if (store)
+		strcpy(buf, SECOND);
+	syscall(SYS_getppid, buf);
+	return NULL;
+}
+
+static int child_func(void *data)
+{
+	pthread_t thread;
+
+	strcpy(buf, FIRST);
+	if (pthread_create(&thread, NULL, thread_func, NULL))
+		return 1;
+	while (!ready)
+		;
+	syscall(SYS_getppid, buf);
+	pthread_join(thread, NULL);
+	return strcmp(buf, SECOND) ? 2 : 0;
+}
+
+static void test(void)
+{
+	pink_easy_error_t error;
+	pink_easy_callback_table_t tbl;
+	pink_easy_context_t *ctx;
+
+	memset(&tbl, 0, sizeof(pink_easy_callback_table_t));
+	tbl.cerror = eb_child;
+	tbl.startup = cb_startup;
+	tbl.exit = cb_exit;
+
+	ctx = pink_easy_context_new(PINK_TRACE_OPTION_SYSGOOD | PINK_TRACE_OPTION_CLONE, &tbl, NULL, NULL);
+	if (!ctx) {
+		perror("pink_easy_context_new");
+		abort();
+	}
+	/* Threads share the read cache, whether they are created with
+	 * clone(2) or clone3(2) */
+	pink_easy_context_set_options(ctx, PINK_EASY_OPTION_CACHE);
+	if (!pink_easy_context_syscall_add_name(ctx, PINKTRACE_BITNESS_DEFAULT, "getppid",
+				PINK_EASY_SYSCALL_ENTRY, cb_getppid)) {
+		perror("pink_easy_context_syscall_add_name");
+		abort();
+	}
+	ngetppid = 0;
+	*stopped = 0;
+	if (!pink_easy_call(ctx, child_func, NULL)) {
+		fprintf(stderr, "%s:%d: pink_easy_call failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+	pink_easy_loop(ctx);
+
+	error = pink_easy_context_get_error(ctx);
+	if (error != PINK_EASY_ERROR_SUCCESS) {
+		fprintf(stderr, "%s:%d: %i (%s) != %i (%s)\n",
+				__func__, __LINE__,
+				error, pink_easy_strerror(error),
+				PINK_EASY_ERROR_SUCCESS,
+				pink_easy_strerror(PINK_EASY_ERROR_SUCCESS));
+		abort();
+	}
+	if (ngetppid != 2) {
+		fprintf(stderr, "%s:%d: getppid:%u != 2\n",
+				__func__, __LINE__,
+				ngetppid);
+		abort();
+	}
+
+	pink_easy_context_destroy(ctx);
+}
+
+int
+main(void)
+{
+	/* Shared with the child */
+	stopped = mmap(NULL, sizeof(int), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (stopped == MAP_FAILED) {
+		perror("mmap");
+		abort();
+	}
+
+	test();
+	store = true;
+	test();
+	return 0;
+}
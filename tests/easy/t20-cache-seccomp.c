@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/syscall.h>
+#include <pinktrace/pink.h>
+#include <pinktrace/easy/pink.h>
+
+static const char *const strings[] = { "first", "second" };
+
+static int fds[2];
+static unsigned nsyscall;
+
+static int eb_child(pink_easy_child_error_t error)
+{
+	fprintf(stderr, "%s:%d: child[%i]: %s\n",
+			__func__, __LINE__,
+			getpid(), pink_easy_child_strerror(error));
+	return -1;
+}
+
+/* Only getppid() calls the callback, the system calls which stop for the
+ * read cache do not */
+static int cb_syscall(const pink_easy_context_t *ctx, pink_easy_process_t *current, bool entering)
+{
+	long scno, addr;
+	char s[16];
+	pid_t pid = pink_easy_process_get_pid(current);
+	pink_bitness_t bitness = pink_easy_process_get_bitness(current);
+
+	if (!pink_util_get_syscall(pid, bitness, &scno)
+			|| !pink_util_get_arg(pid, bitness, 0, &addr)) {
+		fprintf(stderr, "%s:%d: pink_util_get_syscall failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		return PINK_EASY_CFLAG_ABORT;
+	}
+	if (!entering || scno != SYS_getppid || nsyscall >= 2) {
+		fprintf(stderr, "%s:%d: unexpected system call %ld (%s) entering:%d\n",
+				__func__, __LINE__,
+				scno, pink_name_syscall(scno, bitness), entering);
+		return PINK_EASY_CFLAG_ABORT;
+	}
+
+	/* The string of the file mapped in place of the first one */
+	if (!pink_util_movestr(pid, addr, s, sizeof(s))) {
+		perror("pink_util_movestr");
+		return PINK_EASY_CFLAG_ABORT;
+	}
+	if (strcmp(s, strings[nsyscall])) {
+		fprintf(stderr, "%s:%d: \"%s\" != \"%s\"\n",
+				__func__, __LINE__,
+				s, strings[nsyscall]);
+		return PINK_EASY_CFLAG_ABORT;
+	}
+
+	++nsyscall;
+	return 0;
+}
+
+static int cb_exit(const pink_easy_context_t *ctx, pid_t pid, int status)
+{
+	if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
+		return 0;
+
+	fprintf(stderr, "%s:%d: pid:%i status:%#x", __func__, __LINE__, pid, (unsigned)status);
+	return PINK_EASY_CFLAG_ABORT;
+}
+
+static int remap_func(void *data)
+{
+	long pagesize = sysconf(_SC_PAGESIZE);
+	char *p;
+
+	p = mmap(NULL, pagesize, PROT_READ, MAP_PRIVATE, fds[0], 0);
+	if (p == MAP_FAILED)
+		return 1;
+	syscall(SYS_getppid, p);
+	if (mmap(p, pagesize, PROT_READ, MAP_PRIVATE | MAP_FIXED, fds[1], 0) != p)
+		return 2;
+	syscall(SYS_getppid, p);
+
+	return 0;
+}
+
+int
+main(void)
+{
+	unsigned i;
+	FILE *f;
+	pink_easy_error_t error;
+	pink_easy_callback_table_t tbl;
+	pink_easy_context_t *ctx;
+
+	/* Read-only private file mappings, whose strings are cached */
+	for (i = 0; i < 2; i++) {
+		f = tmpfile();
+		if (!f || fwrite(strings[i], strlen(strings[i]) + 1, 1, f) != 1 || fflush(f)) {
+			perror("tmpfile");
+			abort();
+		}
+		fds[i] = fileno(f);
+	}
+
+	memset(&tbl, 0, sizeof(pink_easy_callback_table_t));
+	tbl.cerror = eb_child;
+	tbl.syscall = cb_syscall;
+	tbl.exit = cb_exit;
+
+	ctx = pink_easy_context_new(PINK_TRACE_OPTION_SYSGOOD, &tbl, NULL, NULL);
+	if (!ctx) {
+		perror("pink_easy_context_new");
+		abort();
+	}
+	pink_easy_context_set_options(ctx, PINK_EASY_OPTION_CACHE | PINK_EASY_OPTION_CACHE_STRINGS);
+	if (!pink_easy_context_seccomp_add_name(ctx, PINKTRACE_BITNESS_DEFAULT, "getppid")) {
+		if (errno == ENOTSUP) /* Skip */
+			return 77;
+		perror("pink_easy_context_seccomp_add_name");
+		abort();
+	}
+
+	if (!pink_easy_call(ctx, remap_func, NULL)) {
+		fprintf(stderr, "%s:%d: pink_easy_call failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+	pink_easy_loop(ctx);
+	error = pink_easy_context_get_error(ctx);
+	if (error != PINK_EASY_ERROR_SUCCESS) {
+		fprintf(stderr, "%s:%d: %i (%s) != %i (%s)\n",
+				__func__, __LINE__,
+				error, pink_easy_strerror(error),
+				PINK_EASY_ERROR_SUCCESS,
+				pink_easy_strerror(PINK_EASY_ERROR_SUCCESS));
+		abort();
+	}
+
+	if (nsyscall != 2) {
+		fprintf(stderr, "%s:%d: nsyscall:%u != 2\n",
+				__func__, __LINE__,
+				nsyscall);
+		abort();
+	}
+
+	pink_easy_context_destroy(ctx);
+	return 0;
+}